@@ -154,6 +154,63 @@ if(SPIDERMONKEY_FOUND)
     if(SPIDERMONKEY_HAS_GCZEAL)
       add_definitions(-DSPIDERMONKEY_HAS_GCZEAL)
     endif()
+
+    # Check if the GC trigger factor can be set (1.8.1+)
+    check_cxx_source_compiles(
+        "
+         #include <js/jsapi.h>
+         int main() {
+           JS_SetGCParameter((JSRuntime*)(0), JSGC_TRIGGER_FACTOR, 300);
+         }"
+        SPIDERMONKEY_HAS_GC_TRIGGER_FACTOR
+    )
+
+    if(SPIDERMONKEY_HAS_GC_TRIGGER_FACTOR)
+      add_definitions(-DSPIDERMONKEY_HAS_GC_TRIGGER_FACTOR)
+    endif()
+
+    # Check if the heap size can be queried (1.8.1+)
+    check_cxx_source_compiles(
+        "
+         #include <js/jsapi.h>
+         int main() {
+           return (int)JS_GetGCParameter((JSRuntime*)(0), JSGC_BYTES);
+         }"
+        SPIDERMONKEY_HAS_GC_BYTES
+    )
+
+    if(SPIDERMONKEY_HAS_GC_BYTES)
+      add_definitions(-DSPIDERMONKEY_HAS_GC_BYTES)
+    endif()
+
+    # Check if native allocations can be counted towards the next GC
+    check_cxx_source_compiles(
+        "
+         #include <js/jsapi.h>
+         int main() {
+           JS_updateMallocCounter((JSContext*)(0), 1);
+         }"
+        SPIDERMONKEY_HAS_UPDATE_MALLOC_COUNTER
+    )
+
+    if(SPIDERMONKEY_HAS_UPDATE_MALLOC_COUNTER)
+      add_definitions(-DSPIDERMONKEY_HAS_UPDATE_MALLOC_COUNTER)
+    endif()
+
+    # Check if the operation callback can be triggered from another thread
+    # (1.8.1+)
+    check_cxx_source_compiles(
+        "
+         #include <js/jsapi.h>
+         int main() {
+           JS_TriggerOperationCallback((JSContext*)(0));
+         }"
+        SPIDERMONKEY_HAS_OPERATION_CALLBACK
+    )
+
+    if(SPIDERMONKEY_HAS_OPERATION_CALLBACK)
+      add_definitions(-DSPIDERMONKEY_HAS_OPERATION_CALLBACK)
+    endif()
 endif()
 
 list(REMOVE_ITEM CMAKE_REQUIRED_LIBRARIES ${SPIDERMONKEY_LIBRARY})
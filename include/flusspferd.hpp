@@ -40,6 +40,7 @@ THE SOFTWARE.
 #include "flusspferd/class.hpp"
 #include "flusspferd/class_description.hpp"
 #include "flusspferd/context.hpp"
+#include "flusspferd/context_pool.hpp"
 #include "flusspferd/convert.hpp"
 #include "flusspferd/create.hpp"
 #include "flusspferd/create_on.hpp"
@@ -53,22 +54,28 @@ THE SOFTWARE.
 #include "flusspferd/exception.hpp"
 #include "flusspferd/function_adapter.hpp"
 #include "flusspferd/getopt.hpp"
+#include "flusspferd/module_stats.hpp"
 #include "flusspferd/modules.hpp"
 #include "flusspferd/init.hpp"
 #include "flusspferd/load_core.hpp"
 #include "flusspferd/local_root_scope.hpp"
+#include "flusspferd/native_call_stats.hpp"
 #include "flusspferd/native_function_base.hpp"
 #include "flusspferd/native_function.hpp"
 #include "flusspferd/native_object_base.hpp"
 #include "flusspferd/object.hpp"
+#include "flusspferd/profiler.hpp"
 #include "flusspferd/properties_functions.hpp"
 #include "flusspferd/property_attributes.hpp"
 #include "flusspferd/property_iterator.hpp"
 #include "flusspferd/root.hpp"
+#include "flusspferd/root_arena.hpp"
 #include "flusspferd/security.hpp"
 #include "flusspferd/string.hpp"
 #include "flusspferd/string_io.hpp"
+#include "flusspferd/string_view.hpp"
 #include "flusspferd/system.hpp"
+#include "flusspferd/time_limit_scope.hpp"
 #include "flusspferd/tracer.hpp"
 #include "flusspferd/value.hpp"
 #include "flusspferd/value_io.hpp"
@@ -30,7 +30,6 @@ THE SOFTWARE.
 #include "spidermonkey/arguments.hpp"
 #include "root.hpp"
 #include "value.hpp"
-#include <boost/shared_ptr.hpp>
 #include <vector>
 
 namespace flusspferd {
@@ -41,9 +40,6 @@ namespace flusspferd {
  * @ingroup functions
  */
 class arguments : public Impl::arguments_impl {
-private:
-  std::vector<boost::shared_ptr<root_value> > roots;
-
 public:
   /// An empty arguments object.
   arguments() { }
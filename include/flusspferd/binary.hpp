@@ -28,6 +28,7 @@ THE SOFTWARE.
 
 #include "native_object_base.hpp"
 #include "class_description.hpp"
+#include "init.hpp"
 #include <vector>
 
 namespace flusspferd {
@@ -45,8 +46,8 @@ FLUSSPFERD_CLASS_DESCRIPTION(
   (methods,
     ("toByteArray", bind, to_byte_array)
     ("toArray", bind, to_array)
-    ("indexOf", bind, index_of)
-    ("lastIndexOf", bind, last_index_of)
+    ("indexOf", bind, js_index_of)
+    ("lastIndexOf", bind, js_last_index_of)
     ("byteAt", bind, byte_at)
     ("charAt", alias, "byteAt")
     ("get", bind, get)
@@ -86,6 +87,15 @@ public:
 
   vector_type const &get_const_data() { return get_data(); }
 
+  /**
+   * Report the memory of the data through add_external_bytes.
+   *
+   * The methods of this class do this themselves. Code that changes the
+   * data through get_data() should call it when done, otherwise the change
+   * is only reported by the next call of get_data().
+   */
+  void update_external_bytes();
+
 protected:
   void do_append(arguments &x);
 
@@ -104,6 +114,14 @@ public:
     value byte, boost::optional<int> start, boost::optional<int> stop);
   int last_index_of(
     value byte, boost::optional<int> start, boost::optional<int> stop);
+
+  // The same for Javascript: invalid bytes are reported with
+  // set_pending_error() instead of an exception.
+  int js_index_of(
+    value byte, boost::optional<int> start, boost::optional<int> stop);
+  int js_last_index_of(
+    value byte, boost::optional<int> start, boost::optional<int> stop);
+
   byte_string &byte_at(int offset);
   int get(int offset);
   object slice(int begin, boost::optional<int> end);
@@ -113,6 +131,7 @@ public:
 
 private:
   vector_type v_data;
+  external_bytes_counter external_bytes;
 };
 
 FLUSSPFERD_CLASS_DESCRIPTION(
@@ -218,6 +237,50 @@ public:
   std::string to_source();
 };
 
+FLUSSPFERD_CLASS_DESCRIPTION(
+  float64_buffer,
+  (full_name, "binary.Float64Buffer")
+  (constructor_name, "Float64Buffer")
+  (constructor_arity, 1)
+  (methods,
+    ("get", bind, get)
+    ("set", bind, set)
+    ("toArray", bind, to_array)
+    ("toByteArray", bind, to_byte_array))
+  (properties,
+    ("length", getter_setter, (get_length, set_length))))
+{
+public:
+  typedef double element_type;
+  typedef std::vector<element_type> vector_type;
+
+  float64_buffer(object const &o, call_context &x);
+  float64_buffer(object const &o, vector_type const &data);
+
+protected:
+  void property_op(property_mode mode, value const &id, value &data);
+  bool property_resolve(value const &id, unsigned access);
+
+public:
+  vector_type &get_data();
+  std::size_t set_length(std::size_t);
+
+  std::size_t get_length();
+
+  /// Report the memory of the data, see binary::update_external_bytes.
+  void update_external_bytes();
+
+public:
+  double get(int index);
+  void set(int index, double x);
+  array to_array();
+  object to_byte_array();
+
+private:
+  vector_type v_data;
+  external_bytes_counter external_bytes;
+};
+
 }
 
 #endif
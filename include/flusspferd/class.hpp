@@ -270,6 +270,51 @@ object load_class(
   return constructor;
 }
 
+namespace detail {
+
+template<typename T>
+void load_lazy_class(object &container) {
+  // Replace the placeholder getter by the real constructor.
+  container.delete_property(T::class_info::constructor_name());
+  load_class<T>(container);
+}
+
+template<typename T>
+struct lazy_class_getter : native_function_base {
+  lazy_class_getter(object const &obj)
+    : native_function_base(obj)
+  {}
+
+  void call(call_context &x) {
+    x.result = current_context().constructor<T>();
+  }
+};
+
+}
+
+template<typename T>
+void load_class_lazy(object container = global()) {
+  char const *name = T::class_info::constructor_name();
+
+  if (container.has_own_property(name))
+    return;
+
+  context ctx = current_context();
+
+  if (!ctx.add_lazy_class(
+        T::class_info::full_name(), &detail::load_lazy_class<T>, container))
+  {
+    load_class<T>(container);
+    return;
+  }
+
+  root_object getter(
+    create<detail::lazy_class_getter<T> >(param::_name = name));
+
+  container.define_property(
+    name, property_attributes(dont_enumerate, getter));
+}
+
 #else
 
 /**
@@ -290,6 +335,25 @@ object load_class(
 template<typename T>
 object load_class(object container = global());
 
+/**
+ * Expose a class to Javascript, deferring the creation of its prototype and
+ * constructor until first use.
+ *
+ * The class is loaded either when the constructor is first read from
+ * @p container or when an instance is created from C++ (e.g. via
+ * flusspferd::create). Until then, only a placeholder getter is defined.
+ * Plugins exposing many classes should prefer this over load_class, as
+ * scripts usually only touch a few of them.
+ *
+ * @param container Object in which to define the constructor.
+ *
+ * @see load_class
+ *
+ * @ingroup classes
+ */
+template<typename T>
+void load_class_lazy(object container = global());
+
 #endif
 
 }
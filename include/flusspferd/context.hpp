@@ -30,6 +30,7 @@ THE SOFTWARE.
 #include "object.hpp"
 #include <boost/shared_ptr.hpp>
 #include <string>
+#include <cstddef>
 
 namespace flusspferd {
 
@@ -37,6 +38,53 @@ class value;
 class object;
 class native_object_base;
 
+/**
+ * Garbage collection statistics of a Javascript runtime.
+ *
+ * @see context::gc_stats
+ * @ingroup gc
+ */
+struct gc_statistics {
+  /// Number of finished garbage collections.
+  unsigned long collections;
+
+  /// Total time spent in garbage collections, in milliseconds.
+  double total_pause;
+
+  /// Longest garbage collection, in milliseconds.
+  double max_pause;
+
+  /// Duration of the last garbage collection, in milliseconds.
+  double last_pause;
+
+  /// Bytes allocated on the heap since the last garbage collection.
+  std::size_t bytes_since_gc;
+
+  /// Heap size right after the last garbage collection.
+  std::size_t live_bytes;
+
+  /// Number of values currently rooted.
+  std::size_t rooted;
+
+  /// Native memory reported through flusspferd::add_external_bytes.
+  std::size_t external_bytes;
+};
+
+#ifndef IN_DOXYGEN
+namespace detail {
+
+// Small integer identifying a class name, the same in every context.
+std::size_t class_index(std::string const &name);
+
+template<typename T>
+std::size_t class_index() {
+  static std::size_t const index = class_index(T::class_info::full_name());
+  return index;
+}
+
+}
+#endif
+
 /**
  * Javascript %context.
  *
@@ -70,8 +118,24 @@ public:
     return p == o.p;
   }
 
-  /// Create a new valid context.
-  static context create();
+  /// The default C stack limit of new contexts, in bytes.
+  static std::size_t const default_stack_limit;
+
+  /// The default size of the chunks of the engine's interpreter stack.
+  static std::size_t const default_stack_chunk_size;
+
+  /**
+   * Create a new valid context.
+   *
+   * @param stack_limit      How many bytes of C stack scripts may use.
+   * @param stack_chunk_size Size of the chunks the engine allocates for its
+   *                         interpreter stack. Cannot be changed later.
+   *
+   * @see set_stack_limit
+   */
+  static context create(
+    std::size_t stack_limit = default_stack_limit,
+    std::size_t stack_chunk_size = default_stack_chunk_size);
 
   /// Get the global Javascript object of the context.
   object global();
@@ -90,6 +154,17 @@ public:
    */
   void gc(bool maybe = false);
 
+  /**
+   * Get garbage collection statistics.
+   *
+   * The statistics are kept for the runtime, so all contexts on the same
+   * thread report the same numbers. Heap sizes are only available if the
+   * JS engine supports querying them and are 0 otherwise.
+   *
+   * @see flusspferd::gc_stats
+   */
+  gc_statistics gc_stats();
+
   /**
    * Tie the context to the current thread. Must be called
    * before the context is used in a thread.
@@ -120,6 +195,11 @@ public:
    */
   object prototype(std::string const &name) const;
 
+#ifndef IN_DOXYGEN
+  void add_prototype(std::size_t index, object const &proto);
+  object prototype(std::size_t index) const;
+#endif
+
   /**
    * Add a prototype to the context's prototype registry.
    *
@@ -129,7 +209,7 @@ public:
    */
   template<typename T>
   void add_prototype(object const &proto) {
-    add_prototype(T::class_info::full_name(), proto);
+    add_prototype(flusspferd::detail::class_index<T>(), proto);
   }
 
   /**
@@ -141,7 +221,7 @@ public:
    */
   template<typename T>
   object prototype() const {
-    return prototype(T::class_info::full_name());
+    return prototype(flusspferd::detail::class_index<T>());
   }
 
   /**
@@ -160,6 +240,11 @@ public:
    */
   object constructor(std::string const &name) const;
 
+#ifndef IN_DOXYGEN
+  void add_constructor(std::size_t index, object const &ctor);
+  object constructor(std::size_t index) const;
+#endif
+
   /**
    * Add a constructor to the context's constructor registry.
    *
@@ -169,7 +254,7 @@ public:
    */
   template<typename T>
   void add_constructor(object const &ctor) {
-    add_constructor(T::class_info::full_name(), ctor);
+    add_constructor(flusspferd::detail::class_index<T>(), ctor);
   }
 
   /**
@@ -181,9 +266,35 @@ public:
    */
   template<typename T>
   object constructor() const {
-    return constructor(T::class_info::full_name());
+    return constructor(flusspferd::detail::class_index<T>());
   }
 
+  /**
+   * Function that loads a class into a container object.
+   *
+   * @see add_lazy_class
+   */
+  typedef void (*class_loader)(object &container);
+
+  /**
+   * Defer loading of a class until its prototype or constructor is first
+   * needed.
+   *
+   * The next lookup of @p name in the prototype or constructor registry
+   * (for example from flusspferd::create) calls @p loader with
+   * @p container before looking again.
+   *
+   * @param name      The name and ID of the class.
+   * @param loader    The function that actually loads the class.
+   * @param container Object passed to @p loader.
+   * @return          false if the class is already loaded, in which case
+   *                  nothing was registered.
+   *
+   * @see load_class_lazy
+   */
+  bool add_lazy_class(
+    std::string const &name, class_loader loader, object const &container);
+
   /**
    * Set the strict mode flag on or off.
    *
@@ -221,8 +332,49 @@ public:
   bool set_gc_zeal(unsigned int mode);
 
 
+  /**
+   * Limit how much C stack scripts may use, to guard against too deep
+   * recursion.
+   *
+   * @param bytes The limit, in bytes from where the context was created.
+   */
   void set_stack_limit(size_t bytes);
+
+  /// Get the C stack limit in bytes.
   size_t get_stack_limit();
+
+  /// Get the chunk size of the interpreter stack set by create().
+  size_t get_stack_chunk_size();
+
+  /**
+   * Limit how long scripts may run in this context.
+   *
+   * The limits count from the call. When one of them is exceeded, the
+   * running script is stopped. Javascript code can not catch this; instead
+   * the outermost flusspferd::evaluate, flusspferd::execute or
+   * object::call throws a flusspferd::exception. Until the limits are
+   * removed with clear_time_limit() or set again, every further script in
+   * the context is stopped as well.
+   *
+   * @param wall_ms Limit of the wall-clock time in milliseconds, 0 for none.
+   * @param cpu_ms Limit of the CPU time used by the calling thread in
+   *               milliseconds, 0 for none.
+   *
+   * @see time_limit_scope
+   */
+  void set_time_limit(double wall_ms, double cpu_ms = 0);
+
+  /// Remove the limits set with set_time_limit() and reset interrupt().
+  void clear_time_limit();
+
+  /**
+   * Stop the script running in this context, as if its time limit had
+   * been exceeded.
+   *
+   * This is the only context method that may be called from another thread
+   * than the one using the context.
+   */
+  void interrupt();
 };
 
 /**
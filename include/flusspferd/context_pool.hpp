@@ -0,0 +1,163 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_CONTEXT_POOL_HPP
+#define FLUSSPFERD_CONTEXT_POOL_HPP
+
+#include "context.hpp"
+#include "current_context_scope.hpp"
+#include "object.hpp"
+#include "root.hpp"
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace flusspferd {
+
+class value;
+
+/**
+ * A set of initialized contexts for running many short scripts.
+ *
+ * Creating a context and loading the core modules into it costs much more
+ * than running a small script. A pool creates its contexts once and hands
+ * them out through context_pool::lease. Each lease gets a fresh scope object
+ * whose prototype is the context's global object: variables a script
+ * declares or assigns end up in the lease's scope and are gone when the
+ * lease ends, while the core modules, everything in
+ * <code>require.module_cache</code> and the class prototypes are kept.
+ *
+ * Changes a script makes to objects it reaches through the global object
+ * (like <code>Array.prototype</code> or a module's exports) are not undone.
+ *
+ * All contexts of a pool share the runtime of the thread that created the
+ * pool, so a pool must only be used on that thread.
+ *
+ * @verbatim
+context_pool pool(4, argv[0]);
+for (;;) {
+  context_pool::lease l(pool);
+  l.evaluate(next_request_filter(), "filter.js");
+}
+@endverbatim
+ *
+ * @ingroup contexts
+ */
+class context_pool : private boost::noncopyable {
+public:
+  /**
+   * Function called once for every new context of the pool, with the
+   * context's global object. Can be used to pre-load modules.
+   */
+  typedef boost::function<void (object &)> setup_function;
+
+  /**
+   * Constructor.
+   *
+   * Creates @p size contexts and runs flusspferd::security::create,
+   * flusspferd::load_core and @p setup on each.
+   *
+   * @param size The number of contexts to create up front.
+   * @param argv0 The executable name passed to flusspferd::load_core.
+   * @param setup Additional initialization for each context.
+   */
+  context_pool(
+    std::size_t size,
+    std::string const &argv0 = std::string(),
+    setup_function const &setup = setup_function());
+
+  /// Destructor.
+  ~context_pool();
+
+  /// The number of contexts owned by the pool.
+  std::size_t size() const {
+    return contexts.size();
+  }
+
+  /// The number of contexts not currently leased.
+  std::size_t available() const {
+    return free_list.size();
+  }
+
+  /**
+   * A context taken from a pool.
+   *
+   * The context is the current context while the lease exists. When the
+   * lease is destroyed the previous context is restored and the context goes
+   * back into the pool. If all contexts are leased, a new one is created and
+   * added to the pool.
+   */
+  class lease : private boost::noncopyable {
+  public:
+    /// Take a context from @p pool.
+    explicit lease(context_pool &pool);
+
+    /// Destructor. Returns the context to the pool.
+    ~lease();
+
+    /// The leased context.
+    context get_context() const {
+      return pool.contexts[index];
+    }
+
+    /// The fresh scope object of this lease.
+    object scope() const {
+      return scope_;
+    }
+
+    /**
+     * Evaluate Javascript code in the scope of this lease.
+     *
+     * @param source The source code.
+     * @param file The file name to use.
+     * @param line The initial line number.
+     */
+    value evaluate(
+      std::string const &source, char const *file = 0x0, unsigned line = 0);
+
+  private:
+    context_pool &pool;
+    std::size_t index;
+    current_context_scope current;
+    root_object scope_;
+  };
+
+private:
+  std::size_t add_context();
+  std::size_t take();
+  void give_back(std::size_t index);
+
+  std::string argv0;
+  setup_function setup;
+  std::vector<context> contexts;
+  std::vector<std::size_t> free_list;
+};
+
+}
+
+#endif
@@ -33,12 +33,18 @@ THE SOFTWARE.
 #include "spidermonkey/string.hpp"
 #include <boost/noncopyable.hpp>
 #include <boost/utility/enable_if.hpp>
+#include <boost/type_traits/is_arithmetic.hpp>
 #include <boost/type_traits/is_float.hpp>
 #include <boost/type_traits/is_integral.hpp>
 #include <boost/type_traits/is_convertible.hpp>
+#include <boost/type_traits/is_same.hpp>
 #include <boost/type_traits/remove_cv.hpp>
+#include <boost/mpl/and.hpp>
+#include <boost/mpl/or.hpp>
+#include <boost/mpl/not.hpp>
 #include <boost/optional.hpp>
 #include <limits>
+#include <string>
 #include <vector>
 #include <list>
 
@@ -113,7 +119,9 @@ struct convert<bool> {
   typedef to_value_helper<bool> to_value;
 
   struct from_value {
-    bool perform(value const &v) {
+    static bool perform(value const &v) {
+      if (v.is_boolean())
+        return v.get_boolean();
       return v.to_boolean();
     }
   };
@@ -141,6 +149,37 @@ struct convert<T &> {
   };
 };
 
+// Numbers are read without going through the engine.
+inline double number_from_value(value const &v) {
+  if (v.is_int())
+    return v.get_int();
+  if (v.is_double())
+    return v.get_double();
+  return v.to_number();
+}
+
+template<typename T, typename Condition = void>
+struct number_cast {
+  static T perform(double num) {
+    return T(num);
+  }
+};
+
+template<typename T>
+struct number_cast<
+    T,
+    typename boost::enable_if<boost::is_integral<T> >::type
+  >
+{
+  typedef std::numeric_limits<T> limits;
+
+  static T perform(double num) {
+    if (num < double(limits::min()) || num > double(limits::max()))
+      throw exception("Not inside integer range", "RangeError");
+    return T(num);
+  }
+};
+
 template<typename T>
 struct convert<
     T,
@@ -150,13 +189,8 @@ struct convert<
   typedef to_value_helper<T> to_value;
 
   struct from_value {
-    typedef std::numeric_limits<T> limits;
-
-    T perform(value const &v) {
-      double num = v.to_number();
-      if (num < double(limits::min()) || num > double(limits::max()))
-        throw exception("Not inside integer range", "RangeError");
-      return T(num);
+    static T perform(value const &v) {
+      return number_cast<T>::perform(number_from_value(v));
     }
   };
 };
@@ -170,12 +204,38 @@ struct convert<
   typedef to_value_helper<T> to_value;
 
   struct from_value {
-    T perform(value const &v) {
-      return v.to_number();
+    static T perform(value const &v) {
+      return T(number_from_value(v));
     }
   };
 };
 
+template<typename T, typename Condition = void>
+struct optional_from_value {
+  typename convert<T>::from_value base;
+
+  boost::optional<T> perform(value const &v) {
+    if (v.is_undefined() || v.is_null())
+      return boost::optional<T>();
+    return base.perform(v);
+  }
+};
+
+// The converters of primitive types are stateless, so optional primitives
+// need no nested converter object.
+template<typename T>
+struct optional_from_value<
+    T,
+    typename boost::enable_if<boost::is_arithmetic<T> >::type
+  >
+{
+  static boost::optional<T> perform(value const &v) {
+    if (v.is_undefined() || v.is_null())
+      return boost::optional<T>();
+    return boost::optional<T>(convert<T>::from_value::perform(v));
+  }
+};
+
 template<typename T>
 struct convert< boost::optional<T> > {
   struct to_value {
@@ -188,15 +248,7 @@ struct convert< boost::optional<T> > {
     }
   };
 
-  struct from_value {
-    typename convert<T>::from_value base;
-
-    boost::optional<T> perform(value const &v) {
-      if (v.is_undefined() || v.is_null())
-        return boost::optional<T>();
-      return base.perform(v);
-    }
-  };
+  typedef optional_from_value<T> from_value;
 };
 
 template<typename T>
@@ -248,7 +300,7 @@ struct convert_ptr<T, native_function_base>;
 struct convert_container_base {
   struct to_value {
     value start();
-    void add(value obj, value x);
+    void set(value obj, std::size_t i, value x);
   };
 
   struct from_value {
@@ -257,7 +309,35 @@ struct convert_container_base {
   };
 };
 
+// Bulk conversion between dense arrays and vectors of numbers or strings,
+// without a property lookup and a value per element. Numbers can also be
+// read from a binary.Float64Buffer.
+struct convert_bulk {
+  static value from_numbers(std::vector<double> const &data);
+  static void to_numbers(value obj, std::vector<double> &data);
+
+  static value from_strings(std::vector<std::string> const &data);
+  static void to_strings(value obj, std::vector<std::string> &data);
+};
+
+template<typename T>
+struct is_bulk_number
+  : boost::mpl::and_<
+      boost::mpl::or_<boost::is_integral<T>, boost::is_float<T> >,
+      boost::mpl::not_<boost::is_same<T, bool> >
+    >
+{};
+
+// Reserve room for n elements in containers that support it.
 template<typename Container>
+void reserve_if_possible(Container &, std::size_t) {}
+
+template<typename T, typename A>
+void reserve_if_possible(std::vector<T, A> &v, std::size_t n) {
+  v.reserve(n);
+}
+
+template<typename Container, typename Condition = void>
 struct convert_container {
   struct to_value {
     convert_container_base::to_value base;
@@ -268,11 +348,12 @@ struct convert_container {
 
     value perform(Container const &cont) {
       root = base.start();
+      std::size_t i = 0;
       for (typename Container::const_iterator it = cont.begin();
           it != cont.end();
-          ++it)
+          ++it, ++i)
       {
-        base.add(root, item_converter.perform(*it));
+        base.set(root, i, item_converter.perform(*it));
       }
       return root;
     }
@@ -287,7 +368,7 @@ struct convert_container {
     Container perform(value val) {
       Container result;
       std::size_t length = base.length(val);
-      result.reserve(length);
+      reserve_if_possible(result, length);
       for (std::size_t i = 0; i < length; ++i)
         result.push_back(item_converter.perform(base.element(val, i)));
       return result;
@@ -295,6 +376,95 @@ struct convert_container {
   };
 };
 
+template<typename Container>
+struct convert_container<
+    Container,
+    typename boost::enable_if<
+      is_bulk_number<typename Container::value_type> >::type
+  >
+{
+  typedef typename Container::value_type element_type;
+
+  struct to_value {
+    root_value root;
+
+    value perform(Container const &cont) {
+      root = convert_bulk::from_numbers(numbers(cont));
+      return root;
+    }
+
+    static std::vector<double> const &numbers(std::vector<double> const &v) {
+      return v;
+    }
+
+    template<typename C>
+    static std::vector<double> numbers(C const &cont) {
+      return std::vector<double>(cont.begin(), cont.end());
+    }
+  };
+
+  struct from_value {
+    Container perform(value val) {
+      std::vector<double> numbers;
+      convert_bulk::to_numbers(val, numbers);
+      Container result;
+      assign(numbers, result);
+      return result;
+    }
+
+    static void assign(std::vector<double> &numbers, std::vector<double> &to) {
+      to.swap(numbers);
+    }
+
+    template<typename C>
+    static void assign(std::vector<double> &numbers, C &to) {
+      reserve_if_possible(to, numbers.size());
+      for (std::vector<double>::iterator it = numbers.begin();
+          it != numbers.end();
+          ++it)
+      {
+        to.push_back(number_cast<element_type>::perform(*it));
+      }
+    }
+  };
+};
+
+template<typename Container>
+struct convert_container<
+    Container,
+    typename boost::enable_if<
+      boost::is_same<typename Container::value_type, std::string> >::type
+  >
+{
+  struct to_value {
+    root_value root;
+
+    value perform(Container const &cont) {
+      root = convert_bulk::from_strings(strings(cont));
+      return root;
+    }
+
+    static std::vector<std::string> const &strings(
+        std::vector<std::string> const &v)
+    {
+      return v;
+    }
+
+    template<typename C>
+    static std::vector<std::string> strings(C const &cont) {
+      return std::vector<std::string>(cont.begin(), cont.end());
+    }
+  };
+
+  struct from_value {
+    Container perform(value val) {
+      std::vector<std::string> strings;
+      convert_bulk::to_strings(val, strings);
+      return Container(strings.begin(), strings.end());
+    }
+  };
+};
+
 template<typename T, typename A>
 struct convert< std::vector<T, A> >
 : convert_container< std::vector<T, A> > {};
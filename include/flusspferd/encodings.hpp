@@ -42,6 +42,13 @@ namespace encodings {
   object convert(
     std::string const &from_enc, std::string const &to_enc, binary &source);
 
+  // Convert the bytes in @p in from charset @p from to charset @p to and
+  // append them to @p out. Needs no context, so it can be used on any
+  // thread; errors are reported as std::runtime_error.
+  void transcode_bytes(
+    std::string const &from, std::string const &to,
+    binary::vector_type const &in, binary::vector_type &out);
+
   FLUSSPFERD_CLASS_DESCRIPTION(
     transcoder,
     (full_name, "encodings.Transcoder")
@@ -136,6 +136,31 @@ public:
   virtual ~js_quit();
 };
 
+/**
+ * Report an error to Javascript without throwing a C++ exception.
+ *
+ * Creates an error of type @p type and makes it the pending exception of the
+ * current context. A native function, method or property callback that calls
+ * this should return right away (its result is ignored): the call then fails
+ * in Javascript just like after throwing flusspferd::exception, but without
+ * the cost of C++ stack unwinding.
+ *
+ * @param what The error message.
+ * @param type The error type.
+ *
+ * @ingroup exceptions
+ */
+void set_pending_error(char const *what, char const *type = "Error");
+
+/**
+ * Check whether the current context has a pending Javascript exception.
+ *
+ * @see set_pending_error
+ *
+ * @ingroup exceptions
+ */
+bool is_error_pending();
+
 }
 
 #ifndef IN_DOXYGEN
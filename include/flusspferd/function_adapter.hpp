@@ -92,6 +92,26 @@ T get_native_object_parameter2(call_context &x) {
   return ptr_to_native_object_type<T>::get(p);
 }
 
+// Argument access for the adapters. If the caller passed at least as many
+// arguments as the function takes, they are read straight from the argument
+// vector, without bounds checks.
+class adapter_arguments {
+public:
+  adapter_arguments(call_context &x, std::size_t arity)
+    : x(x), argv(x.arg.size() >= arity ? Impl::get_arguments(x.arg) : 0)
+  {}
+
+  value operator[](std::size_t i) {
+    if (argv)
+      return Impl::wrap_jsvalp(argv + i);
+    return x.arg[i];
+  }
+
+private:
+  call_context &x;
+  jsval *argv;
+};
+
 #define FLUSSPFERD_DECLARE_ARG_CONVERTER(z, i, T) \
   typename convert<typename T::BOOST_PP_CAT(BOOST_PP_CAT(arg, i), _type)>::from_value \
   BOOST_PP_CAT(BOOST_PP_CAT(arg, i), _from_value); \
@@ -108,7 +128,7 @@ T get_native_object_parameter2(call_context &x) {
 #define FLUSSPFERD_CONVERT_ARG(z, i, offset) \
   BOOST_PP_COMMA_IF(BOOST_PP_GREATER(i, 1)) \
   BOOST_PP_CAT(BOOST_PP_CAT(arg, i), _from_value) \
-  .perform((x).arg[BOOST_PP_SUB(BOOST_PP_DEC(i), offset)]) \
+  .perform(args[BOOST_PP_SUB(BOOST_PP_DEC(i), offset)]) \
   /* */
 
 #define FLUSSPFERD_CONVERT_ARGS(first, last, offset) \
@@ -125,6 +145,7 @@ T get_native_object_parameter2(call_context &x) {
     typename convert<R>::to_value to_value; \
     FLUSSPFERD_DECLARE_ARG_CONVERTERS(1, n_args, T) \
     void action(T const &function, call_context &x) { \
+      adapter_arguments args(x, arity); \
       x.result = to_value.perform( \
         function(FLUSSPFERD_CONVERT_ARGS(1, n_args, 0))); \
     } \
@@ -137,7 +158,7 @@ T get_native_object_parameter2(call_context &x) {
   struct function_adapter<T, false, void, n_args, C> { \
     FLUSSPFERD_DECLARE_ARG_CONVERTERS(1, n_args, T) \
     void action(T const &function, call_context &x) { \
-      (void)x; \
+      adapter_arguments args(x, arity); \
       function(FLUSSPFERD_CONVERT_ARGS(1, n_args, 0)); \
     } \
     static unsigned const arity = (n_args); \
@@ -156,6 +177,7 @@ T get_native_object_parameter2(call_context &x) {
     typename convert<R>::to_value to_value; \
     FLUSSPFERD_DECLARE_ARG_CONVERTERS(2, n_args, T) \
     void action(T const &function, call_context &x) { \
+      adapter_arguments args(x, arity); \
       x.result = to_value.perform( \
         function( \
           get_native_object_parameter<T>(x) \
@@ -177,6 +199,7 @@ T get_native_object_parameter2(call_context &x) {
   { \
     FLUSSPFERD_DECLARE_ARG_CONVERTERS(2, n_args, T) \
     void action(T const &function, call_context &x) { \
+      adapter_arguments args(x, arity); \
       function( \
         get_native_object_parameter<T>(x) \
         FLUSSPFERD_CONVERT_ARGS(2, n_args, 1) \
@@ -198,6 +221,7 @@ T get_native_object_parameter2(call_context &x) {
     typename convert<R>::to_value to_value; \
     FLUSSPFERD_DECLARE_ARG_CONVERTERS(2, n_args, T) \
     void action(T const &function, call_context &x) { \
+      adapter_arguments args(x, arity); \
       x.result = to_value.perform(function( \
           x.self \
           FLUSSPFERD_CONVERT_ARGS(2, n_args, 1) \
@@ -218,6 +242,7 @@ T get_native_object_parameter2(call_context &x) {
   { \
     FLUSSPFERD_DECLARE_ARG_CONVERTERS(2, n_args, T) \
     void action(T const &function, call_context &x) { \
+      adapter_arguments args(x, arity); \
       function( \
         x.self \
         FLUSSPFERD_CONVERT_ARGS(2, n_args, 1) \
@@ -245,6 +270,7 @@ T get_native_object_parameter2(call_context &x) {
     BOOST_PP_REPEAT(n_args, FLUSSPFERD_DECLARE_ARG_CONVERTER_MEMFN, ~) \
     template<typename F> \
     void action(F fun, call_context &x) { \
+      adapter_arguments args(x, arity); \
       x.result = to_value.perform( \
         (get_native_object_parameter2<T*>(x)->*fun) \
           (FLUSSPFERD_CONVERT_ARGS(1, n_args, 0))); \
@@ -266,6 +292,7 @@ T get_native_object_parameter2(call_context &x) {
     BOOST_PP_REPEAT(n_args, FLUSSPFERD_DECLARE_ARG_CONVERTER_MEMFN, ~) \
     template<typename F> \
     void action(F fun, call_context &x) { \
+      adapter_arguments args(x, arity); \
       (get_native_object_parameter2<T*>(x)->*fun) \
           (FLUSSPFERD_CONVERT_ARGS(1, n_args, 0)); \
     } \
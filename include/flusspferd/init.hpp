@@ -30,6 +30,7 @@ THE SOFTWARE.
 #include "flusspferd/context.hpp"
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <cstddef>
 
 namespace flusspferd {
 
@@ -42,7 +43,7 @@ class object;
  * @ingroup contexts
  */
 class init : boost::noncopyable {
-  init();
+  init(std::size_t max_bytes);
 
   class impl;
   boost::scoped_ptr<impl> p;
@@ -87,6 +88,75 @@ public:
    * @return The global #init object (singleton).
    */
   static init &initialize();
+
+  /**
+   * Initialize the Javascript engine if needed, with a heap limit of
+   * @p max_bytes. If the engine is initialized already, its heap limit is
+   * changed instead.
+   *
+   * @param max_bytes The maximum heap size in bytes.
+   * @return The global #init object (singleton).
+   *
+   * @see set_max_bytes
+   */
+  static init &initialize(std::size_t max_bytes);
+
+  /// The heap limit used by initialize() (8 MB unless configured otherwise).
+  static std::size_t const default_max_bytes;
+
+  /**
+   * Set the maximum number of bytes the garbage collected heap may use.
+   *
+   * Allocations beyond this limit fail with an out of memory error.
+   *
+   * @param bytes The new limit.
+   */
+  void set_max_bytes(std::size_t bytes);
+
+  /// Get the maximum heap size in bytes.
+  std::size_t get_max_bytes();
+
+  /**
+   * Set the number of bytes that may be allocated by objects (strings,
+   * arrays, ...) before a garbage collection is triggered.
+   *
+   * @param bytes The new threshold.
+   */
+  void set_max_malloc_bytes(std::size_t bytes);
+
+  /// Get the allocation threshold that triggers a garbage collection.
+  std::size_t get_max_malloc_bytes();
+
+  /**
+   * Set how much the heap may grow relative to its size after the last
+   * garbage collection before the next one is triggered.
+   *
+   * @param percent The growth in percent (at least 100).
+   * @return  true if the factor was set, false otherwise (i.e. the
+   *          JS engine does not support it.)
+   */
+  bool set_gc_trigger_factor(unsigned percent);
+
+  /// Get the GC trigger factor in percent (0 if unsupported).
+  unsigned get_gc_trigger_factor();
+
+  /**
+   * Get the garbage collection statistics of the runtime.
+   *
+   * @see context::gc_stats
+   */
+  gc_statistics get_gc_stats();
+
+  /**
+   * Account for native memory held by Javascript objects.
+   *
+   * Positive values also count towards the allocation threshold, so that
+   * large native buffers make garbage collections happen sooner.
+   *
+   * @param delta The number of bytes allocated (positive) or freed
+   *              (negative).
+   */
+  void add_external_bytes(std::ptrdiff_t delta);
 };
 
 /**
@@ -152,6 +222,62 @@ inline void gc(bool maybe = false) {
   return current_context().gc(maybe);
 }
 
+/**
+ * Get garbage collection statistics.
+ *
+ * @see current_context, context::gc_stats
+ *
+ * @ingroup gc
+ */
+inline gc_statistics gc_stats() {
+  return current_context().gc_stats();
+}
+
+/**
+ * Account for native memory held by Javascript objects.
+ *
+ * Does nothing if the current thread has no runtime (any more), so it can be
+ * called from finalizers.
+ *
+ * @see init::add_external_bytes
+ *
+ * @ingroup gc
+ */
+void add_external_bytes(std::ptrdiff_t delta);
+
+/**
+ * The size of a native buffer, as reported through add_external_bytes.
+ *
+ * update() reports the change since the last call, the destructor reports
+ * the buffer as freed.
+ *
+ * @ingroup gc
+ */
+class external_bytes_counter : boost::noncopyable {
+public:
+  external_bytes_counter() : bytes(0) {}
+
+  ~external_bytes_counter() {
+    update(0);
+  }
+
+  /// Report a size of @p n bytes.
+  void update(std::size_t n) {
+    if (n == bytes)
+      return;
+    add_external_bytes(std::ptrdiff_t(n) - std::ptrdiff_t(bytes));
+    bytes = n;
+  }
+
+  /// The reported size.
+  std::size_t get() const {
+    return bytes;
+  }
+
+private:
+  std::size_t bytes;
+};
+
 /**
  * Get a prototype from the current context's prototype registry.
  *
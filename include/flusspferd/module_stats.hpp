@@ -0,0 +1,147 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_MODULE_STATS_HPP
+#define FLUSSPFERD_MODULE_STATS_HPP
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <iosfwd>
+#include <string>
+#include <cstddef>
+
+namespace flusspferd {
+
+class object;
+
+/**
+ * Timing and size information about the modules loaded by require().
+ *
+ * Every module loaded on the current thread gets a record with the time
+ * spent in each load phase, the number of bytes read and characters
+ * decoded, and the ids of the modules it required in turn.
+ *
+ * @ingroup loadable_modules
+ */
+class module_stats : boost::noncopyable {
+public:
+  /// The phases of loading a module.
+  enum phase {
+    resolve,  ///< Everything not covered by the other phases.
+    read,     ///< Reading the source file or opening the DSO.
+    decode,   ///< Option line parsing and character decoding.
+    compile,  ///< Compiling the source text.
+    execute,  ///< Running the module (including modules it requires).
+    num_phases
+  };
+
+  /// Get the statistics of the current thread.
+  static module_stats &get();
+
+  ~module_stats();
+
+  /**
+   * Marks the loading of a module.
+   *
+   * Construct on the stack while loading a module; the phases timed while
+   * the scope is alive are accounted to it. If another module is being
+   * loaded already, a dependency edge is recorded, even if the module turns
+   * out to be cached.
+   */
+  class module_scope : boost::noncopyable {
+  public:
+    /// Start loading the module @p id.
+    module_scope(std::string const &id);
+    /// Finish loading the module.
+    ~module_scope();
+
+  private:
+    std::size_t index;
+  };
+
+  /**
+   * Times one phase of the module currently being loaded.
+   *
+   * Does nothing if no module is being loaded.
+   */
+  class phase_timer : boost::noncopyable {
+  public:
+    /// Start timing @p which.
+    phase_timer(phase which);
+    /// Stop timing.
+    ~phase_timer();
+
+  private:
+    phase which;
+    std::size_t index;
+    double start;
+  };
+
+  /**
+   * Set the canonical id (e.g. @c file:// URI) of the module currently being
+   * loaded. The record is reported under this id.
+   */
+  void set_id(std::string const &id);
+
+  /// Record that the current module was satisfied from a native library.
+  void set_native();
+
+  /// Add to the bytes read for the current module.
+  void add_bytes_read(std::size_t bytes);
+
+  /// Add to the characters decoded for the current module.
+  void add_chars_decoded(std::size_t chars);
+
+  /**
+   * Record that the current module was found in the module cache under
+   * @p id. Only the dependency edge is kept for it.
+   */
+  void set_cached(std::string const &id);
+
+  /**
+   * Get the statistics as Javascript object, keyed by module id.
+   *
+   * Times are in milliseconds.
+   */
+  object to_object() const;
+
+  /**
+   * Write the load events in the Chrome trace-event JSON format.
+   *
+   * The output can be loaded into @c chrome://tracing.
+   */
+  void write_trace(std::ostream &out) const;
+
+private:
+  module_stats();
+
+  class impl;
+  boost::scoped_ptr<impl> p;
+};
+
+}
+
+#endif
@@ -133,6 +133,17 @@ public:
   /// Populate values in require.main for @c id
   void set_main_module(std::string const &id);
 
+  /**
+   * Start reading and decoding the sources of the modules @p ids on
+   * background threads.
+   *
+   * Ids are resolved like in require(). Modules that are already loaded,
+   * preloaded or cannot be found are skipped. A later require() of one of
+   * the modules waits for its source if necessary and only compiles and
+   * executes it.
+   */
+  void prefetch(array const &ids);
+
 protected:
   object module_cache;
   object paths;
@@ -0,0 +1,156 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_NATIVE_CALL_STATS_HPP
+#define FLUSSPFERD_NATIVE_CALL_STATS_HPP
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace flusspferd {
+
+class object;
+
+/**
+ * Call counts and times of the native functions, methods and property
+ * hooks called from Javascript.
+ *
+ * The counters are only collected if Flusspferd was built with
+ * <code>-DENABLE_NATIVE_CALL_STATS=ON</code>. Otherwise the instrumentation
+ * compiles to nothing and enabled() returns false.
+ *
+ * Times include everything that happens during the call, including
+ * Javascript code called back and nested native calls.
+ *
+ * @ingroup functions
+ */
+class native_call_stats : boost::noncopyable {
+public:
+  /// What was called.
+  enum kind {
+    function_call,    ///< A native_function_base.
+    object_call,      ///< A native object called or constructed.
+    property_add,     ///< native_object_base::property_op
+    property_delete,  ///< native_object_base::property_op
+    property_get,     ///< native_object_base::property_op
+    property_set,     ///< native_object_base::property_op
+    property_resolve, ///< native_object_base::property_resolve
+    num_kinds
+  };
+
+  /// Whether the counters are compiled in.
+  static bool enabled();
+
+  /// Get the statistics of the current thread.
+  static native_call_stats &get();
+
+  ~native_call_stats();
+
+  /**
+   * Times one native call.
+   *
+   * Use through #FLUSSPFERD_NATIVE_CALL_TIMER so it disappears when the
+   * counters are disabled.
+   */
+  class timer : boost::noncopyable {
+  public:
+    /**
+     * Start timing.
+     *
+     * @param which What is called.
+     * @param type The <code>typeid(...).name()</code> of the native object,
+     *             or 0 for functions.
+     * @param member The function or property name.
+     */
+    timer(kind which, char const *type, std::string const &member);
+
+    /// Stop timing and record the call.
+    ~timer();
+
+  private:
+    kind which;
+    char const *type;
+    std::string member;
+    double start;
+  };
+
+  /// The counters of one function, method or property.
+  struct entry {
+    /// Like "Class.member get" or "function()".
+    std::string name;
+    /// Number of calls.
+    unsigned long calls;
+    /// Total time in milliseconds.
+    double time;
+  };
+
+  /// All counters, by descending time.
+  std::vector<entry> entries() const;
+
+  /**
+   * Get the counters as Javascript object, keyed by name, with @c calls
+   * and @c time (in milliseconds) properties.
+   */
+  object to_object() const;
+
+  /// Write the counters as a table, by descending time.
+  void write(std::ostream &out) const;
+
+  /// Reset all counters.
+  void reset();
+
+private:
+  native_call_stats();
+
+  class impl;
+  boost::scoped_ptr<impl> p;
+};
+
+}
+
+/**
+ * Time the enclosing scope as native call. Expands to nothing unless
+ * Flusspferd is built with native call statistics; the arguments are not
+ * evaluated then.
+ *
+ * @param which A flusspferd::native_call_stats::kind.
+ * @param type The typeid name of the native object, or 0.
+ * @param member The function or property name.
+ *
+ * @ingroup functions
+ */
+#ifdef FLUSSPFERD_NATIVE_CALL_STATS
+#define FLUSSPFERD_NATIVE_CALL_TIMER(which, type, member) \
+  ::flusspferd::native_call_stats::timer flusspferd_native_call_timer_( \
+    which, type, member)
+#else
+#define FLUSSPFERD_NATIVE_CALL_TIMER(which, type, member) ((void) 0)
+#endif
+
+#endif
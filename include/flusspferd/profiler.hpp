@@ -0,0 +1,130 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_PROFILER_HPP
+#define FLUSSPFERD_PROFILER_HPP
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace flusspferd {
+
+/**
+ * Sampling profiler for Javascript code.
+ *
+ * While running, a watchdog thread asks the engine for a sample every
+ * interval. At the next operation callback check of the profiled context,
+ * the Javascript stack (function name, file and first line of each frame)
+ * is recorded. Time spent in native code is counted for the stack that is
+ * current when the script resumes.
+ *
+ * The result can be written in the collapsed-stack format understood by
+ * flame graph tools, or as a summary of the functions with the most
+ * samples.
+ *
+ * @ingroup contexts
+ */
+class profiler : boost::noncopyable {
+public:
+  /// The default sampling interval, in milliseconds.
+  static double const default_interval;
+
+  /// Get the profiler of the current thread.
+  static profiler &get();
+
+  ~profiler();
+
+  /**
+   * Start sampling the current context.
+   *
+   * Samples are added to those recorded before. If the profiler is running
+   * already, only the interval is changed.
+   *
+   * @param interval_ms The sampling interval in milliseconds. Longer
+   *                    intervals mean less overhead and less precision.
+   */
+  void start(double interval_ms = default_interval);
+
+  /// Stop sampling.
+  void stop();
+
+  /// Whether the profiler is running.
+  bool is_running() const;
+
+  /// Discard all samples.
+  void reset();
+
+  /// The number of samples recorded.
+  unsigned long samples() const;
+
+  /**
+   * Record a stack sample.
+   *
+   * @param stack The frames, outermost first.
+   * @param weight How many samples to count for it.
+   */
+  void add_sample(std::vector<std::string> const &stack, unsigned weight = 1);
+
+  /// Samples of a function.
+  struct function_samples {
+    /// The frame, as "name (file:line)".
+    std::string frame;
+    /// Samples in which the function was running itself.
+    unsigned long self;
+    /// Samples in which the function was on the stack.
+    unsigned long total;
+  };
+
+  /**
+   * The functions with the most samples, by self samples.
+   *
+   * @param n The maximum number of functions to return.
+   */
+  std::vector<function_samples> top(std::size_t n) const;
+
+  /**
+   * Write the samples in collapsed-stack format: one line per distinct
+   * stack, frames separated by semicolons, followed by the sample count.
+   */
+  void write_folded(std::ostream &out) const;
+
+  /// Write a table of the top @p n functions.
+  void write_summary(std::ostream &out, std::size_t n = 20) const;
+
+private:
+  profiler();
+
+  class impl;
+  boost::scoped_ptr<impl> p;
+};
+
+}
+
+#endif
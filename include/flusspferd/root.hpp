@@ -27,6 +27,7 @@ THE SOFTWARE.
 #ifndef FLUSSPFERD_ROOT_VALUE_HPP
 #define FLUSSPFERD_ROOT_VALUE_HPP
 
+#include "spidermonkey/root.hpp"
 #include <boost/noncopyable.hpp>
 
 namespace flusspferd {
@@ -43,7 +44,9 @@ namespace detail {
 /**
  * Keeps a Javascript value, object or anything in a GC %root scope.
  *
- * If the GC thing could not be rooted, an exception will be thrown.
+ * Roots are kept in a list that the garbage collector traces, so creating
+ * and destroying them is cheap. To root many values at once, use a
+ * root_arena.
  *
  * A root object can be used transparently as the type it roots. For example:
  *
@@ -73,7 +76,7 @@ public:
  * @ingroup gc
  */
 template<class T>
-class root : public T, private boost::noncopyable {
+class root : public T, private Impl::root_block {
 public:
   /**
    * Construct the %root scope.
@@ -90,9 +93,6 @@ public:
     T::operator=(o);
     return *this;
   }
-
-private:
-  void **get_gcptr();
 };
 
 }
@@ -0,0 +1,91 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_ROOT_ARENA_HPP
+#define FLUSSPFERD_ROOT_ARENA_HPP
+
+#include "spidermonkey/root.hpp"
+#include "value.hpp"
+#include <vector>
+
+namespace flusspferd {
+
+/**
+ * Keeps any number of values in a single GC %root.
+ *
+ * All values added with root() stay alive until the arena is destroyed or
+ * cleared. This is cheaper than a flusspferd::root_value per value when a
+ * function creates many temporary GC things.
+ *
+ * @verbatim
+root_arena roots;
+object o = roots.root(create<object>());
+string s = roots.root(string("foo"));
+@endverbatim
+ *
+ * @see root_value, local_root_scope
+ *
+ * @ingroup gc
+ */
+class root_arena : private Impl::root_block {
+public:
+  /// Constructor.
+  root_arena();
+
+  /// Destructor.
+  ~root_arena();
+
+  /**
+   * Root a value, object, string or array.
+   *
+   * @param x The value to root.
+   * @return @p x
+   */
+  template<typename T>
+  T const &root(T const &x) {
+    push(value(x));
+    return x;
+  }
+
+  /// The number of rooted values.
+  std::size_t size() const {
+    return slots.size();
+  }
+
+  /// Unroot all values.
+  void clear() {
+    slots.clear();
+  }
+
+private:
+  void push(value const &v);
+
+  std::vector<value> slots;
+};
+
+}
+
+#endif
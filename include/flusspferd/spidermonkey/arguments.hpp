@@ -27,6 +27,7 @@ THE SOFTWARE.
 #ifndef FLUSSPFERD_SPIDERMONKEY_ARGUMETNS_HPP
 #define FLUSSPFERD_SPIDERMONKEY_ARGUMETNS_HPP
 
+#include "root.hpp"
 #include <vector>
 #include <js/jsapi.h>
 
@@ -42,13 +43,18 @@ class arguments_impl {
   std::vector<jsval> values; // values from the user are added here
   std::size_t n;
   jsval *argv;
+  root_block roots; // roots values once push_root was used
 
 public:
-  arguments_impl(std::size_t n, jsval *argv) : n(n), argv(argv) { }
+  arguments_impl(std::size_t n, jsval *argv)
+    : n(n), argv(argv), roots(root_block::jsval_vector, &values)
+  { }
   arguments_impl(arguments_impl const &o);
 
 protected:
-  arguments_impl() : n(0), argv(0x0) {}
+  arguments_impl()
+    : n(0), argv(0x0), roots(root_block::jsval_vector, &values)
+  { }
   arguments_impl(std::vector<value> const &o);
 
 protected:
@@ -59,6 +65,7 @@ protected:
   std::vector<jsval> &data() { return values; }
   std::vector<jsval> const &data() const { return values; }
   void reset_argv();
+  void root_data() { roots.link_block(); }
 
   bool is_userprovided() const {
     return values.size() == n; // TODO does this fix the problem?
@@ -40,6 +40,17 @@ namespace Impl {
 JSContext *get_context(context &co);
 context wrap_context(JSContext *c);
 
+// Throws if the scripts of the context were stopped by its time limit.
+void check_time_limit(JSContext *cx);
+
+// Record a profiler sample of the stack every interval_ms (0 to stop).
+void set_sample_interval(JSContext *cx, double interval_ms);
+double get_sample_interval(JSContext *cx);
+
+// Record the current stack of cx, counted weight times. Defined in
+// profiler.cpp.
+void sample_stack(JSContext *cx, unsigned weight);
+
 }
 
 #endif
@@ -29,6 +29,8 @@ THE SOFTWARE.
 
 #include "../init.hpp"
 #include "context.hpp"
+#include "root.hpp"
+#include <boost/noncopyable.hpp>
 
 typedef struct JSContext JSContext;
 typedef struct JSRuntime JSRuntime;
@@ -45,6 +47,35 @@ inline JSContext *current_context() {
 
 JSRuntime *get_runtime();
 
+root_block::block_list &get_root_list();
+
+// Makes cx the current context for the duration of a native callback.
+// Callbacks nearly always run in the context that is already current, so
+// wrapping cx and swapping the current context is only done when needed.
+class callback_context_scope : boost::noncopyable {
+public:
+  explicit callback_context_scope(JSContext *cx)
+    : entered(false)
+  {
+    context &current = flusspferd::current_context();
+    if (!current.is_valid() || get_context(current) != cx) {
+      c = wrap_context(cx);
+      old = enter_current_context(c);
+      entered = true;
+    }
+  }
+
+  ~callback_context_scope() {
+    if (entered && leave_current_context(c) && old.is_valid())
+      enter_current_context(old);
+  }
+
+private:
+  bool entered;
+  context c;
+  context old;
+};
+
 }
 
 #endif
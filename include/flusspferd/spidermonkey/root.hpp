@@ -0,0 +1,133 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_SPIDERMONKEY_ROOT_HPP
+#define FLUSSPFERD_SPIDERMONKEY_ROOT_HPP
+
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+
+namespace flusspferd {
+
+#ifndef IN_DOXYGEN
+
+namespace Impl {
+
+/*
+ * A block of GC roots.
+ *
+ * Linked blocks form a list per runtime which is traced as a whole by the
+ * garbage collector, so registering a block is a couple of pointer writes
+ * instead of an insertion into the engine's root table. A block refers to
+ * a single slot or to a whole vector of values.
+ */
+class root_block : private boost::noncopyable {
+public:
+  enum kind_type {
+    value_slot,   // jsval *
+    object_slot,  // JSObject **
+    string_slot,  // JSString **
+    value_vector, // std::vector<flusspferd::value> *
+    jsval_vector  // std::vector<jsval> *
+  };
+
+  root_block(kind_type kind, void *data)
+    : block_kind(kind), block_data(data), block_prev(0), block_next(0)
+  { }
+
+  ~root_block() {
+    unlink_block();
+  }
+
+  // Add the block to the current thread's list.
+  void link_block();
+
+  void unlink_block() {
+    if (block_prev) {
+      block_prev->block_next = block_next;
+      block_next->block_prev = block_prev;
+      block_prev = block_next = 0;
+    }
+  }
+
+  bool is_block_linked() const {
+    return block_prev;
+  }
+
+  // The list head of a runtime. Traces every block linked to it.
+  class block_list;
+
+private:
+  void trace_block(void *trc);
+  std::size_t block_size() const;
+
+  kind_type block_kind;
+  void *block_data;
+  root_block *block_prev;
+  root_block *block_next;
+};
+
+class root_block::block_list : private boost::noncopyable {
+public:
+  block_list() : head(value_slot, 0) {
+    head.block_prev = head.block_next = &head;
+  }
+
+  ~block_list() {
+    head.unlink_block();
+  }
+
+  void insert(root_block &b) {
+    b.block_prev = &head;
+    b.block_next = head.block_next;
+    head.block_next->block_prev = &b;
+    head.block_next = &b;
+  }
+
+  void trace(void *trc) {
+    for (root_block *b = head.block_next; b != &head; b = b->block_next)
+      b->trace_block(trc);
+  }
+
+  // The number of rooted values.
+  std::size_t size() const {
+    std::size_t n = 0;
+    for (root_block const *b = head.block_next; b != &head; b = b->block_next)
+      n += b->block_size();
+    return n;
+  }
+
+private:
+  root_block head;
+};
+
+}
+
+#endif
+
+}
+
+#endif /* FLUSSPFERD_SPIDERMONKEY_ROOT_HPP */
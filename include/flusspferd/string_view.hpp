@@ -0,0 +1,163 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_STRING_VIEW_HPP
+#define FLUSSPFERD_STRING_VIEW_HPP
+
+#include "string.hpp"
+#include "convert.hpp"
+#include "exception.hpp"
+#include <cstddef>
+#include <string>
+
+namespace flusspferd {
+
+/**
+ * A borrowed view of the characters of a Javascript string.
+ *
+ * Use this as the parameter type of native functions that only need to
+ * look at a string argument. Unlike std::string, no copy or conversion to
+ * UTF-8 is made: the view refers to the engine's own UTF-16 buffer. It is
+ * therefore only valid as long as the string it was taken from, which for
+ * arguments is the duration of the call. As an argument type it only accepts
+ * strings; other values raise a TypeError rather than being converted.
+ *
+ * @ingroup value_types
+ */
+class string_view {
+public:
+  /// Iterator over the UTF-16 words.
+  typedef js_char16_t const *const_iterator;
+
+  /// Construct an empty view.
+  string_view() : ptr(0), len(0) {}
+
+  /**
+   * Construct a view of a UTF-16 buffer.
+   *
+   * @param data The buffer.
+   * @param length The length in UTF-16 words.
+   */
+  string_view(js_char16_t const *data, std::size_t length)
+    : ptr(data), len(length)
+  {}
+
+  /**
+   * Construct a view of a string.
+   *
+   * @param s The string. It must outlive the view.
+   */
+  string_view(string const &s) : ptr(s.data()), len(s.length()) {}
+
+  /// The UTF-16 buffer (not 0-terminated).
+  js_char16_t const *data() const { return ptr; }
+
+  /// The length in UTF-16 words.
+  std::size_t length() const { return len; }
+
+  /// The length in UTF-16 words.
+  std::size_t size() const { return len; }
+
+  /// Check if the view is empty.
+  bool empty() const { return !len; }
+
+  /// Iterator to the first UTF-16 word.
+  const_iterator begin() const { return ptr; }
+
+  /// Iterator past the last UTF-16 word.
+  const_iterator end() const { return ptr + len; }
+
+  /// Get the UTF-16 word at index @p i.
+  js_char16_t operator[](std::size_t i) const { return ptr[i]; }
+
+  /**
+   * Compare with an ASCII string, without converting the view.
+   *
+   * @param ascii The 0-terminated ASCII string.
+   * @return Whether both contain the same characters.
+   */
+  bool equals(char const *ascii) const {
+    std::size_t i = 0;
+    for (; i < len && ascii[i]; ++i)
+      if (ptr[i] != js_char16_t((unsigned char) ascii[i]))
+        return false;
+    return i == len && !ascii[i];
+  }
+
+  /**
+   * Copy to a UTF-8 std::string.
+   *
+   * @return The converted string.
+   */
+  std::string to_string() const {
+    return string(ptr, len).to_string();
+  }
+
+  /**
+   * Copy to a UTF-16 std::basic_string.
+   *
+   * @return The copy.
+   */
+  std::basic_string<js_char16_t> to_utf16_string() const {
+    return std::basic_string<js_char16_t>(ptr, len);
+  }
+
+private:
+  js_char16_t const *ptr;
+  std::size_t len;
+};
+
+#ifndef IN_DOXYGEN
+
+namespace detail {
+
+template<>
+struct convert<string_view> {
+  struct to_value {
+    value perform(string_view const &s) {
+      return string(s.data(), s.length());
+    }
+  };
+
+  struct from_value {
+    string_view perform(value const &v) {
+      // Only real strings: they are kept alive by the caller for the
+      // duration of the call. A converted string would have nothing rooting
+      // it per call, as the converter lives as long as the function.
+      if (!v.is_string())
+        throw exception("Expected a string", "TypeError");
+      return string_view(v.get_string());
+    }
+  };
+};
+
+}
+
+#endif
+
+}
+
+#endif /* FLUSSPFERD_STRING_VIEW_HPP */
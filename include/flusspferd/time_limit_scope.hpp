@@ -0,0 +1,84 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_TIME_LIMIT_SCOPE_HPP
+#define FLUSSPFERD_TIME_LIMIT_SCOPE_HPP
+
+#include "flusspferd/init.hpp"
+#include "flusspferd/context.hpp"
+#include <boost/noncopyable.hpp>
+
+namespace flusspferd {
+
+/**
+ * Limit the run time of scripts for as long as the object exists.
+ *
+ * @verbatim
+try {
+  time_limit_scope limit(100); // 100 ms
+  evaluate(untrusted_source);
+} catch (flusspferd::exception &e) {
+  // the script threw, or was stopped after 100 ms
+}
+@endverbatim
+ *
+ * Time limits do not nest: a time_limit_scope replaces any limit set before
+ * and removes it when destroyed.
+ *
+ * @see context::set_time_limit
+ *
+ * @ingroup contexts
+ */
+class time_limit_scope : private boost::noncopyable {
+private:
+  context c;
+
+public:
+  /**
+   * Constructor.
+   *
+   * @param wall_ms Limit of the wall-clock time in milliseconds, 0 for none.
+   * @param cpu_ms Limit of the CPU time in milliseconds, 0 for none.
+   * @param c The context to limit.
+   */
+  time_limit_scope(
+      double wall_ms, double cpu_ms = 0, context const &c = current_context())
+    : c(c)
+  {
+    this->c.set_time_limit(wall_ms, cpu_ms);
+  }
+
+  /**
+   * Destructor.
+   */
+  ~time_limit_scope() {
+    c.clear_time_limit();
+  }
+};
+
+}
+
+#endif /* FLUSSPFERD_TIME_LIMIT_SCOPE_HPP */
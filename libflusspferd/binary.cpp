@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include "flusspferd/create/native_object.hpp"
 #include <sstream>
 #include <algorithm>
+#include <cstring>
 #include <boost/ref.hpp>
 #include <boost/fusion/include/make_vector.hpp>
 
@@ -44,29 +45,82 @@ void flusspferd::load_binary_module(object container) {
   load_class<binary>(exports);
   load_class<byte_string>(exports);
   load_class<byte_array>(exports);
+  load_class<float64_buffer>(exports);
   container.call("require", "encodings");
 }
 
 // -- util ------------------------------------------------------------------
 
-static int get_byte(value byte_) {
-  int byte;
+// Returns the error message if byte_ is not a valid byte.
+static char const *check_byte(value byte_, int &byte) {
   if (byte_.is_int()) {
     byte = byte_.get_int();
     if (byte < 0 || byte > 255)
-      throw exception("Byte is outside the valid range for bytes");
-    return byte;
+      return "Byte is outside the valid range for bytes";
+    return 0;
   }
   object byte_o = byte_.to_object();
-  if (byte_o.is_null())
-    throw exception("Not a valid byte");
+  if (byte_o.is_null() || !flusspferd::is_native<binary>(byte_o))
+    return "Not a valid byte";
   binary &byte_bin = flusspferd::get_native<binary>(byte_o);
   if (byte_bin.get_length() != 1)
-    throw exception("Byte must not be a non single-element Binary");
+    return "Byte must not be a non single-element Binary";
   byte = byte_bin.get_const_data()[0];
+  return 0;
+}
+
+static int get_byte(value byte_) {
+  int byte;
+  if (char const *error = check_byte(byte_, byte))
+    throw exception(error);
   return byte;
 }
 
+// For code called from Javascript only: reports invalid bytes with
+// set_pending_error() instead of throwing, so the search methods stay cheap
+// when scripts probe them with arbitrary values.
+static bool get_byte_pending(value byte_, int &byte) {
+  if (char const *error = check_byte(byte_, byte)) {
+    set_pending_error(error);
+    return false;
+  }
+  return true;
+}
+
+static int find_byte(
+  binary::vector_type const &v, int byte,
+  boost::optional<int> start_, boost::optional<int> stop_)
+{
+  int start = start_.get_value_or(0);
+  if (start < 0)
+    start = 0;
+  int stop = stop_.get_value_or(v.size() - 1);
+  if (std::size_t(stop) >= v.size())
+    stop = v.size() - 1;
+
+  for (; start <= stop; ++start)
+    if (v[start] == byte)
+      return start;
+  return -1;
+}
+
+static int rfind_byte(
+  binary::vector_type const &v, int byte,
+  boost::optional<int> start_, boost::optional<int> stop_)
+{
+  int start = start_.get_value_or(0);
+  if (start < 0)
+    start = 0;
+  int stop = stop_.get_value_or(v.size() - 1);
+  if (std::size_t(stop) >= v.size())
+    stop = v.size() - 1;
+
+  for (; start <= stop; --stop)
+    if (v[stop] == byte)
+      return stop;
+  return -1;
+}
+
 // -- binary ----------------------------------------------------------------
 
 binary::binary(object const &o, call_context &x)
@@ -85,6 +139,7 @@ binary::binary(object const &o, call_context &x)
     if (i > 2147483647)
       throw exception("Cannot create binary larger than 2147483647 bytes");
     v_data.resize(i);
+    update_external_bytes();
     return;
   }
 
@@ -94,11 +149,13 @@ binary::binary(object const &o, call_context &x)
     if (o.is_array()) {
       convert<vector_type>::from_value conv;
       conv.perform(o).swap(v_data);
+      update_external_bytes();
       return;
     } else {
       try {
         binary &b = flusspferd::get_native<binary>(o);
         v_data = b.v_data;
+        update_external_bytes();
         return;
       } catch (flusspferd::exception&) {
       }
@@ -120,11 +177,15 @@ binary::binary(object const &o, call_context &x)
 
 binary::binary(object const &o, binary const &b)
   : base_type(o), v_data(b.v_data)
-{}
+{
+  update_external_bytes();
+}
 
 binary::binary(object const &o, element_type const *p, std::size_t n)
   : base_type(o), v_data(p, p + n)
-{}
+{
+  update_external_bytes();
+}
 
 void binary::augment_prototype(object &proto) {
   static const char* js_iterator =
@@ -199,22 +260,33 @@ void binary::property_op(property_mode mode, value const &id, value &x) {
     x = element(v_data[index]);
     break;
   case property_set:
-    v_data[index] = get_byte(x);
+    {
+      int byte;
+      if (get_byte_pending(x, byte))
+        v_data[index] = byte;
+    }
     break;
   default: break;
   };
 }
 
 binary::vector_type &binary::get_data() {
+  // Catch up with changes made through an earlier reference
+  update_external_bytes();
   return v_data;
 }
 
+void binary::update_external_bytes() {
+  external_bytes.update(v_data.capacity() * sizeof(element_type));
+}
+
 std::size_t binary::get_length() {
   return v_data.size();
 }
 
 std::size_t binary::set_length(std::size_t n) {
   v_data.resize(n);
+  update_external_bytes();
   return v_data.size();
 }
 
@@ -229,35 +301,31 @@ array binary::to_array() {
 int binary::index_of(
   value byte_, boost::optional<int> start_, boost::optional<int> stop_)
 {
-  int byte = get_byte(byte_);
-  int start = start_.get_value_or(0);
-  if (start < 0)
-    start = 0;
-  int stop = stop_.get_value_or(get_length() - 1);
-  if (std::size_t(stop) >= get_length())
-    stop = get_length() - 1;
-
-  for (; start <= stop; ++start)
-    if (v_data[start] == byte)
-      return start;
-  return -1;
+  return find_byte(v_data, get_byte(byte_), start_, stop_);
 }
 
 int binary::last_index_of(
   value byte_, boost::optional<int> start_, boost::optional<int> stop_)
 {
-  int byte = get_byte(byte_);
-  int start = start_.get_value_or(0);
-  if (start < 0)
-    start = 0;
-  int stop = stop_.get_value_or(get_length() - 1);
-  if (std::size_t(stop) >= get_length())
-    stop = get_length() - 1;
+  return rfind_byte(v_data, get_byte(byte_), start_, stop_);
+}
 
-  for (; start <= stop; --stop)
-    if (v_data[stop] == byte)
-      return stop;
-  return -1;
+int binary::js_index_of(
+  value byte_, boost::optional<int> start_, boost::optional<int> stop_)
+{
+  int byte;
+  if (!get_byte_pending(byte_, byte))
+    return -1;
+  return find_byte(v_data, byte, start_, stop_);
+}
+
+int binary::js_last_index_of(
+  value byte_, boost::optional<int> start_, boost::optional<int> stop_)
+{
+  int byte;
+  if (!get_byte_pending(byte_, byte))
+    return -1;
+  return rfind_byte(v_data, byte, start_, stop_);
 }
 
 byte_string &binary::byte_at(int offset) {
@@ -353,6 +421,7 @@ void binary::do_append(arguments &arg) {
       }
     }
   }
+  update_external_bytes();
 }
 
 array binary::split(value delim, object options) {
@@ -612,6 +681,7 @@ void byte_array::prepend(call_context &x) {
   tmp.swap(get_data());
   do_append(x.arg);
   get_data().insert(get_data().end(), tmp.begin(), tmp.end());
+  update_external_bytes();
   x.result = int(get_length());
 }
 
@@ -668,6 +738,7 @@ void byte_array::displace(call_context &x) {
     arg.push_back(x.arg[i]);
   do_append(arg);
   get_data().insert(get_data().end(), tmp.begin(), tmp.end());
+  update_external_bytes();
   x.result = int(get_length());
 }
 
@@ -714,6 +785,7 @@ byte_array &byte_array::filter(object callback, object thisObj) {
     if (callback.call(thisObj, v[i], i, *this).to_boolean())
       result.get_data().push_back(v[i]);
   }
+  result.update_external_bytes();
 
   return result;
 }
@@ -834,3 +906,130 @@ std::string byte_array::to_source() {
   out << "]))";
   return out.str();
 }
+
+// -- float64_buffer --------------------------------------------------------
+
+float64_buffer::float64_buffer(object const &o, call_context &x)
+  : base_type(o)
+{
+  value data = x.arg[0];
+  if (data.is_undefined_or_null())
+    return;
+
+  if (data.is_number()) {
+    if (!data.is_int() || data.get_int() < 0)
+      throw exception("Float64Buffer size must be a non-negative integer");
+    v_data.resize(data.get_int());
+    update_external_bytes();
+    return;
+  }
+
+  if (data.is_object()) {
+    object obj = data.get_object();
+
+    if (flusspferd::is_native<binary>(obj)) {
+      // Packed doubles in native byte order, as written by toByteArray.
+      binary::vector_type &bytes =
+        flusspferd::get_native<binary>(obj).get_data();
+      if (bytes.size() % sizeof(element_type))
+        throw exception(
+          "Binary length is not a multiple of the size of a double");
+      v_data.resize(bytes.size() / sizeof(element_type));
+      if (!bytes.empty())
+        std::memcpy(&v_data[0], &bytes[0], bytes.size());
+      update_external_bytes();
+      return;
+    }
+  }
+
+  // Arrays and other Float64Buffers.
+  detail::convert_bulk::to_numbers(data, v_data);
+  update_external_bytes();
+}
+
+float64_buffer::float64_buffer(object const &o, vector_type const &data)
+  : base_type(o), v_data(data)
+{
+  update_external_bytes();
+}
+
+bool float64_buffer::property_resolve(value const &id, unsigned /*flags*/) {
+  if (!id.is_int())
+    return false;
+
+  int uid = id.get_int();
+
+  if (uid < 0 || size_t(uid) >= v_data.size())
+    return false;
+
+  define_property(id.to_string(), value(v_data[uid]),
+                  permanent_shared_property);
+  return true;
+}
+
+void float64_buffer::property_op(
+    property_mode mode, value const &id, value &x)
+{
+  if (!id.is_int()) {
+    this->native_object_base::property_op(mode, id, x);
+    return;
+  }
+
+  int index = id.get_int();
+
+  if (index < 0 || std::size_t(index) >= v_data.size())
+    throw exception("Out of bounds of Float64Buffer");
+
+  switch (mode) {
+  case property_get:
+    x = v_data[index];
+    break;
+  case property_set:
+    v_data[index] = x.is_int() ? x.get_int() : x.to_number();
+    break;
+  default: break;
+  };
+}
+
+float64_buffer::vector_type &float64_buffer::get_data() {
+  update_external_bytes();
+  return v_data;
+}
+
+void float64_buffer::update_external_bytes() {
+  external_bytes.update(v_data.capacity() * sizeof(element_type));
+}
+
+std::size_t float64_buffer::get_length() {
+  return v_data.size();
+}
+
+std::size_t float64_buffer::set_length(std::size_t n) {
+  v_data.resize(n);
+  update_external_bytes();
+  return v_data.size();
+}
+
+double float64_buffer::get(int index) {
+  if (index < 0 || std::size_t(index) >= v_data.size())
+    throw exception("Index outside range", "RangeError");
+  return v_data[index];
+}
+
+void float64_buffer::set(int index, double x) {
+  if (index < 0 || std::size_t(index) >= v_data.size())
+    throw exception("Index outside range", "RangeError");
+  v_data[index] = x;
+}
+
+array float64_buffer::to_array() {
+  return array(value(v_data).to_object());
+}
+
+object float64_buffer::to_byte_array() {
+  binary::element_type const *p = 0;
+  if (!v_data.empty())
+    p = reinterpret_cast<binary::element_type const *>(&v_data[0]);
+  return flusspferd::create<byte_array>(
+    fusion::make_vector(p, v_data.size() * sizeof(element_type)));
+}
@@ -0,0 +1,90 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "flusspferd/context_pool.hpp"
+#include "flusspferd/create/object.hpp"
+#include "flusspferd/evaluate.hpp"
+#include "flusspferd/load_core.hpp"
+#include "flusspferd/security.hpp"
+
+using namespace flusspferd;
+
+context_pool::context_pool(
+  std::size_t size, std::string const &argv0, setup_function const &setup)
+  : argv0(argv0), setup(setup)
+{
+  contexts.reserve(size);
+  free_list.reserve(size);
+  for (std::size_t i = 0; i < size; ++i)
+    free_list.push_back(add_context());
+}
+
+context_pool::~context_pool() {
+}
+
+std::size_t context_pool::add_context() {
+  context c = context::create();
+  {
+    current_context_scope scope(c);
+    object g = c.global();
+    security::create(g);
+    load_core(g, argv0);
+    if (setup)
+      setup(g);
+  }
+  contexts.push_back(c);
+  return contexts.size() - 1;
+}
+
+std::size_t context_pool::take() {
+  if (free_list.empty())
+    return add_context();
+  std::size_t index = free_list.back();
+  free_list.pop_back();
+  return index;
+}
+
+void context_pool::give_back(std::size_t index) {
+  free_list.push_back(index);
+}
+
+context_pool::lease::lease(context_pool &pool)
+  : pool(pool),
+    index(pool.take()),
+    current(pool.contexts[index]),
+    scope_(create<object>(param::_prototype = global()))
+{
+}
+
+context_pool::lease::~lease() {
+  pool.give_back(index);
+}
+
+value context_pool::lease::evaluate(
+  std::string const &source, char const *file, unsigned line)
+{
+  return evaluate_in_scope(source, file, line, scope_);
+}
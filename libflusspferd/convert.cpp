@@ -34,8 +34,11 @@ value convert_container_base::to_value::start() {
   return create<array>();
 }
 
-void convert_container_base::to_value::add(value obj, value el) {
-  obj.to_object().call("push", el);
+void convert_container_base::to_value::set(
+    value obj, std::size_t i, value el)
+{
+  array arr(obj.get_object());
+  arr.set_element(i, el);
 }
 
 std::size_t convert_container_base::from_value::length(value obj_v) {
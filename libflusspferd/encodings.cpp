@@ -30,6 +30,7 @@ THE SOFTWARE.
 #include <iconv.h>
 #include <errno.h>
 #include <sstream>
+#include <stdexcept>
 #include <boost/algorithm/string.hpp>
 #include <boost/ref.hpp>
 #include <boost/fusion/include/make_vector.hpp>
@@ -66,6 +67,105 @@ static js_char16_t const bom_native = 0xfeff;
 static char const * const native_charset = bom_le == bom_native
                                          ? "utf-16le" : "utf-16be";
 
+namespace {
+  enum iconv_status {
+    iconv_complete,
+    iconv_incomplete,
+    iconv_invalid,
+    iconv_failed
+  };
+}
+
+// Convert len bytes at in and append the result to out, growing it as
+// needed. On return len is the number of bytes left at the end of the input,
+// i.e. the start of an incomplete multi-byte sequence. Uses no JS state.
+static iconv_status iconv_append(
+  iconv_t conv,
+  binary::element_type const *in, std::size_t &len,
+  binary::vector_type &out)
+{
+  if (len == 0)
+    return iconv_complete;
+
+#ifdef ICONV_ACCEPTS_NONCONST_INPUT
+  char *inbuf = const_cast<char *>(reinterpret_cast<char const *>(in));
+#else
+  char const *inbuf = reinterpret_cast<char const *>(in);
+#endif
+
+  // A rough guess how much space might be needed for the new characters.
+  std::size_t estimate = len + len/16 + 32;
+
+  std::size_t used = out.size();
+
+  for (;;) {
+    out.resize(used + estimate);
+
+    char *outbuf = reinterpret_cast<char*>(&out[used]);
+    std::size_t outbytesleft = estimate;
+
+    std::size_t n_chars = iconv(conv, &inbuf, &len, &outbuf, &outbytesleft);
+
+    used += estimate - outbytesleft;
+    out.resize(used);
+
+    if (n_chars != std::size_t(-1))
+      return iconv_complete;
+
+    switch (errno) {
+    case E2BIG:
+      estimate *= 2;
+      break;
+    case EINVAL:
+      return iconv_incomplete;
+    case EILSEQ:
+      return iconv_invalid;
+    default:
+      return iconv_failed;
+    }
+  }
+}
+
+// Append the sequence returning conv to its initial state.
+static bool iconv_finish(iconv_t conv, binary::vector_type &out) {
+  std::size_t start = out.size();
+  // 32 bytes should suffice for the initial state shift
+  std::size_t outlen = 32;
+  out.resize(start + outlen);
+  char *outbuf = reinterpret_cast<char*>(&out[start]);
+  bool ok = iconv(conv, 0, 0, &outbuf, &outlen) != std::size_t(-1);
+  out.resize(out.size() - outlen);
+  return ok;
+}
+
+void encodings::transcode_bytes(
+  std::string const &from, std::string const &to,
+  binary::vector_type const &in, binary::vector_type &out)
+{
+  iconv_t conv = iconv_open(to.c_str(), from.c_str());
+  if (conv == iconv_t(-1))
+    throw std::runtime_error(
+      "Could not convert from charset \"" + from + "\" "
+      "to charset \"" + to + "\"");
+
+  std::size_t left = in.size();
+  iconv_status status =
+    iconv_append(conv, in.empty() ? 0 : &in[0], left, out);
+  if (status == iconv_complete && !iconv_finish(conv, out))
+    status = iconv_failed;
+
+  iconv_close(conv);
+
+  switch (status) {
+  case iconv_complete:
+    break;
+  case iconv_incomplete:
+  case iconv_invalid:
+    throw std::runtime_error("Invalid multi-byte sequence in input");
+  default:
+    throw std::runtime_error("Unknown error in character conversion");
+  }
+}
 
 // JAVASCRIPT METHODS
 
@@ -189,6 +289,7 @@ binary &encodings::transcoder::push(
 
   append_accumulator(output);
   do_push(input, output.get_data());
+  output.update_external_bytes();
 
   return output;
 }
@@ -210,21 +311,15 @@ binary &encodings::transcoder::close(
   append_accumulator(output);
 
   if (p->conv != iconv_t(-1)) {
-    binary::vector_type &out_v = output.get_data();
-    std::size_t start = out_v.size();
-    // 32 bytes should suffice for the initial state shift
-    std::size_t outlen = 32;
-    out_v.resize(out_v.size() + outlen);
-    char *outbuf = reinterpret_cast<char*>(&out_v[start]);
-    if (iconv(p->conv, 0, 0, &outbuf, &outlen) == std::size_t(-1))
+    if (!iconv_finish(p->conv, output.get_data()))
       throw exception("Adding closing character sequence failed");
-    out_v.resize(out_v.size() - outlen);
 
     if (iconv_close(p->conv) == -1)
       throw exception("Closing character set conversion descriptor failed");
 
     p->conv = iconv_t(-1);
   }
+  output.update_external_bytes();
 
   return output;
 }
@@ -247,55 +342,19 @@ void encodings::transcoder::do_push(binary &input, binary::vector_type &out_v) {
   if (!p->multibyte_part.empty())
     in_v.insert(in_v.end(), input.get_data().begin(), input.get_data().end());
 
-  // A rough guess how much space might be needed for the new characters.
-  std::size_t out_estimate = in_v.size() + in_v.size()/16 + 32;
-
-  std::size_t out_start = out_v.size();
-
-  for (;;) {
-    out_v.resize(out_v.size() + out_estimate);
-
-#ifdef ICONV_ACCEPTS_NONCONST_INPUT
-    char *inbuf;
-#else
-    char const *inbuf;
-#endif
-
-    inbuf = reinterpret_cast<char *>(&in_v[0]);
-
-    char *outbuf = reinterpret_cast<char*>(&out_v[out_start]);
-
-    std::size_t inbytesleft = in_v.size();
-    std::size_t outbytesleft = out_estimate;
-
-    std::size_t n_chars = iconv(
-      p->conv,
-      &inbuf, &inbytesleft,
-      &outbuf, &outbytesleft);
-
-    if (n_chars == std::size_t(-1)) {
-      switch (errno) {
-      case EILSEQ:
-        throw exception("Invalid multi-byte sequence in input");
-
-      case E2BIG:
-        out_v.resize(out_v.size() - out_estimate);
-        out_estimate *= 2;
-        break;
-
-      case EINVAL:
-        p->multibyte_part.assign(outbuf, outbuf + outbytesleft);
-        out_v.resize(out_v.size() - outbytesleft);
-        return;
-
-      default:
-        throw exception("Unknown error in character conversion");
-      }
-    } else {
-      out_v.resize(out_v.size() - outbytesleft);
-      return;
-    }
+  std::size_t left = in_v.size();
+  switch (iconv_append(p->conv, in_v.empty() ? 0 : &in_v[0], left, out_v)) {
+  case iconv_invalid:
+    throw exception("Invalid multi-byte sequence in input");
+  case iconv_failed:
+    throw exception("Unknown error in character conversion");
+  default:
+    break;
   }
+
+  // Keep an incomplete sequence at the end for the next push.
+  binary::vector_type rest(in_v.end() - left, in_v.end());
+  p->multibyte_part.swap(rest);
 }
 
 void encodings::transcoder::append_accumulator(binary &output) {
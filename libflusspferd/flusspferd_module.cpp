@@ -26,11 +26,19 @@ THE SOFTWARE.
 
 #include "flusspferd/version.hpp"
 #include "flusspferd/load_core.hpp"
+#include "flusspferd/module_stats.hpp"
+#include "flusspferd/profiler.hpp"
+#include "flusspferd/native_call_stats.hpp"
+#include "flusspferd/create/object.hpp"
+#include "flusspferd/create/function.hpp"
+#include "flusspferd/create/array.hpp"
+#include "flusspferd/init.hpp"
 #include "flusspferd/io/filesystem-base.hpp"
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
 #include <boost/optional.hpp>
 #include <vector>
+#include <sstream>
 #include <stdlib.h>
 
 using namespace flusspferd;
@@ -39,6 +47,41 @@ namespace fs = boost::filesystem;
 using boost::optional;
 static optional<std::string> get_exe_name();
 static fs::path get_exe_name_from_argv(std::string const &argv0);
+static object get_module_stats();
+static object get_gc_stats();
+static value get_native_call_stats();
+static object create_profiler_object();
+
+
+static std::size_t get_max_heap_bytes();
+static void set_max_heap_bytes(std::size_t bytes);
+static std::size_t get_max_malloc_bytes();
+static void set_max_malloc_bytes(std::size_t bytes);
+static unsigned get_gc_trigger_factor();
+static void set_gc_trigger_factor(unsigned percent);
+static std::size_t get_stack_limit();
+static void set_stack_limit(std::size_t bytes);
+static std::size_t get_stack_chunk_size();
+
+// Define a property whose value is read (and written) by native functions
+template<typename Get>
+static void define_setting(object &exports, char const *name, Get *get) {
+  root_object getter(create<function>(name, get));
+  exports.define_property(
+    name,
+    property_attributes(permanent_property, getter));
+}
+
+template<typename Get, typename Set>
+static void define_setting(
+  object &exports, char const *name, Get *get, Set *set)
+{
+  root_object getter(create<function>(name, get));
+  root_object setter(create<function>(name, set));
+  exports.define_property(
+    name,
+    property_attributes(permanent_property, getter, setter));
+}
 
 void flusspferd::load_flusspferd_module(object container, std::string const &argv0) {
   object exports = container.get_property_object("exports");
@@ -89,6 +132,160 @@ void flusspferd::load_flusspferd_module(object container, std::string const &arg
     value( (prefix / REL_MODULES_PATH).string()),
     read_only_property | permanent_property);
 
+  create<function>(
+    "moduleStats", &get_module_stats,
+    param::_container = exports);
+
+  create<function>(
+    "gcStats", &get_gc_stats,
+    param::_container = exports);
+
+  create<function>(
+    "nativeCallStats", &get_native_call_stats,
+    param::_container = exports);
+
+  define_setting(exports, "maxHeapBytes",
+    &get_max_heap_bytes, &set_max_heap_bytes);
+
+  define_setting(exports, "maxMallocBytes",
+    &get_max_malloc_bytes, &set_max_malloc_bytes);
+
+  define_setting(exports, "gcTriggerFactor",
+    &get_gc_trigger_factor, &set_gc_trigger_factor);
+
+  define_setting(exports, "stackLimit",
+    &get_stack_limit, &set_stack_limit);
+
+  define_setting(exports, "stackChunkSize", &get_stack_chunk_size);
+
+  exports.define_property(
+    "profiler",
+    create_profiler_object(),
+    read_only_property | permanent_property);
+}
+
+object get_module_stats() {
+  return module_stats::get().to_object();
+}
+
+object get_gc_stats() {
+  gc_statistics stats = gc_stats();
+  object result = create<object>();
+  result.set_property("collections", double(stats.collections));
+  result.set_property("totalPause", stats.total_pause);
+  result.set_property("maxPause", stats.max_pause);
+  result.set_property("lastPause", stats.last_pause);
+  result.set_property("bytesSinceGC", double(stats.bytes_since_gc));
+  result.set_property("liveBytes", double(stats.live_bytes));
+  result.set_property("rootedValues", double(stats.rooted));
+  result.set_property("externalBytes", double(stats.external_bytes));
+  return result;
+}
+
+value get_native_call_stats() {
+  if (!native_call_stats::enabled())
+    return object();
+  return native_call_stats::get().to_object();
+}
+
+static void start_profiler(optional<double> interval) {
+  profiler::get().start(interval.get_value_or(profiler::default_interval));
+}
+
+static void stop_profiler() {
+  profiler::get().stop();
+}
+
+static void reset_profiler() {
+  profiler::get().reset();
+}
+
+static bool is_profiler_running() {
+  return profiler::get().is_running();
+}
+
+static unsigned long get_profiler_samples() {
+  return profiler::get().samples();
+}
+
+static std::string get_profiler_folded() {
+  std::ostringstream out;
+  profiler::get().write_folded(out);
+  return out.str();
+}
+
+static std::string get_profiler_summary(optional<unsigned> n) {
+  std::ostringstream out;
+  profiler::get().write_summary(out, n.get_value_or(20));
+  return out.str();
+}
+
+static array get_profiler_top(optional<unsigned> n) {
+  std::vector<profiler::function_samples> top =
+    profiler::get().top(n.get_value_or(20));
+  root_array result(create<array>());
+  BOOST_FOREACH(profiler::function_samples const &f, top) {
+    root_object entry(create<object>());
+    entry.set_property("frame", f.frame);
+    entry.set_property("self", double(f.self));
+    entry.set_property("total", double(f.total));
+    result.push(entry);
+  }
+  return result;
+}
+
+object create_profiler_object() {
+  root_object result(create<object>());
+
+  create<function>("start", &start_profiler, param::_container = result);
+  create<function>("stop", &stop_profiler, param::_container = result);
+  create<function>("reset", &reset_profiler, param::_container = result);
+  create<function>("folded", &get_profiler_folded, param::_container = result);
+  create<function>(
+    "summary", &get_profiler_summary, param::_container = result);
+  create<function>("top", &get_profiler_top, param::_container = result);
+
+  define_setting(result, "running", &is_profiler_running);
+  define_setting(result, "samples", &get_profiler_samples);
+
+  return result;
+}
+
+std::size_t get_max_heap_bytes() {
+  return init::initialize().get_max_bytes();
+}
+
+void set_max_heap_bytes(std::size_t bytes) {
+  init::initialize().set_max_bytes(bytes);
+}
+
+std::size_t get_max_malloc_bytes() {
+  return init::initialize().get_max_malloc_bytes();
+}
+
+void set_max_malloc_bytes(std::size_t bytes) {
+  init::initialize().set_max_malloc_bytes(bytes);
+}
+
+unsigned get_gc_trigger_factor() {
+  return init::initialize().get_gc_trigger_factor();
+}
+
+void set_gc_trigger_factor(unsigned percent) {
+  if (!init::initialize().set_gc_trigger_factor(percent))
+    throw exception("The GC trigger factor is not supported by this engine");
+}
+
+std::size_t get_stack_limit() {
+  return current_context().get_stack_limit();
+}
+
+void set_stack_limit(std::size_t bytes) {
+  current_context().set_stack_limit(bytes);
+}
+
+std::size_t get_stack_chunk_size() {
+  return current_context().get_stack_chunk_size();
 }
 
 bool flusspferd::is_relocatable() {
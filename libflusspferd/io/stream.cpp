@@ -97,6 +97,7 @@ object stream::read_whole_binary(boost::optional<byte_array&> output_) {
     data.resize(data.size() - N + length);
   } while (length > 0);
 
+  output.update_external_bytes();
   return output;
 }
 
@@ -137,6 +138,7 @@ object stream::read_binary(boost::optional<unsigned> size_opt, boost::optional<b
 
   data.resize(data.size() - size + length);
 
+  output.update_external_bytes();
   return output;
 }
 
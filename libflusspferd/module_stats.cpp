@@ -0,0 +1,282 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "flusspferd/module_stats.hpp"
+#include "flusspferd/create/object.hpp"
+#include "flusspferd/create/array.hpp"
+#include "flusspferd/string.hpp"
+#include "flusspferd/local_root_scope.hpp"
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/tss.hpp>
+#include <exception>
+#include <ostream>
+#include <vector>
+#include <cstdio>
+
+using namespace flusspferd;
+
+namespace {
+  static boost::thread_specific_ptr<module_stats> p_instance;
+
+  static char const * const phase_names[module_stats::num_phases] = {
+    "resolve", "read", "decode", "compile", "execute"
+  };
+
+  // Microseconds since the first call.
+  static double now() {
+    using namespace boost::posix_time;
+    static ptime const epoch(microsec_clock::universal_time());
+    return double((microsec_clock::universal_time() - epoch)
+                    .total_microseconds());
+  }
+
+  static std::size_t const no_module = std::size_t(-1);
+
+  struct record {
+    std::string id;
+    bool native;
+    bool failed;
+    bool cached;
+    double start;
+    double total;
+    double time[module_stats::num_phases];
+    std::size_t bytes_read;
+    std::size_t chars_decoded;
+    std::vector<std::string> dependencies;
+
+    record(std::string const &id, double start)
+      : id(id), native(false), failed(false), cached(false),
+        start(start), total(0),
+        bytes_read(0), chars_decoded(0)
+    {
+      for (int i = 0; i < module_stats::num_phases; ++i)
+        time[i] = 0;
+    }
+  };
+
+  struct event {
+    std::size_t index;
+    char const *category;
+    double start;
+    double duration;
+  };
+
+  static void write_json_string(std::ostream &out, std::string const &s) {
+    out << '"';
+    for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+      unsigned char c = *it;
+      if (c == '"' || c == '\\') {
+        out << '\\' << c;
+      } else if (c < 0x20) {
+        char buf[8];
+        std::sprintf(buf, "\\u%04x", c);
+        out << buf;
+      } else {
+        out << c;
+      }
+    }
+    out << '"';
+  }
+}
+
+class module_stats::impl {
+public:
+  std::vector<record> records;
+  std::vector<event> events;
+
+  // Indices into records of the modules currently being loaded.
+  std::vector<std::size_t> stack;
+
+  std::size_t current() const {
+    return stack.empty() ? no_module : stack.back();
+  }
+
+  void add_event(std::size_t index, char const *category,
+                 double start, double end)
+  {
+    event e = { index, category, start, end - start };
+    events.push_back(e);
+  }
+};
+
+module_stats &module_stats::get() {
+  if (!p_instance.get())
+    p_instance.reset(new module_stats);
+  return *p_instance;
+}
+
+module_stats::module_stats() : p(new impl) {}
+
+module_stats::~module_stats() {}
+
+module_stats::module_scope::module_scope(std::string const &id) {
+  impl &i = *get().p;
+  index = i.records.size();
+  i.records.push_back(record(id, now()));
+  i.stack.push_back(index);
+}
+
+module_stats::module_scope::~module_scope() {
+  impl &i = *get().p;
+  double const end = now();
+
+  record &r = i.records[index];
+
+  i.stack.pop_back();
+  std::size_t parent = i.current();
+  if (parent != no_module)
+    i.records[parent].dependencies.push_back(r.id);
+
+  // Cache hits only leave the dependency edge behind. Nothing can have been
+  // recorded after them, unless they were partially loaded before.
+  if (r.cached && (i.events.empty() || i.events.back().index != index)) {
+    i.records.pop_back();
+    return;
+  }
+
+  r.total = end - r.start;
+  r.failed = std::uncaught_exception();
+
+  // Whatever was not spent in one of the other phases went into finding the
+  // module.
+  double rest = r.total;
+  for (int ph = read; ph < num_phases; ++ph)
+    rest -= r.time[ph];
+  r.time[resolve] = rest > 0 ? rest : 0;
+
+  i.add_event(index, "module", r.start, end);
+}
+
+module_stats::phase_timer::phase_timer(phase which)
+  : which(which), index(get().p->current()), start(now())
+{}
+
+module_stats::phase_timer::~phase_timer() {
+  if (index == no_module)
+    return;
+
+  impl &i = *get().p;
+  double const end = now();
+
+  i.records[index].time[which] += end - start;
+  i.add_event(index, phase_names[which], start, end);
+}
+
+void module_stats::set_id(std::string const &id) {
+  std::size_t index = p->current();
+  if (index != no_module)
+    p->records[index].id = id;
+}
+
+void module_stats::set_native() {
+  std::size_t index = p->current();
+  if (index != no_module)
+    p->records[index].native = true;
+}
+
+void module_stats::add_bytes_read(std::size_t bytes) {
+  std::size_t index = p->current();
+  if (index != no_module)
+    p->records[index].bytes_read += bytes;
+}
+
+void module_stats::add_chars_decoded(std::size_t chars) {
+  std::size_t index = p->current();
+  if (index != no_module)
+    p->records[index].chars_decoded += chars;
+}
+
+void module_stats::set_cached(std::string const &id) {
+  std::size_t index = p->current();
+  if (index != no_module) {
+    p->records[index].id = id;
+    p->records[index].cached = true;
+  }
+}
+
+object module_stats::to_object() const {
+  local_root_scope scope;
+
+  object result = create<object>();
+
+  for (std::vector<record>::const_iterator it = p->records.begin();
+       it != p->records.end(); ++it)
+  {
+    object entry = create<object>();
+
+    entry.set_property("native", it->native);
+    entry.set_property("failed", it->failed);
+    entry.set_property("total", it->total / 1000);
+    for (int ph = 0; ph < num_phases; ++ph)
+      entry.set_property(phase_names[ph], it->time[ph] / 1000);
+    entry.set_property("bytesRead", double(it->bytes_read));
+    entry.set_property("charsDecoded", double(it->chars_decoded));
+
+    array deps = create<array>();
+    for (std::vector<std::string>::const_iterator dep =
+           it->dependencies.begin();
+         dep != it->dependencies.end(); ++dep)
+    {
+      deps.push(*dep);
+    }
+    entry.set_property("dependencies", deps);
+
+    result.set_property(it->id, entry);
+  }
+
+  return result;
+}
+
+void module_stats::write_trace(std::ostream &out) const {
+  out << "{\"traceEvents\":[";
+
+  bool first = true;
+  for (std::vector<event>::const_iterator it = p->events.begin();
+       it != p->events.end(); ++it)
+  {
+    record const &r = p->records[it->index];
+
+    if (!first)
+      out << ',';
+    first = false;
+
+    out << "\n{\"name\":";
+    write_json_string(out, r.id);
+    out << ",\"cat\":\"" << it->category << "\""
+        << ",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+        << ",\"ts\":" << static_cast<unsigned long>(it->start)
+        << ",\"dur\":" << static_cast<unsigned long>(it->duration);
+
+    if (std::string("module") == it->category) {
+      out << ",\"args\":{\"bytesRead\":" << r.bytes_read
+          << ",\"charsDecoded\":" << r.chars_decoded
+          << ",\"native\":" << (r.native ? "true" : "false") << "}";
+    }
+    out << '}';
+  }
+
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
@@ -25,6 +25,7 @@ THE SOFTWARE.
 */
 
 #include "flusspferd/modules.hpp"
+#include "flusspferd/module_stats.hpp"
 #include "flusspferd/create.hpp"
 #include "flusspferd/security.hpp"
 #include "flusspferd/evaluate.hpp"
@@ -44,7 +45,17 @@ THE SOFTWARE.
 #include <boost/spirit/include/phoenix.hpp>
 #include <boost/xpressive/xpressive.hpp>
 #include <boost/scope_exit.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/bind.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/noncopyable.hpp>
 #include <algorithm>
+#include <deque>
+#include <stdexcept>
 #include <cctype>
 
 #ifdef WIN32
@@ -76,6 +87,52 @@ static object module_resource(const fs::path &module_dir, std::string const &x_,
 // This function based largley on one from boost/program_options. See end of file for its license
 static array split_args_string(const value& input);
 
+static void require_prefetch(call_context &x);
+
+// Options from "// key: value" lines at the top of a module
+typedef std::vector<std::pair<std::string, std::string> > module_options;
+
+static std::string scan_module_header(
+  binary::vector_type const &buf, module_options &options);
+static void set_module_options(module_options const &options, object opts);
+
+// A module source read and decoded ahead of time by require.prefetch(). The
+// work happens on a background thread without touching any JS state; the
+// result is picked up by load_module_text on the thread owning the context.
+class prefetched_source : boost::noncopyable {
+public:
+  prefetched_source(fs::path const &path)
+    : path(path), bytes_read(0), done(false), ok(false)
+  {}
+
+  // Read and decode the file. Runs on a worker thread.
+  void run();
+
+  // Wait for run() to finish. Returns false if it failed.
+  bool wait();
+
+  // Give up on a source that will never be run.
+  void cancel();
+
+  fs::path const path;
+
+  // Only valid after wait()
+  std::size_t bytes_read;
+  module_options options;
+  binary::vector_type text;  // UTF-16 in native byte order
+
+private:
+  boost::mutex mutex;
+  boost::condition_variable cond;
+  bool done;
+  bool ok;
+};
+
+typedef boost::shared_ptr<prefetched_source> prefetched_source_ptr;
+
+static prefetched_source_ptr take_prefetched_source(fs::path const &path);
+static void start_prefetch(std::vector<fs::path> const &files);
+
 static const format load_error_fmt("Unable to load module '%1%': %2%");
 }
 
@@ -129,6 +186,11 @@ object require::create_require() {
   fn.define_property("preload", preload, perm_ro);
   fn.define_property("main", main, perm_ro);
 
+  create<function>(
+    "prefetch", &require_prefetch,
+    _container = fn,
+    _attributes = dont_enumerate);
+
   return fn;
 }
 
@@ -193,8 +255,11 @@ void require::call(call_context &x) {
 // paths a lot easier
 object require::call_helper(std::string const &id_) {
 
+  module_stats::module_scope stats_scope(id_);
+
   // If what ever they require is already loaded, give it to them
   if (module_cache.has_own_property(id_)) {
+    module_stats::get().set_cached(id_);
     return module_cache.get_property_object(id_);
   }
 
@@ -212,11 +277,34 @@ object require::call_helper(std::string const &id_) {
 
 
 string require::load_module_text(fs::path filename, boost::optional<object> opts) {
-  root_string read_only("r");
+  module_stats &stats = module_stats::get();
+
+  // Use the text read by require.prefetch() if there is any. If reading it
+  // failed, go the normal route to get the proper error.
+  prefetched_source_ptr source = take_prefetched_source(filename);
+  bool prefetched = false;
+  if (source) {
+    module_stats::phase_timer timer(module_stats::read);
+    prefetched = source->wait();
+  }
+
+  if (prefetched) {
+    stats.add_bytes_read(source->bytes_read);
+
+    module_stats::phase_timer timer(module_stats::decode);
+
+    if (opts)
+      set_module_options(source->options, *opts);
 
-  io::file &f = create<io::file>(
-    fusion::vector2<char const*, string>(filename.string().c_str(), read_only));
-  root_object f_o(f);
+    if (source->text.empty())
+      return string();
+
+    string text(
+      reinterpret_cast<js_char16_t const *>(&source->text[0]),
+      source->text.size() / sizeof(js_char16_t));
+    stats.add_chars_decoded(text.length());
+    return text;
+  }
 
   // buffer blob
   byte_array &blob = create<byte_array>(
@@ -224,89 +312,82 @@ string require::load_module_text(fs::path filename, boost::optional<object> opts
   root_object b_o(blob);
   binary::vector_type &buf = blob.get_data();
 
-  // Look for a shebang line
-  f.read_binary(2, blob);
-
-  binary::vector_type::iterator i, s;
-
-  if (buf[0] == '#' && buf[1] == '!') {
-    // Shebang line - skip the line, but insert a comment line here to keep
-    // source line numbers right
-    buf.clear();
-    buf.push_back('/');
-    buf.push_back('/');
-  }
-  f.read_whole_binary(blob);
-
+  {
+    module_stats::phase_timer timer(module_stats::read);
 
-  // Look for coding and option lines. An coding line looks like one of
-  // "// -*- coding:utf-8 -*-"
-  // "// vim:fileencoding=utf-8:"
-  //
-  // An option line looks like
-  // "// flusspferd: -xboo"
-  //
-  // We continue looking until we see a blank comment or a non comment line
+    root_string read_only("r");
 
-  using namespace boost::xpressive;
-  sregex opt_re = sregex::compile("^\\s*([-\\w.]+):\\s*(.*)$");
-  sregex coding_re = sregex::compile("^.*coding[:=]\\s*([-\\w.]+)");
-  sregex empty_line_re = bos >> *_s >> eos;
+    io::file &f = create<io::file>(
+      fusion::vector2<char const*, string>(filename.string().c_str(), read_only));
+    root_object f_o(f);
 
-  // We only want to look for a coding comment on line 1 or 2
-  int look_for_coding = 2;
-  std::string encoding = "UTF-8";
+    // Look for a shebang line
+    f.read_binary(2, blob);
 
-  for (i = buf.begin(); i != buf.end(); ++i) {
-    if (*(i++) != '/' || *(i++) != '/') {
-      // Not a comment line - stop!
-      break;
+    if (buf[0] == '#' && buf[1] == '!') {
+      // Shebang line - skip the line, but insert a comment line here to keep
+      // source line numbers right
+      buf.clear();
+      buf.push_back('/');
+      buf.push_back('/');
     }
-    binary::vector_type::iterator e;
-    e = std::find(i, buf.end(), '\n');
-    if (e == buf.end())
-      break;
+    f.read_whole_binary(blob);
 
-    std::string line( reinterpret_cast<char const *>(&*i), std::size_t(e-i) );
+    stats.add_bytes_read(buf.size());
+  }
 
-    // Move onto next line
-    i = e;
+  module_stats::phase_timer timer(module_stats::decode);
 
-    smatch m;
-    if (look_for_coding-- && regex_match(line, m, coding_re)) {
-      // Huzzah! We have an encoding!
-      encoding = m[1];
-      look_for_coding = 0;
+  module_options options;
+  std::string const encoding = scan_module_header(buf, options);
 
-      continue;
-    }
+  if (opts)
+    set_module_options(options, *opts);
 
-    // Empty comment line - stop looking
-    if (regex_match(line, empty_line_re))
-      break;
+  string text = encodings::convert_to_string(encoding, blob);
+  stats.add_chars_decoded(text.length());
+  return text;
+}
 
-    if (opts && regex_match(line, m, opt_re)) {
-      // A line we are interested in, and we have somewhere to store the result
-      opts->set_property(m[1].str(), m[2].str());
-    }
-  }
+// require.prefetch([ids])
+void require::prefetch(array const &ids) {
+  security &sec = security::get();
 
-  // If we have "flusspferd" or "warnings" in the option, split them on
-  // whitespace like shells do. TODO: Should we just split everything?
-  if (opts) {
-    value v = opts->get_property("flusspferd");
-    if (v.is_string()) {
-      opts->set_property( "flusspferd", split_args_string(v) );
+  std::vector<fs::path> files;
+
+  std::size_t const len = ids.length();
+  for (std::size_t i = 0; i < len; ++i) {
+    std::string const id = ids.get_element(i).to_std_string();
+
+    boost::optional<fs::path> path;
+
+    switch (classify_id(id)) {
+      default:
+      case top_level:
+        if (module_cache.has_own_property(id) ||
+            alias.has_own_property(id) ||
+            preload.has_own_property(id))
+          continue;
+        path = find_top_level_js_module(id, false);
+        break;
+      case relative:
+        path = io::fs_base::canonicalize(
+          fs::path(current_id().substr(sizeof("file://")-1)).parent_path()
+            / (id + ".js"));
+        break;
+      case fully_qualified:
+        path = io::fs_base::canonicalize(id.substr(sizeof("file://")-1));
+        break;
     }
 
-    v = opts->get_property("warnings");
-    if (v.is_string()) {
-      opts->set_property( "warnings", split_args_string(v) );
-    }
-  }
+    if (!path || module_cache.has_own_property("file://" + path->string()))
+      continue;
 
-  return encodings::convert_to_string(encoding, blob);
+    if (sec.check_path(path->string(), security::READ) && fs::exists(*path))
+      files.push_back(*path);
+  }
 
+  start_prefetch(files);
 }
 
 /// Load the given @c filename as a module
@@ -317,6 +398,8 @@ void require::require_js(fs::path filename, std::string const &id, object cache)
     flusspferd::current_context().set_strict(old_strict);
   } BOOST_SCOPE_EXIT_END;
 
+  module_stats::get().set_id(id);
+
   root_string module_text(load_module_text(filename, cache.get_property_object("options")));
 
   std::vector<std::string> argnames;
@@ -325,12 +408,16 @@ void require::require_js(fs::path filename, std::string const &id, object cache)
   argnames.push_back("module");
 
   std::string fname = filename.string();
-  root_object fn(create<function>(
-      _name = fname,
-      _argument_names = argnames,
-      _function = module_text,
-      _file = fname.c_str(),
-      _line = 1ul));
+  root_object fn;
+  {
+    module_stats::phase_timer timer(module_stats::compile);
+    fn = create<function>(
+        _name = fname,
+        _argument_names = argnames,
+        _function = module_text,
+        _file = fname.c_str(),
+        _line = 1ul);
+  }
 
   root_object module;
 
@@ -347,6 +434,7 @@ void require::require_js(fs::path filename, std::string const &id, object cache)
 
   root_object require(new_require_function(id));
 
+  module_stats::phase_timer timer(module_stats::execute);
   fn.call(fn, cache.get_property("exports"), require, module);
 }
 
@@ -394,10 +482,14 @@ object require::load_relative_module(std::string id) {
 
 
   // If either of the JS or DSO is already cached then just return it
-  if (module_cache.has_own_property(id) )
+  if (module_cache.has_own_property(id) ) {
+    module_stats::get().set_cached(id);
     return module_cache.get_property_object(id);
-  else if (module_cache.has_own_property(dso_id) )
+  }
+  else if (module_cache.has_own_property(dso_id) ) {
+    module_stats::get().set_cached(dso_id);
     return module_cache.get_property_object(dso_id);
+  }
 
   bool js = false, dso = false;
   security &sec = security::get();
@@ -430,8 +522,28 @@ object require::load_relative_module(std::string id) {
 }
 
 namespace {
-static void load_native_module(fs::path const &dso_name, object exports) {
-  std::string const &fullpath = dso_name.string();
+// DSOs are never unloaded, so the entry point of a module only has to be
+// looked up once per process. Further contexts (or threads) requiring the
+// same module skip the dlopen/dlsym round trip and only run the loader.
+typedef boost::unordered_map<std::string, flusspferd_load_t> dso_cache_t;
+
+static dso_cache_t &dso_cache() {
+  static dso_cache_t cache;
+  return cache;
+}
+
+static boost::mutex &dso_cache_mutex() {
+  static boost::mutex mutex;
+  return mutex;
+}
+
+static flusspferd_load_t find_native_loader(std::string const &fullpath) {
+  boost::mutex::scoped_lock lock(dso_cache_mutex());
+
+  dso_cache_t::const_iterator it = dso_cache().find(fullpath);
+  if (it != dso_cache().end())
+    return it->second;
+
 #ifdef WIN32
   HMODULE module = LoadLibrary(fullpath.c_str());
 
@@ -444,7 +556,8 @@ static void load_native_module(fs::path const &dso_name, object exports) {
   if (!symbol)
     throw exception(format(load_error_fmt) % fullpath % "symbol not found");
 #else
-  // Load the .so
+  // Load the .so. Symbols are bound lazily, so only the functions a module
+  // actually calls get resolved.
   void *module = dlopen(fullpath.c_str(), RTLD_LAZY);
   if (!module) {
     throw exception(format(load_error_fmt) % fullpath % dlerror());
@@ -463,7 +576,23 @@ static void load_native_module(fs::path const &dso_name, object exports) {
 
   flusspferd_load_t func = *(flusspferd_load_t*) &symbol;
 
+  dso_cache()[fullpath] = func;
+
+  return func;
+}
+
+static void load_native_module(fs::path const &dso_name, object exports) {
+  module_stats &stats = module_stats::get();
+  stats.set_native();
+
+  flusspferd_load_t func;
+  {
+    module_stats::phase_timer timer(module_stats::read);
+    func = find_native_loader(dso_name.string());
+  }
+
   root_object context(global());
+  module_stats::phase_timer timer(module_stats::execute);
   func(exports, context);
 }
 }
@@ -507,7 +636,10 @@ object require::load_top_level_module(std::string const &id) {
       ctx.set_parent(classes_object);
       ctx.set_property("exports", cache.get_property("exports"));
 
-      o.call(ctx);
+      {
+        module_stats::phase_timer timer(module_stats::execute);
+        o.call(ctx);
+      }
       scope_guard.exit_cleanly();
 
       return cache;
@@ -526,6 +658,7 @@ object require::load_top_level_module(std::string const &id) {
     std::string new_id = "file://" + native_path.string();
     if (module_cache.has_own_property(new_id)) {
       // This dso is already cached.
+      module_stats::get().set_cached(new_id);
       cache = module_cache.get_property_object(new_id);
       // Cache it under the top level name
       module_cache.set_property(id, cache);
@@ -551,6 +684,7 @@ object require::load_top_level_module(std::string const &id) {
     // Check if we loaded something by this name previously, even if the file
     // doesn't exist anymore
     if (module_cache.has_own_property(new_id)) {
+      module_stats::get().set_cached(new_id);
       cache = module_cache.get_property_object(new_id);
       // And cache it under the top level name
       module_cache.set_property(id, cache);
@@ -651,6 +785,7 @@ object require::load_absolute_module(std::string id) {
 
   // If what ever the file resolves to is already loaded, give it to them
   if (module_cache.has_own_property(id)) {
+    module_stats::get().set_cached(id);
     return module_cache.get_property_object(id);
   }
 
@@ -728,6 +863,301 @@ static object module_resource(const fs::path &module_dir, std::string const &x_,
   return create<io::file>(fusion::make_vector(path.c_str(), mode));
 }
 
+// Look for coding and option lines. An coding line looks like one of
+// "// -*- coding:utf-8 -*-"
+// "// vim:fileencoding=utf-8:"
+//
+// An option line looks like
+// "// flusspferd: -xboo"
+//
+// We continue looking until we see a blank comment or a non comment line
+static std::string scan_module_header(
+  binary::vector_type const &buf, module_options &options)
+{
+  using namespace boost::xpressive;
+  sregex opt_re = sregex::compile("^\\s*([-\\w.]+):\\s*(.*)$");
+  sregex coding_re = sregex::compile("^.*coding[:=]\\s*([-\\w.]+)");
+  sregex empty_line_re = bos >> *_s >> eos;
+
+  // We only want to look for a coding comment on line 1 or 2
+  int look_for_coding = 2;
+  std::string encoding = "UTF-8";
+
+  binary::vector_type::const_iterator i;
+
+  for (i = buf.begin(); i != buf.end(); ++i) {
+    if (*(i++) != '/' || *(i++) != '/') {
+      // Not a comment line - stop!
+      break;
+    }
+    binary::vector_type::const_iterator e;
+    e = std::find(i, buf.end(), '\n');
+    if (e == buf.end())
+      break;
+
+    std::string line( reinterpret_cast<char const *>(&*i), std::size_t(e-i) );
+
+    // Move onto next line
+    i = e;
+
+    smatch m;
+    if (look_for_coding-- && regex_match(line, m, coding_re)) {
+      // Huzzah! We have an encoding!
+      encoding = m[1];
+      look_for_coding = 0;
+
+      continue;
+    }
+
+    // Empty comment line - stop looking
+    if (regex_match(line, empty_line_re))
+      break;
+
+    if (regex_match(line, m, opt_re)) {
+      // A line we are interested in
+      options.push_back(std::make_pair(m[1].str(), m[2].str()));
+    }
+  }
+
+  return encoding;
+}
+
+static void set_module_options(module_options const &options, object opts) {
+  for (module_options::const_iterator it = options.begin();
+       it != options.end(); ++it)
+  {
+    opts.set_property(it->first, it->second);
+  }
+
+  // If we have "flusspferd" or "warnings" in the option, split them on
+  // whitespace like shells do. TODO: Should we just split everything?
+  value v = opts.get_property("flusspferd");
+  if (v.is_string()) {
+    opts.set_property( "flusspferd", split_args_string(v) );
+  }
+
+  v = opts.get_property("warnings");
+  if (v.is_string()) {
+    opts.set_property( "warnings", split_args_string(v) );
+  }
+}
+
+// Convert to UTF-16 in native byte order. Unlike encodings::convert_to_string
+// this needs no context, so it can be used on any thread.
+static void decode_source(
+  std::string const &encoding,
+  binary::vector_type const &in,
+  binary::vector_type &out)
+{
+  static js_char16_t const bom = 0xfeff;
+  char const *native_charset =
+    *reinterpret_cast<unsigned char const *>(&bom) == 0xff
+    ? "UTF-16LE" : "UTF-16BE";
+
+  out.clear();
+  encodings::transcode_bytes(encoding, native_charset, in, out);
+}
+
+void prefetched_source::run() {
+  bool success = false;
+
+  try {
+    fs::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in)
+      throw std::runtime_error("can't open file");
+
+    binary::vector_type buf(fs::file_size(path));
+    if (!buf.empty())
+      in.read(reinterpret_cast<char *>(&buf[0]), buf.size());
+    buf.resize(in.gcount());
+    bytes_read = buf.size();
+
+    // Turn a shebang line into a comment to keep line numbers right
+    if (buf.size() >= 2 && buf[0] == '#' && buf[1] == '!')
+      buf[0] = buf[1] = '/';
+
+    std::string const encoding = scan_module_header(buf, options);
+    decode_source(encoding, buf, text);
+
+    success = true;
+  } catch (std::exception &) {
+    // load_module_text reads the file again and reports the error
+  }
+
+  boost::mutex::scoped_lock lock(mutex);
+  ok = success;
+  done = true;
+  cond.notify_all();
+}
+
+bool prefetched_source::wait() {
+  boost::mutex::scoped_lock lock(mutex);
+  while (!done)
+    cond.wait(lock);
+  return ok;
+}
+
+void prefetched_source::cancel() {
+  boost::mutex::scoped_lock lock(mutex);
+  done = true;
+  cond.notify_all();
+}
+
+// The threads reading prefetched sources, shared by every runtime in the
+// process. Threads are started as work comes in, at most one per core, and
+// are joined when the pool is destroyed at exit.
+class prefetch_pool : boost::noncopyable {
+public:
+  prefetch_pool()
+    : started(0), idle(0), stopping(false)
+  {}
+
+  ~prefetch_pool() {
+    std::deque<prefetched_source_ptr> dropped;
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      stopping = true;
+      dropped.swap(pending);
+      cond.notify_all();
+    }
+    threads.join_all();
+
+    // Nobody should wait for these any more, but don't let them hang.
+    for (std::size_t i = 0; i < dropped.size(); ++i)
+      dropped[i]->cancel();
+  }
+
+  void push(prefetched_source_ptr const &source) {
+    boost::mutex::scoped_lock lock(mutex);
+
+    if (idle == 0 && started < max_threads()) {
+      try {
+        threads.create_thread(boost::bind(&prefetch_pool::work, this));
+        ++started;
+      } catch (boost::thread_resource_error &) {
+        if (started == 0)
+          throw;
+      }
+    }
+
+    pending.push_back(source);
+    cond.notify_one();
+  }
+
+private:
+  static std::size_t max_threads() {
+    std::size_t n = boost::thread::hardware_concurrency();
+    return n ? n : 1;
+  }
+
+  void work() {
+    for (;;) {
+      prefetched_source_ptr source;
+      {
+        boost::mutex::scoped_lock lock(mutex);
+        ++idle;
+        while (pending.empty() && !stopping)
+          cond.wait(lock);
+        --idle;
+        if (stopping)
+          return;
+        source = pending.front();
+        pending.pop_front();
+      }
+      source->run();
+    }
+  }
+
+  boost::mutex mutex;
+  boost::condition_variable cond;
+  std::deque<prefetched_source_ptr> pending;
+  boost::thread_group threads;
+  std::size_t started;
+  std::size_t idle;
+  bool stopping;
+};
+
+static prefetch_pool the_prefetch_pool;
+
+// Sources not yet picked up, by path. Each thread has its own runtime and
+// thus its own modules. Only the most recent max_prefetched sources are
+// kept, so prefetching modules that are never required doesn't pile up.
+class prefetch_table : boost::noncopyable {
+public:
+  prefetched_source_ptr take(std::string const &path) {
+    source_map::iterator it = sources.find(path);
+    if (it == sources.end())
+      return prefetched_source_ptr();
+
+    prefetched_source_ptr source = it->second;
+    sources.erase(it);
+    return source;
+  }
+
+  bool has(std::string const &path) const {
+    return sources.find(path) != sources.end();
+  }
+
+  void add(prefetched_source_ptr const &source) {
+    sources[source->path.string()] = source;
+    order.push_back(source);
+
+    while (order.size() > max_prefetched) {
+      prefetched_source_ptr oldest = order.front().lock();
+      order.pop_front();
+      if (!oldest)
+        continue;
+      source_map::iterator it = sources.find(oldest->path.string());
+      if (it != sources.end() && it->second == oldest)
+        sources.erase(it);
+    }
+  }
+
+private:
+  static std::size_t const max_prefetched = 256;
+
+  typedef boost::unordered_map<std::string, prefetched_source_ptr>
+    source_map;
+
+  source_map sources;
+  std::deque<boost::weak_ptr<prefetched_source> > order;
+};
+
+static boost::thread_specific_ptr<prefetch_table> p_prefetch_table;
+
+static prefetch_table &get_prefetch_table() {
+  if (!p_prefetch_table.get())
+    p_prefetch_table.reset(new prefetch_table);
+  return *p_prefetch_table;
+}
+
+static prefetched_source_ptr take_prefetched_source(fs::path const &path) {
+  return get_prefetch_table().take(path.string());
+}
+
+static void start_prefetch(std::vector<fs::path> const &files) {
+  prefetch_table &table = get_prefetch_table();
+
+  for (std::vector<fs::path>::const_iterator it = files.begin();
+       it != files.end(); ++it)
+  {
+    if (table.has(it->string()))
+      continue;
+    prefetched_source_ptr source(new prefetched_source(*it));
+    the_prefetch_pool.push(source);
+    table.add(source);
+  }
+}
+
+static void require_prefetch(call_context &x) {
+  if (!x.arg[0].is_object() || x.arg[0].is_null())
+    throw exception("require.prefetch expects an array of module ids",
+                    "TypeError");
+
+  require &r = flusspferd::get_native<require>(x.self);
+  r.prefetch(array(x.arg[0].get_object()));
+}
+
 // This function adapted to use js array by Ash
 //
 // Original from :
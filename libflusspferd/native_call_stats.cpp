@@ -0,0 +1,206 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "flusspferd/native_call_stats.hpp"
+#include "flusspferd/create/object.hpp"
+#include "flusspferd/local_root_scope.hpp"
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/tss.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+using namespace flusspferd;
+
+namespace {
+  static boost::thread_specific_ptr<native_call_stats> p_instance;
+
+  static char const * const kind_names[native_call_stats::num_kinds] = {
+    "()", "()", "add", "delete", "get", "set", "resolve"
+  };
+
+  // Microseconds since the first call.
+  static double now() {
+    using namespace boost::posix_time;
+    static ptime const epoch(microsec_clock::universal_time());
+    return double((microsec_clock::universal_time() - epoch)
+                    .total_microseconds());
+  }
+
+  static std::string demangle(char const *type) {
+#ifdef __GNUC__
+    int status = 0;
+    char *name = abi::__cxa_demangle(type, 0, 0, &status);
+    if (name) {
+      std::string result(name);
+      std::free(name);
+      return result;
+    }
+#endif
+    return type;
+  }
+
+  struct key {
+    native_call_stats::kind which;
+    char const *type;
+    std::string member;
+
+    bool operator<(key const &o) const {
+      if (which != o.which)
+        return which < o.which;
+      // typeid names are compared by content, plugins may have their own
+      // copies.
+      int c = std::strcmp(type ? type : "", o.type ? o.type : "");
+      if (c != 0)
+        return c < 0;
+      return member < o.member;
+    }
+  };
+
+  struct counter {
+    counter() : calls(0), time(0) {}
+
+    unsigned long calls;
+    double time;
+  };
+
+  static bool more_time(
+    native_call_stats::entry const &a, native_call_stats::entry const &b)
+  {
+    return a.time > b.time;
+  }
+}
+
+class native_call_stats::impl {
+public:
+  std::map<key, counter> counters;
+};
+
+bool native_call_stats::enabled() {
+#ifdef FLUSSPFERD_NATIVE_CALL_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+native_call_stats &native_call_stats::get() {
+  if (!p_instance.get())
+    p_instance.reset(new native_call_stats);
+  return *p_instance;
+}
+
+native_call_stats::native_call_stats() : p(new impl) {}
+
+native_call_stats::~native_call_stats() {}
+
+native_call_stats::timer::timer(
+  kind which, char const *type, std::string const &member)
+  : which(which), type(type), member(member), start(now())
+{}
+
+native_call_stats::timer::~timer() {
+  double const end = now();
+  key k = { which, type, member };
+  counter &c = get().p->counters[k];
+  ++c.calls;
+  c.time += end - start;
+}
+
+std::vector<native_call_stats::entry> native_call_stats::entries() const {
+  std::vector<entry> result;
+  result.reserve(p->counters.size());
+
+  for (std::map<key, counter>::const_iterator it = p->counters.begin();
+       it != p->counters.end(); ++it)
+  {
+    key const &k = it->first;
+    entry e;
+    if (k.type) {
+      e.name = demangle(k.type);
+      if (!k.member.empty())
+        e.name += '.' + k.member;
+    } else {
+      e.name = k.member;
+    }
+    if (k.which == function_call || k.which == object_call)
+      e.name += kind_names[k.which];
+    else
+      e.name += std::string(" ") + kind_names[k.which];
+    e.calls = it->second.calls;
+    e.time = it->second.time / 1000;
+    result.push_back(e);
+  }
+
+  std::stable_sort(result.begin(), result.end(), &more_time);
+  return result;
+}
+
+object native_call_stats::to_object() const {
+  local_root_scope scope;
+
+  std::vector<entry> all = entries();
+
+  object result = create<object>();
+  for (std::vector<entry>::const_iterator it = all.begin();
+       it != all.end(); ++it)
+  {
+    object e = create<object>();
+    e.set_property("calls", double(it->calls));
+    e.set_property("time", it->time);
+    result.set_property(it->name, e);
+  }
+  return result;
+}
+
+void native_call_stats::write(std::ostream &out) const {
+  if (!enabled()) {
+    out << "Native call statistics are not compiled in "
+           "(ENABLE_NATIVE_CALL_STATS)\n";
+    return;
+  }
+
+  std::vector<entry> all = entries();
+
+  out << "     calls    time (ms)  name\n";
+  for (std::vector<entry>::const_iterator it = all.begin();
+       it != all.end(); ++it)
+  {
+    out << std::setw(10) << it->calls << ' '
+        << std::fixed << std::setprecision(3) << std::setw(12) << it->time
+        << "  " << it->name << '\n';
+  }
+}
+
+void native_call_stats::reset() {
+  p->counters.clear();
+}
@@ -35,7 +35,7 @@ THE SOFTWARE.
 using namespace flusspferd;
 
 Impl::arguments_impl::arguments_impl(std::vector<value> const &vals)
-  : n(vals.size()), argv(0)
+  : n(vals.size()), argv(0), roots(root_block::jsval_vector, &values)
 {
   values.reserve(n);
   if (n > 0) {
@@ -48,10 +48,13 @@ Impl::arguments_impl::arguments_impl(std::vector<value> const &vals)
 
 Impl::arguments_impl::arguments_impl(Impl::arguments_impl const &o)
   : values(o.values), n(o.n),
-    argv(o.is_userprovided() ? 0 : o.argv)
+    argv(o.is_userprovided() ? 0 : o.argv),
+    roots(root_block::jsval_vector, &values)
 {
   if (!argv)
     reset_argv();
+  if (o.roots.is_block_linked())
+    roots.link_block();
 }
 
 Impl::arguments_impl &Impl::arguments_impl::operator=(arguments_impl const &o) {
@@ -65,6 +68,8 @@ Impl::arguments_impl &Impl::arguments_impl::operator=(arguments_impl const &o) {
       values.clear();
       argv = o.argv;
     }
+    if (o.roots.is_block_linked())
+      roots.link_block();
   }
   return *this;
 }
@@ -103,9 +108,9 @@ void arguments::push_back(value const &v) {
 void arguments::push_root(value const &v) {
   if(!is_userprovided())
     throw exception("trying to push data into system provided argument list");
-  roots.push_back(boost::shared_ptr<root_value>(new root_value(v)));
   data().push_back(Impl::get_jsval(v));
   reset_argv();
+  root_data();
 }
     
 value arguments::back() {
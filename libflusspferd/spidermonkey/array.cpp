@@ -25,8 +25,12 @@ THE SOFTWARE.
 */
 
 #include "flusspferd/array.hpp"
+#include "flusspferd/binary.hpp"
+#include "flusspferd/convert.hpp"
 #include "flusspferd/exception.hpp"
 #include "flusspferd/spidermonkey/init.hpp"
+#include "flusspferd/spidermonkey/object.hpp"
+#include "flusspferd/spidermonkey/value.hpp"
 #include <js/jsapi.h>
 
 using namespace flusspferd;
@@ -76,3 +80,108 @@ value array::set_element(std::size_t index, value const &v_) {
     throw exception("Could not set array element");
   return v;
 }
+
+// -- bulk conversion -------------------------------------------------------
+
+using detail::convert_bulk;
+
+namespace {
+  JSObject *bulk_source(JSContext *cx, value const &v, jsuint &length) {
+    if (!v.is_object() || v.is_null())
+      throw exception("Value is not an array", "TypeError");
+    JSObject *obj = Impl::get_object(v.get_object());
+    if (!JS_IsArrayObject(cx, obj))
+      throw exception("Value is not an array", "TypeError");
+    if (!JS_GetArrayLength(cx, obj, &length))
+      throw exception("Could not get array length");
+    return obj;
+  }
+
+  value bulk_result(JSContext *cx, std::vector<jsval> &vals) {
+    JSObject *obj =
+      JS_NewArrayObject(cx, vals.size(), vals.empty() ? 0 : &vals[0]);
+    if (!obj)
+      throw exception("Could not create array");
+    return object(Impl::wrap_object(obj));
+  }
+}
+
+value convert_bulk::from_numbers(std::vector<double> const &data) {
+  JSContext *cx = Impl::current_context();
+
+  std::vector<jsval> vals(data.size(), JSVAL_VOID);
+  Impl::root_block roots(Impl::root_block::jsval_vector, &vals);
+  roots.link_block();
+
+  for (std::size_t i = 0; i < data.size(); ++i)
+    if (!JS_NewNumberValue(cx, data[i], &vals[i]))
+      throw exception("Could not create number");
+
+  return bulk_result(cx, vals);
+}
+
+void convert_bulk::to_numbers(value v, std::vector<double> &data) {
+  if (v.is_object() && is_native<float64_buffer>(v.get_object())) {
+    data = get_native<float64_buffer>(v.get_object()).get_data();
+    return;
+  }
+
+  JSContext *cx = Impl::current_context();
+  jsuint length;
+  JSObject *obj = bulk_source(cx, v, length);
+
+  // Keeps values created by getters and valueOf alive while converting.
+  root_value element;
+  jsval *elementp = Impl::get_jsvalp(element);
+
+  data.resize(length);
+  for (jsuint i = 0; i < length; ++i) {
+    if (!JS_GetElement(cx, obj, i, elementp))
+      throw exception("Could not get array element");
+    if (JSVAL_IS_INT(*elementp)) {
+      data[i] = JSVAL_TO_INT(*elementp);
+    } else {
+      jsdouble d;
+      if (!JS_ValueToNumber(cx, *elementp, &d))
+        throw exception("Could not convert value to number");
+      data[i] = d;
+    }
+  }
+}
+
+value convert_bulk::from_strings(std::vector<std::string> const &data) {
+  JSContext *cx = Impl::current_context();
+
+  std::vector<jsval> vals(data.size(), JSVAL_VOID);
+  Impl::root_block roots(Impl::root_block::jsval_vector, &vals);
+  roots.link_block();
+
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    JSString *str = JS_NewStringCopyN(cx, data[i].data(), data[i].size());
+    if (!str)
+      throw exception("Could not create string");
+    vals[i] = STRING_TO_JSVAL(str);
+  }
+
+  return bulk_result(cx, vals);
+}
+
+void convert_bulk::to_strings(value v, std::vector<std::string> &data) {
+  JSContext *cx = Impl::current_context();
+  jsuint length;
+  JSObject *obj = bulk_source(cx, v, length);
+
+  root_value element;
+  jsval *elementp = Impl::get_jsvalp(element);
+
+  data.resize(length);
+  for (jsuint i = 0; i < length; ++i) {
+    if (!JS_GetElement(cx, obj, i, elementp))
+      throw exception("Could not get array element");
+    JSString *str = JS_ValueToString(cx, *elementp);
+    if (!str)
+      throw exception("Could not convert value to string");
+    *elementp = STRING_TO_JSVAL(str);
+    data[i].assign(JS_GetStringBytes(str));
+  }
+}
@@ -29,6 +29,7 @@ THE SOFTWARE.
 #include "flusspferd/exception.hpp"
 #include "flusspferd/local_root_scope.hpp"
 #include "flusspferd/create/object.hpp"
+#include "flusspferd/init.hpp"
 #include "flusspferd/spidermonkey/context.hpp"
 #include "flusspferd/spidermonkey/value.hpp"
 #include "flusspferd/spidermonkey/object.hpp"
@@ -37,9 +38,21 @@ THE SOFTWARE.
 #include <boost/foreach.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/thread/tss.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/optional.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/bind.hpp>
+#include <set>
+#include <vector>
 #include <cstring>
 #include <cstdio>
+#include <ctime>
 #include <iostream>
+#include <time.h>
 #include <js/jsapi.h>
 
 #ifndef FLUSSPFERD_STACKCHUNKSIZE
@@ -47,8 +60,14 @@ THE SOFTWARE.
 #endif
 
 /* Assume that we can not use more than 5e5 bytes of C stack by default. */
-// TODO: Read this from config or command line.
-static size_t gMaxStackSize = 500000;
+#ifndef FLUSSPFERD_STACKLIMIT
+#define FLUSSPFERD_STACKLIMIT 500000
+#endif
+
+/* How often running scripts with a CPU time limit are checked, in ms. */
+#ifndef FLUSSPFERD_WATCHDOG_INTERVAL
+#define FLUSSPFERD_WATCHDOG_INTERVAL 10
+#endif
 
 // Used for recursion protection in JS
 static boost::thread_specific_ptr<size_t> p_stack_base;
@@ -56,28 +75,301 @@ static boost::thread_specific_ptr<size_t> p_stack_base;
 
 using namespace flusspferd;
 
+std::size_t const context::default_stack_limit = FLUSSPFERD_STACKLIMIT;
+std::size_t const context::default_stack_chunk_size =
+  FLUSSPFERD_STACKCHUNKSIZE;
+
+static boost::mutex &class_index_mutex() {
+  static boost::mutex mutex;
+  return mutex;
+}
+
 namespace {
-  static JSClass global_class = {
-    "global", JSCLASS_GLOBAL_FLAGS,
-    JS_PropertyStub, JS_PropertyStub, JS_PropertyStub, JS_PropertyStub,
-    JS_EnumerateStub, JS_ResolveStub, JS_ConvertStub, JS_FinalizeStub,
-    JSCLASS_NO_OPTIONAL_MEMBERS
-  };
+
+double thread_cpu_time() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+  return double(std::clock()) / CLOCKS_PER_SEC;
+}
+
+// What the watchdog does for a context. Written on the thread using the
+// context; the watchdog thread reads it while holding watchdog::mutex.
+struct watched_context {
+  watched_context()
+    : cx(0), interrupted(false), stopped(0), samples_due(0), branches(0) {}
+
+  JSContext *cx;
+  boost::optional<boost::posix_time::ptime> wall_deadline;
+  boost::optional<double> cpu_deadline;
+
+  // Set by context::interrupt(), guarded by watchdog::mutex.
+  bool interrupted;
+
+  // Why the scripts of the context are being stopped, if they are.
+  char const *stopped;
+
+  // Stack sampling for the profiler. samples_due counts the intervals
+  // passed since the last sample and is guarded by watchdog::mutex.
+  boost::optional<boost::posix_time::time_duration> sample_interval;
+  boost::posix_time::ptime next_sample;
+  unsigned samples_due;
+
+  // Backward jumps seen by the branch callback. Only touched on the thread
+  // using the context.
+  unsigned branches;
+};
+
+// Triggers the operation callback of contexts whose time limit has
+// passed, which need their CPU time checked or which are due for a stack
+// sample.
+class watchdog {
+public:
+  static watchdog &get() {
+    boost::call_once(once, &watchdog::create);
+    return *instance;
+  }
+
+  void set_limit(
+    watched_context &w,
+    boost::optional<boost::posix_time::ptime> const &wall_deadline,
+    boost::optional<double> const &cpu_deadline)
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    w.wall_deadline = wall_deadline;
+    w.cpu_deadline = cpu_deadline;
+    w.interrupted = false;
+    w.stopped = 0;
+    update(w);
+  }
+
+  void set_sampling(
+    watched_context &w,
+    boost::optional<boost::posix_time::time_duration> const &interval)
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    w.sample_interval = interval;
+    w.next_sample =
+      boost::posix_time::microsec_clock::universal_time() +
+      interval.get_value_or(boost::posix_time::time_duration());
+    w.samples_due = 0;
+    update(w);
+  }
+
+  void interrupt(watched_context &w) {
+    boost::mutex::scoped_lock lock(mutex);
+    w.interrupted = true;
+#ifdef SPIDERMONKEY_HAS_OPERATION_CALLBACK
+    JS_TriggerOperationCallback(w.cx);
+#endif
+    update(w);
+  }
+
+  // Called from the operation callback. Returns whether the context was
+  // interrupted and how many samples are due, and resets the latter.
+  void poll(watched_context &w, bool &interrupted, unsigned &samples_due) {
+    boost::mutex::scoped_lock lock(mutex);
+#ifndef SPIDERMONKEY_HAS_OPERATION_CALLBACK
+    if (w.sample_interval) {
+      boost::posix_time::ptime now =
+        boost::posix_time::microsec_clock::universal_time();
+      while (w.next_sample <= now) {
+        ++w.samples_due;
+        w.next_sample += *w.sample_interval;
+      }
+    }
+#endif
+    interrupted = w.interrupted;
+    samples_due = w.samples_due;
+    w.samples_due = 0;
+  }
+
+  void remove(watched_context &w) {
+    boost::mutex::scoped_lock lock(mutex);
+    watched.erase(&w);
+  }
+
+private:
+  static void create() {
+    instance = new watchdog;
+  }
+
+  // Must be called with the mutex held.
+  void update(watched_context &w) {
+    if (w.wall_deadline || w.cpu_deadline || w.sample_interval ||
+        w.interrupted)
+    {
+      watched.insert(&w);
+#ifdef SPIDERMONKEY_HAS_OPERATION_CALLBACK
+      if (!thread)
+        thread.reset(new boost::thread(boost::bind(&watchdog::run, this)));
+      wakeup.notify_one();
+#endif
+    } else {
+      watched.erase(&w);
+    }
+  }
+
+#ifdef SPIDERMONKEY_HAS_OPERATION_CALLBACK
+  void run() {
+    using namespace boost::posix_time;
+    boost::mutex::scoped_lock lock(mutex);
+    for (;;) {
+      if (watched.empty()) {
+        wakeup.wait(lock);
+        continue;
+      }
+      ptime now = microsec_clock::universal_time();
+      ptime wake = now + milliseconds(FLUSSPFERD_WATCHDOG_INTERVAL);
+      for (std::set<watched_context*>::iterator it = watched.begin();
+           it != watched.end(); ++it)
+      {
+        watched_context &w = **it;
+        bool trigger = false;
+
+        if (w.sample_interval) {
+          if (w.next_sample <= now) {
+            // Intervals spent in native code are all counted for the
+            // stack that is current when the script resumes.
+            while (w.next_sample <= now) {
+              ++w.samples_due;
+              w.next_sample += *w.sample_interval;
+            }
+            trigger = true;
+          }
+          if (w.next_sample < wake)
+            wake = w.next_sample;
+        }
+
+        // Contexts stay in the set after their limit passed or they were
+        // interrupted, so a script that catches the resulting exception
+        // (thrown by a native function that called back into Javascript) is
+        // stopped again.
+        if (w.interrupted || w.cpu_deadline)
+          trigger = true;
+        else if (w.wall_deadline) {
+          if (*w.wall_deadline <= now)
+            trigger = true;
+          else if (*w.wall_deadline < wake)
+            wake = *w.wall_deadline;
+        }
+
+        if (trigger)
+          JS_TriggerOperationCallback(w.cx);
+      }
+      wakeup.timed_wait(lock, wake);
+    }
+  }
+
+  boost::scoped_ptr<boost::thread> thread;
+  boost::condition_variable wakeup;
+#endif
+
+  boost::mutex mutex;
+  std::set<watched_context*> watched;
+
+  static boost::once_flag once;
+  static watchdog *instance;
+};
+
+boost::once_flag watchdog::once = BOOST_ONCE_INIT;
+watchdog *watchdog::instance = 0;
+
+}
+
+std::size_t flusspferd::detail::class_index(std::string const &name) {
+  typedef boost::unordered_map<std::string, std::size_t> index_map;
+
+  boost::mutex::scoped_lock lock(class_index_mutex());
+  static index_map indices;
+  index_map::iterator it = indices.find(name);
+  if (it == indices.end())
+    it = indices.insert(index_map::value_type(name, indices.size())).first;
+  return it->second;
 }
 
 struct context::context_private {
+  // Indexed by detail::class_index. The objects are kept alive by tracing
+  // them from the global object, so they do not need roots of their own.
+  std::vector<JSObject*> prototypes;
+  std::vector<JSObject*> constructors;
+
   typedef boost::shared_ptr<root_object> root_object_ptr;
-  boost::unordered_map<std::string, root_object_ptr> prototypes;
-  boost::unordered_map<std::string, root_object_ptr> constructors;
+
+  struct lazy_class {
+    class_loader loader;
+    root_object_ptr container;
+  };
+  boost::unordered_map<std::size_t, lazy_class> lazy_classes;
+
   size_t stack_limit_bytes;
+  size_t stack_chunk_size;
+
+  watched_context watch;
+
+  // Called from the operation callback. Returns false if the scripts of
+  // the context have to be stopped.
+  bool check(JSContext *cx) {
+    bool interrupted;
+    unsigned samples_due;
+    watchdog::get().poll(watch, interrupted, samples_due);
+
+    if (samples_due)
+      Impl::sample_stack(cx, samples_due);
+
+    if (!watch.stopped) {
+      if (interrupted)
+        watch.stopped = "interrupted";
+      else if (watch.wall_deadline &&
+               boost::posix_time::microsec_clock::universal_time() >=
+                 *watch.wall_deadline)
+        watch.stopped = "wall-clock time limit exceeded";
+      else if (watch.cpu_deadline && thread_cpu_time() >= *watch.cpu_deadline)
+        watch.stopped = "CPU time limit exceeded";
+    }
+    return !watch.stopped;
+  }
+
+  static JSObject *get(std::vector<JSObject*> const &v, std::size_t index) {
+    return index < v.size() ? v[index] : 0;
+  }
+
+  static void set(std::vector<JSObject*> &v, std::size_t index, JSObject *o) {
+    if (index >= v.size())
+      v.resize(index + 1, 0);
+    v[index] = o;
+  }
+
+  void trace(JSTracer *trc) {
+    for (std::size_t i = 0; i < prototypes.size(); ++i)
+      if (prototypes[i])
+        JS_CALL_OBJECT_TRACER(trc, prototypes[i], "prototype");
+    for (std::size_t i = 0; i < constructors.size(); ++i)
+      if (constructors[i])
+        JS_CALL_OBJECT_TRACER(trc, constructors[i], "constructor");
+  }
+
+  // Run the deferred loader for the class if there is one. The entry is
+  // removed first, so loaders may freely look up their own class.
+  void load_lazy_class(std::size_t index) {
+    boost::unordered_map<std::size_t, lazy_class>::iterator it =
+      lazy_classes.find(index);
+    if (it == lazy_classes.end())
+      return;
+    lazy_class lazy = it->second;
+    lazy_classes.erase(it);
+    object container(*lazy.container);
+    lazy.loader(container);
+  }
 };
 
 /// impl provides the hidden implementation part
 class context::impl {
 public:
-  impl()
-    : context(JS_NewContext(Impl::get_runtime(),
-                            FLUSSPFERD_STACKCHUNKSIZE)),
+  impl(size_t stack_chunk_size)
+    : context(JS_NewContext(Impl::get_runtime(), stack_chunk_size)),
       destroy(true)
   {
     if(!context)
@@ -103,6 +395,12 @@ public:
 
     JS_SetErrorReporter(context, spidermonkey_error_reporter);
 
+#ifdef SPIDERMONKEY_HAS_OPERATION_CALLBACK
+    JS_SetOperationCallback(context, &operation_callback);
+#else
+    JS_SetBranchCallback(context, &branch_callback);
+#endif
+
     JSObject *global_ = JS_NewObject(context, &global_class, 0x0, 0x0);
     if(!global_)
       throw exception("Could not create Global Object");
@@ -112,7 +410,11 @@ public:
     if(!JS_InitStandardClasses(context, global_))
       throw exception("Could not initialize Global Object");
 
-    JS_SetContextPrivate(context, static_cast<void*>(new context_private));
+    context_private *priv = new context_private;
+    priv->stack_chunk_size = stack_chunk_size;
+    priv->watch.cx = context;
+    JS_SetContextPrivate(context, static_cast<void*>(priv));
+    JS_SetPrivate(context, global_, static_cast<void*>(priv));
   }
 
   explicit impl(JSContext *context)
@@ -122,6 +424,10 @@ public:
   ~impl() {
     if (destroy) {
       current_context_scope scope(Impl::wrap_context(context));
+      JSObject *global_ = JS_GetGlobalObject(context);
+      if (global_)
+        JS_SetPrivate(context, global_, 0);
+      watchdog::get().remove(get_private()->watch);
       delete get_private();
       JS_DestroyContext(context);
     }
@@ -186,10 +492,55 @@ public:
 
   }
 
+  static JSBool operation_callback(JSContext *cx) {
+    context_private *priv =
+      static_cast<context_private*>(JS_GetContextPrivate(cx));
+    return !priv || priv->check(cx);
+  }
+
+#ifndef SPIDERMONKEY_HAS_OPERATION_CALLBACK
+  // Without a thread-safe operation callback, the time is checked every
+  // few thousand backward jumps instead.
+  static JSBool branch_callback(JSContext *cx, JSScript *) {
+    context_private *priv =
+      static_cast<context_private*>(JS_GetContextPrivate(cx));
+    if (priv && ++priv->watch.branches % 4096)
+      return JS_TRUE;
+    return operation_callback(cx);
+  }
+#endif
+
+  static void check_time_limit(JSContext *cx) {
+    context_private *priv =
+      static_cast<context_private*>(JS_GetContextPrivate(cx));
+    if (priv && priv->watch.stopped)
+      throw exception(
+        std::string("Script stopped: ") + priv->watch.stopped);
+  }
+
+  // The global object traces the class registry of its context.
+  static void trace_global(JSTracer *trc, JSObject *obj) {
+    context_private *priv =
+      static_cast<context_private*>(JS_GetPrivate(trc->context, obj));
+    if (priv)
+      priv->trace(trc);
+  }
+
+  static JSClass global_class;
+
   JSContext *context;
   bool destroy;
 };
 
+JSClass context::impl::global_class = {
+  "global", JSCLASS_GLOBAL_FLAGS | JSCLASS_HAS_PRIVATE | JSCLASS_MARK_IS_TRACE,
+  JS_PropertyStub, JS_PropertyStub, JS_PropertyStub, JS_PropertyStub,
+  JS_EnumerateStub, JS_ResolveStub, JS_ConvertStub, JS_FinalizeStub,
+  0, 0, 0, 0, 0, 0,
+  (JSMarkOp) &context::impl::trace_global,
+  0
+};
+
 /// detail is used for copyconstructing/initialisation purpose
 struct context::detail {
   JSContext *c;
@@ -198,8 +549,19 @@ struct context::detail {
   static JSContext *get(context &co) {
     return co.p->context;
   }
+
+  static void check_time_limit(JSContext *cx) {
+    impl::check_time_limit(cx);
+  }
+
+  static void set_sample_interval(JSContext *cx, double interval_ms);
+  static double get_sample_interval(JSContext *cx);
 };
 
+void Impl::check_time_limit(JSContext *cx) {
+  context::detail::check_time_limit(cx);
+}
+
 JSContext *Impl::get_context(context &co) {
   return context::detail::get(co);
 }
@@ -218,14 +580,13 @@ context::context(context::detail const &d)
 }
 context::~context() { }
 
-context context::create() {
+context context::create(size_t stack_limit, size_t stack_chunk_size) {
   context c;
-  c.p.reset(new impl);
+  c.p.reset(new impl(stack_chunk_size));
 
   current_context_scope scope(c);
 
-  c.set_stack_limit( gMaxStackSize );
-  c.get_stack_limit();
+  c.set_stack_limit( stack_limit );
 
   // add standard prototype (for e.g. native_object_base)
   object std_proto = flusspferd::create<object>().prototype();
@@ -261,23 +622,63 @@ object context::scope_chain() {
 }
 
 void context::add_prototype(std::string const &name, object const &proto) {
-  p->get_private()->prototypes[name] =
-    context_private::root_object_ptr(new root_object(proto));
+  add_prototype(flusspferd::detail::class_index(name), proto);
 }
 
 object context::prototype(std::string const &name) const {
-  context_private::root_object_ptr ptr = p->get_private()->prototypes[name];
-  return ptr ? *ptr : object();
+  return prototype(flusspferd::detail::class_index(name));
+}
+
+void context::add_prototype(std::size_t index, object const &proto) {
+  context_private::set(
+    p->get_private()->prototypes, index, Impl::get_object(proto));
+}
+
+object context::prototype(std::size_t index) const {
+  context_private *priv = p->get_private();
+  JSObject *o = context_private::get(priv->prototypes, index);
+  if (!o && !priv->lazy_classes.empty()) {
+    priv->load_lazy_class(index);
+    o = context_private::get(priv->prototypes, index);
+  }
+  return Impl::wrap_object(o);
 }
 
 void context::add_constructor(std::string const &name, object const &ctor) {
-  p->get_private()->constructors[name] =
-    context_private::root_object_ptr(new root_object(ctor));
+  add_constructor(flusspferd::detail::class_index(name), ctor);
 }
 
 object context::constructor(std::string const &name) const {
-  context_private::root_object_ptr ptr = p->get_private()->constructors[name];
-  return ptr ? *ptr : object();
+  return constructor(flusspferd::detail::class_index(name));
+}
+
+void context::add_constructor(std::size_t index, object const &ctor) {
+  context_private::set(
+    p->get_private()->constructors, index, Impl::get_object(ctor));
+}
+
+object context::constructor(std::size_t index) const {
+  context_private *priv = p->get_private();
+  JSObject *o = context_private::get(priv->constructors, index);
+  if (!o && !priv->lazy_classes.empty()) {
+    priv->load_lazy_class(index);
+    o = context_private::get(priv->constructors, index);
+  }
+  return Impl::wrap_object(o);
+}
+
+bool context::add_lazy_class(
+  std::string const &name, class_loader loader, object const &container)
+{
+  context_private *priv = p->get_private();
+  std::size_t index = flusspferd::detail::class_index(name);
+  if (context_private::get(priv->constructors, index) ||
+      context_private::get(priv->prototypes, index))
+    return false;
+  context_private::lazy_class &lazy = priv->lazy_classes[index];
+  lazy.loader = loader;
+  lazy.container.reset(new root_object(container));
+  return true;
 }
 
 void context::gc(bool maybe) {
@@ -287,6 +688,10 @@ void context::gc(bool maybe) {
     JS_MaybeGC(p->context);
 }
 
+gc_statistics context::gc_stats() {
+  return init::initialize().get_gc_stats();
+}
+
 void context::set_thread() {
 #ifdef JS_THREADSAFE
   assert(JS_SetContextThread(p->context) == 0);
@@ -370,3 +775,55 @@ void context::set_stack_limit( size_t bytes ) {
 size_t context::get_stack_limit() {
   return p->get_private()->stack_limit_bytes;
 }
+
+size_t context::get_stack_chunk_size() {
+  return p->get_private()->stack_chunk_size;
+}
+
+void context::set_time_limit(double wall_ms, double cpu_ms) {
+  boost::optional<boost::posix_time::ptime> wall_deadline;
+  boost::optional<double> cpu_deadline;
+
+  if (wall_ms > 0)
+    wall_deadline = boost::posix_time::microsec_clock::universal_time() +
+      boost::posix_time::microseconds(static_cast<long>(wall_ms * 1000));
+  if (cpu_ms > 0)
+    cpu_deadline = thread_cpu_time() + cpu_ms / 1000;
+
+  watchdog::get().set_limit(
+    p->get_private()->watch, wall_deadline, cpu_deadline);
+}
+
+void context::clear_time_limit() {
+  watchdog::get().set_limit(p->get_private()->watch, boost::none, boost::none);
+}
+
+void context::interrupt() {
+  watchdog::get().interrupt(p->get_private()->watch);
+}
+
+void context::detail::set_sample_interval(JSContext *cx, double interval_ms) {
+  context_private *priv =
+    static_cast<context_private*>(JS_GetContextPrivate(cx));
+  boost::optional<boost::posix_time::time_duration> interval;
+  if (interval_ms > 0)
+    interval = boost::posix_time::microseconds(
+      static_cast<long>(interval_ms * 1000));
+  watchdog::get().set_sampling(priv->watch, interval);
+}
+
+void Impl::set_sample_interval(JSContext *cx, double interval_ms) {
+  context::detail::set_sample_interval(cx, interval_ms);
+}
+
+double context::detail::get_sample_interval(JSContext *cx) {
+  context_private *priv =
+    static_cast<context_private*>(JS_GetContextPrivate(cx));
+  if (!priv->watch.sample_interval)
+    return 0;
+  return priv->watch.sample_interval->total_microseconds() / 1000.0;
+}
+
+double Impl::get_sample_interval(JSContext *cx) {
+  return context::detail::get_sample_interval(cx);
+}
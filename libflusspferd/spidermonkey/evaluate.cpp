@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include "flusspferd/local_root_scope.hpp"
 #include "flusspferd/init.hpp"
 #include "flusspferd/spidermonkey/init.hpp"
+#include "flusspferd/spidermonkey/context.hpp"
 #include "flusspferd/modules.hpp"
 #include "flusspferd/string.hpp"
 
@@ -66,6 +67,7 @@ value flusspferd::evaluate_in_scope(
   JSBool ok = JS_EvaluateScript(cx, Impl::get_object(scope),
                                 source, n, file, line, &rval);
   if(!ok) {
+    Impl::check_time_limit(cx);
     exception e("Could not evaluate script");
     if (!e.is_js_exception())
       throw e;
@@ -87,6 +89,7 @@ value flusspferd::evaluate_in_scope(
                                 source.data(), source.length(), file, line,
                                 &rval);
   if(!ok) {
+    Impl::check_time_limit(cx);
     exception e("Could not evaluate script");
     if (!e.is_js_exception())
       throw e;
@@ -144,8 +147,10 @@ value flusspferd::execute(char const *filename, object const &scope_) {
 
   JSBool ok = JS_ExecuteScript(cx, scope, script, Impl::get_jsvalp(result));
 
-  if (!ok)
+  if (!ok) {
+    Impl::check_time_limit(cx);
     throw exception("Script execution failed");
+  }
 
   JS_MaybeGC(cx);
 
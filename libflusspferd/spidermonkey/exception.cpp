@@ -183,3 +183,29 @@ char const *exception::what() const throw() {
 js_quit::js_quit() {}
 
 js_quit::~js_quit() {}
+
+void flusspferd::set_pending_error(char const *what, char const *type) {
+  JSContext *const cx = Impl::current_context();
+
+  if (JS_EnterLocalRootScope(cx)) {
+    JSString *message = JS_NewStringCopyZ(cx, what);
+    jsval arg, result;
+
+    if (message) {
+      arg = STRING_TO_JSVAL(message);
+      if (JS_CallFunctionName(
+            cx, JS_GetGlobalObject(cx), type, 1, &arg, &result))
+        JS_SetPendingException(cx, result);
+    }
+
+    JS_LeaveLocalRootScope(cx);
+  }
+
+  // Creating the error failed without an exception of its own.
+  if (!JS_IsExceptionPending(cx))
+    JS_ReportError(cx, "%s", what);
+}
+
+bool flusspferd::is_error_pending() {
+  return JS_IsExceptionPending(Impl::current_context());
+}
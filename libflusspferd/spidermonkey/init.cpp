@@ -31,15 +31,24 @@ THE SOFTWARE.
 #include "flusspferd/spidermonkey/init.hpp"
 #include <boost/thread/tss.hpp>
 #include <boost/thread/once.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <js/jsapi.h>
 #include <cassert>
+#include <cstring>
 
 #ifndef FLUSSPFERD_MAX_BYTES
-#define FLUSSPFERD_MAX_BYTES 8L * 1024L * 1024L // 8 MB TODO: too much?
+#define FLUSSPFERD_MAX_BYTES 8L * 1024L * 1024L // 8 MB
 #endif
 
 using namespace flusspferd;
 
+std::size_t const init::default_max_bytes = FLUSSPFERD_MAX_BYTES;
+
+// The engine only takes 32 bit sizes.
+static uint32 clamp_bytes(std::size_t bytes) {
+  return bytes > 0xffffffffUL ? uint32(0xffffffffUL) : uint32(bytes);
+}
+
 static boost::thread_specific_ptr<init> p_instance;
 
 static boost::once_flag runtime_created = BOOST_ONCE_INIT;
@@ -47,17 +56,28 @@ static boost::once_flag runtime_created = BOOST_ONCE_INIT;
 class init::impl {
 public:
   // we use a single JS_Runtime for each thread!
-  impl()
+  impl(std::size_t max_bytes)
+    : max_bytes(clamp_bytes(max_bytes)),
+      // JS_NewRuntime uses the heap limit for this, too
+      max_malloc_bytes(this->max_bytes),
+      // The engine's default
+      gc_trigger_factor(300),
+      previous_gc_callback(0)
   {
+    std::memset(&gc_stats, 0, sizeof(gc_stats));
+
     boost::call_once(runtime_created, JS_SetCStringsAreUTF8);
 
     if (!JS_CStringsAreUTF8())
       throw std::runtime_error("UTF8 support in Spidermonkey required");
 
-    runtime = JS_NewRuntime( FLUSSPFERD_MAX_BYTES );
+    runtime = JS_NewRuntime( this->max_bytes );
     if (!runtime) {
       throw std::runtime_error("Could not create Spidermonkey Runtime");
     }
+
+    previous_gc_callback = JS_SetGCCallbackRT(runtime, &impl::gc_callback);
+    JS_SetExtraGCRoots(runtime, &impl::trace_roots, &roots);
   }
   ~impl() {
     JS_DestroyRuntime(runtime);
@@ -66,25 +86,95 @@ public:
   JSRuntime *runtime;
   context current_context;
 
+  Impl::root_block::block_list roots;
+
+  uint32 max_bytes;
+  uint32 max_malloc_bytes;
+  unsigned gc_trigger_factor;
+
+  gc_statistics gc_stats;
+  boost::posix_time::ptime gc_start;
+  JSGCCallback previous_gc_callback;
+
+  static JSBool gc_callback(JSContext *cx, JSGCStatus status);
+
+  static void trace_roots(JSTracer *trc, void *data) {
+    static_cast<Impl::root_block::block_list *>(data)->trace(trc);
+  }
 };
 
+JSBool init::impl::gc_callback(JSContext *cx, JSGCStatus status) {
+  using namespace boost::posix_time;
+
+  init *in = p_instance.get();
+  if (!in)
+    return JS_TRUE;
+  impl &self = *in->p;
+
+  switch (status) {
+  case JSGC_BEGIN:
+    self.gc_start = microsec_clock::universal_time();
+    break;
+  case JSGC_END:
+    if (!self.gc_start.is_not_a_date_time()) {
+      double pause =
+        (microsec_clock::universal_time() - self.gc_start)
+          .total_microseconds() / 1000.0;
+      self.gc_start = ptime();
+
+      gc_statistics &stats = self.gc_stats;
+      ++stats.collections;
+      stats.last_pause = pause;
+      stats.total_pause += pause;
+      if (pause > stats.max_pause)
+        stats.max_pause = pause;
+#ifdef SPIDERMONKEY_HAS_GC_BYTES
+      stats.live_bytes = JS_GetGCParameter(self.runtime, JSGC_BYTES);
+#endif
+    }
+    break;
+  default:
+    break;
+  }
+
+  if (self.previous_gc_callback)
+    return self.previous_gc_callback(cx, status);
+  return JS_TRUE;
+}
+
 struct init::detail {
   static JSRuntime *get(init &in) {
     return in.p->runtime;
   }
+
+  static Impl::root_block::block_list &get_roots(init &in) {
+    return in.p->roots;
+  }
 };
 
 JSRuntime *Impl::get_runtime() {
   return init::detail::get(init::initialize());
 }
 
+Impl::root_block::block_list &Impl::get_root_list() {
+  return init::detail::get_roots(init::initialize());
+}
+
 init &init::initialize() {
   if (!p_instance.get())
-    p_instance.reset(new init);
+    p_instance.reset(new init(default_max_bytes));
+  return *p_instance;
+}
+
+init &init::initialize(std::size_t max_bytes) {
+  if (!p_instance.get())
+    p_instance.reset(new init(max_bytes));
+  else
+    p_instance->set_max_bytes(max_bytes);
   return *p_instance;
 }
 
-init::init() : p(new impl) { }
+init::init(std::size_t max_bytes) : p(new impl(max_bytes)) { }
 init::~init() {}
 
 context init::enter_current_context(context const &c) {
@@ -106,3 +196,82 @@ context &init::current_context() {
   return p->current_context;
 }
 
+void init::set_max_bytes(std::size_t bytes) {
+  p->max_bytes = clamp_bytes(bytes);
+  JS_SetGCParameter(p->runtime, JSGC_MAX_BYTES, p->max_bytes);
+}
+
+std::size_t init::get_max_bytes() {
+  return p->max_bytes;
+}
+
+void init::set_max_malloc_bytes(std::size_t bytes) {
+  p->max_malloc_bytes = clamp_bytes(bytes);
+  JS_SetGCParameter(p->runtime, JSGC_MAX_MALLOC_BYTES, p->max_malloc_bytes);
+}
+
+std::size_t init::get_max_malloc_bytes() {
+  return p->max_malloc_bytes;
+}
+
+bool init::set_gc_trigger_factor(unsigned percent) {
+#ifdef SPIDERMONKEY_HAS_GC_TRIGGER_FACTOR
+  if (percent < 100)
+    percent = 100;
+  p->gc_trigger_factor = percent;
+  JS_SetGCParameter(p->runtime, JSGC_TRIGGER_FACTOR, percent);
+  return true;
+#else
+  (void) percent;
+  return false;
+#endif
+}
+
+unsigned init::get_gc_trigger_factor() {
+#ifdef SPIDERMONKEY_HAS_GC_TRIGGER_FACTOR
+  return p->gc_trigger_factor;
+#else
+  return 0;
+#endif
+}
+
+#ifdef JS_TYPED_ROOTING_API
+static intN count_root(void *, JSGCRootType, const char *, void *data) {
+#else
+static intN count_root(void *, const char *, void *data) {
+#endif
+  ++*static_cast<std::size_t *>(data);
+  return JS_MAP_GCROOT_NEXT;
+}
+
+gc_statistics init::get_gc_stats() {
+  gc_statistics result = p->gc_stats;
+#ifdef SPIDERMONKEY_HAS_GC_BYTES
+  std::size_t bytes = JS_GetGCParameter(p->runtime, JSGC_BYTES);
+  result.bytes_since_gc = bytes > result.live_bytes
+                        ? bytes - result.live_bytes : 0;
+#endif
+  result.rooted = p->roots.size();
+  JS_MapGCRoots(p->runtime, &count_root, &result.rooted);
+  return result;
+}
+
+void flusspferd::add_external_bytes(std::ptrdiff_t delta) {
+  if (init *in = p_instance.get())
+    in->add_external_bytes(delta);
+}
+
+void init::add_external_bytes(std::ptrdiff_t delta) {
+  std::size_t &bytes = p->gc_stats.external_bytes;
+  if (delta < 0) {
+    std::size_t freed = std::size_t(-delta);
+    bytes = freed > bytes ? 0 : bytes - freed;
+  } else {
+    bytes += std::size_t(delta);
+#ifdef SPIDERMONKEY_HAS_UPDATE_MALLOC_COUNTER
+    if (p->current_context.is_valid())
+      JS_updateMallocCounter(
+        Impl::get_context(p->current_context), std::size_t(delta));
+#endif
+  }
+}
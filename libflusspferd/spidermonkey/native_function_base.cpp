@@ -29,10 +29,11 @@ THE SOFTWARE.
 #include "flusspferd/local_root_scope.hpp"
 #include "flusspferd/exception.hpp"
 #include "flusspferd/arguments.hpp"
+#include "flusspferd/string.hpp"
 #include "flusspferd/tracer.hpp"
 #include "flusspferd/spidermonkey/init.hpp"
 #include "flusspferd/spidermonkey/context.hpp"
-#include "flusspferd/current_context_scope.hpp"
+#include "flusspferd/native_call_stats.hpp"
 #include <boost/foreach.hpp>
 #include <js/jsapi.h>
 
@@ -135,7 +136,7 @@ JSBool native_function_base::impl::call_helper(
     JSContext *ctx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 {
   FLUSSPFERD_CALLBACK_BEGIN {
-    current_context_scope scope(Impl::wrap_context(ctx));
+    Impl::callback_context_scope scope(ctx);
 
     JSObject *function = JSVAL_TO_OBJECT(argv[-2]);
 
@@ -157,7 +158,16 @@ JSBool native_function_base::impl::call_helper(
     x.result.bind(Impl::wrap_jsvalp(rval));
     x.function = Impl::wrap_object(function);
 
+    FLUSSPFERD_NATIVE_CALL_TIMER(
+      native_call_stats::function_call,
+      0,
+      x.function.function_name().to_string());
+
     self->call(x);
+
+    // Errors reported with set_pending_error() arrive without a C++ exception.
+    if (JS_IsExceptionPending(ctx))
+      return JS_FALSE;
   } FLUSSPFERD_CALLBACK_END;
 }
 
@@ -189,14 +199,14 @@ void native_function_base::impl::trace_op(
   }
 
   if (self) {
-    current_context_scope scope(Impl::wrap_context(ctx));
+    Impl::callback_context_scope scope(ctx);
     tracer tracer_(trc);
     self->trace(tracer_);
   }
 }
 
 void native_function_base::impl::finalize(JSContext *ctx, JSObject *priv) {
-  current_context_scope scope(Impl::wrap_context(ctx));
+  Impl::callback_context_scope scope(ctx);
 
   native_function_base *self = (native_function_base *)
     JS_GetInstancePrivate(ctx, priv, &function_priv_class, 0);
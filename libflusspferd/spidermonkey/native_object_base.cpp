@@ -31,19 +31,42 @@ THE SOFTWARE.
 #include "flusspferd/call_context.hpp"
 #include "flusspferd/root.hpp"
 #include "flusspferd/exception.hpp"
-#include "flusspferd/current_context_scope.hpp"
+#include "flusspferd/native_call_stats.hpp"
 #include "flusspferd/spidermonkey/init.hpp"
 #include "flusspferd/spidermonkey/jsid.hpp"
 #include <boost/unordered_map.hpp>
 #include <boost/variant.hpp>
+#include <typeinfo>
 
 using namespace flusspferd;
 
+#ifdef FLUSSPFERD_NATIVE_CALL_STATS
+// Array indices are counted together.
+static std::string call_stats_name(value const &id) {
+  return id.is_string() ? id.to_std_string() : "[]";
+}
+#endif
+
 class native_object_base::impl {
 public:
   static void finalize(JSContext *ctx, JSObject *obj);
   static JSBool call_helper(JSContext *, JSObject *, uintN, jsval *, jsval *);
 
+#ifdef FLUSSPFERD_NATIVE_CALL_STATS
+  static native_call_stats::kind call_stats_kind(property_mode mode) {
+    switch (mode) {
+    case property_add:
+      return native_call_stats::property_add;
+    case property_delete:
+      return native_call_stats::property_delete;
+    case property_get:
+      return native_call_stats::property_get;
+    default:
+      return native_call_stats::property_set;
+    }
+  }
+#endif
+
   static void trace_op(JSTracer *trc, JSObject *obj);
 
   template<property_mode>
@@ -217,7 +240,7 @@ void native_object_base::impl::finalize(JSContext *ctx, JSObject *obj) {
   void *p = JS_GetPrivate(ctx, obj);
 
   if (p) {
-    current_context_scope scope(Impl::wrap_context(ctx));
+    Impl::callback_context_scope scope(ctx);
     delete static_cast<native_object_base*>(p);
   }
 }
@@ -226,17 +249,18 @@ JSBool native_object_base::impl::call_helper(
     JSContext *ctx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 {
   FLUSSPFERD_CALLBACK_BEGIN {
-    current_context_scope scope(Impl::wrap_context(ctx));
+    Impl::callback_context_scope scope(ctx);
 
     JSObject *function = JSVAL_TO_OBJECT(argv[-2]);
 
-    native_object_base *self = 0;
-    
-    try {
-      self = &native_object_base::get_native(Impl::wrap_object(obj));
-    } catch (exception &) {
-      self = &native_object_base::get_native(Impl::wrap_object(function));
-    }
+    object self_o = Impl::wrap_object(obj);
+    if (!native_object_base::is_object_native(self_o))
+      self_o = Impl::wrap_object(function);
+
+    native_object_base *self = &native_object_base::get_native(self_o);
+
+    FLUSSPFERD_NATIVE_CALL_TIMER(
+      native_call_stats::object_call, typeid(*self).name(), std::string());
 
     call_context x;
 
@@ -247,6 +271,9 @@ JSBool native_object_base::impl::call_helper(
     x.function = Impl::wrap_object(function);
 
     self->self_call(x);
+
+    if (JS_IsExceptionPending(ctx))
+      return JS_FALSE;
   } FLUSSPFERD_CALLBACK_END;
 }
 #if defined(JSID_VOID) || defined(JS_USE_JSVAL_JSID_STRUCT_TYPES) // TODO add better check for new jsid/jsvalue API
@@ -260,13 +287,21 @@ JSBool native_object_base::impl::property_op(
 #endif
 {
   FLUSSPFERD_CALLBACK_BEGIN {
-    current_context_scope scope(Impl::wrap_context(ctx));
+    Impl::callback_context_scope scope(ctx);
 
     native_object_base &self =
       native_object_base::get_native(Impl::wrap_object(obj));
 
+    FLUSSPFERD_NATIVE_CALL_TIMER(
+      call_stats_kind(mode),
+      typeid(self).name(),
+      call_stats_name(Impl::wrap_jsid(id)));
+
     value data(Impl::wrap_jsvalp(vp));
     self.property_op(mode, Impl::wrap_jsid(id), data);
+
+    if (JS_IsExceptionPending(ctx))
+      return JS_FALSE;
   } FLUSSPFERD_CALLBACK_END;
 }
 
@@ -274,11 +309,16 @@ JSBool native_object_base::impl::new_resolve(
     JSContext *ctx, JSObject *obj, jsval id, uintN sm_flags, JSObject **objp)
 {
   FLUSSPFERD_CALLBACK_BEGIN {
-    current_context_scope scope(Impl::wrap_context(ctx));
+    Impl::callback_context_scope scope(ctx);
 
     native_object_base &self =
       native_object_base::get_native(Impl::wrap_object(obj));
 
+    FLUSSPFERD_NATIVE_CALL_TIMER(
+      native_call_stats::property_resolve,
+      typeid(self).name(),
+      call_stats_name(Impl::wrap_jsval(id)));
+
     unsigned flags = 0;
 
     if (sm_flags & JSRESOLVE_QUALIFIED)
@@ -295,6 +335,9 @@ JSBool native_object_base::impl::new_resolve(
     *objp = 0;
     if (self.property_resolve(Impl::wrap_jsval(id), flags))
       *objp = Impl::get_object(self);
+
+    if (JS_IsExceptionPending(ctx))
+      return JS_FALSE;
   } FLUSSPFERD_CALLBACK_END;
 }
 
@@ -302,7 +345,7 @@ JSBool native_object_base::impl::new_enumerate(
     JSContext *ctx, JSObject *obj, JSIterateOp enum_op, jsval *statep, jsid *idp)
 {
   FLUSSPFERD_CALLBACK_BEGIN {
-    current_context_scope scope(Impl::wrap_context(ctx));
+    Impl::callback_context_scope scope(ctx);
 
     native_object_base &self =
       native_object_base::get_native(Impl::wrap_object(obj));
@@ -349,7 +392,7 @@ JSBool native_object_base::impl::new_enumerate(
 void native_object_base::impl::trace_op(
     JSTracer *trc, JSObject *obj)
 {
-  current_context_scope scope(Impl::wrap_context(trc->context));
+  Impl::callback_context_scope scope(trc->context);
 
   native_object_base &self =
     native_object_base::get_native(Impl::wrap_object(obj));
@@ -32,6 +32,7 @@ THE SOFTWARE.
 #include "flusspferd/arguments.hpp"
 #include "flusspferd/string.hpp"
 #include "flusspferd/native_object_base.hpp"
+#include "flusspferd/spidermonkey/context.hpp"
 #include "flusspferd/spidermonkey/init.hpp"
 #include "flusspferd/spidermonkey/value.hpp"
 #include "flusspferd/spidermonkey/object.hpp"
@@ -323,6 +324,7 @@ value object::apply(object const &fn, arguments const &arg_) {
       Impl::get_jsvalp(result));
 
   if (!status) {
+    Impl::check_time_limit(cx);
     if (JS_IsExceptionPending(cx))
       throw exception("Could not call function");
     else
@@ -376,6 +378,7 @@ value object::call(char const *fn, arguments const &arg_) {
       Impl::get_jsvalp(result));
 
   if (!status) {
+    Impl::check_time_limit(cx);
     if (JS_IsExceptionPending(cx))
       throw exception("Could not call function");
     else
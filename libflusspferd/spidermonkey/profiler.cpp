@@ -0,0 +1,202 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "flusspferd/profiler.hpp"
+#include "flusspferd/init.hpp"
+#include "flusspferd/context.hpp"
+#include "flusspferd/exception.hpp"
+#include "flusspferd/spidermonkey/context.hpp"
+#include <boost/thread/tss.hpp>
+#include <boost/foreach.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <set>
+#include <js/jsapi.h>
+#include <js/jsdbgapi.h>
+
+using namespace flusspferd;
+
+namespace {
+  boost::thread_specific_ptr<profiler> p_instance;
+
+  // "name (file:line)" for script frames, "name [native]" otherwise.
+  std::string frame_name(JSContext *cx, JSStackFrame *fp) {
+    JSFunction *fun = JS_GetFrameFunction(cx, fp);
+    JSScript *script = JS_IsNativeFrame(cx, fp) ? 0 : JS_GetFrameScript(cx, fp);
+
+    std::ostringstream out;
+    char const *name = fun ? JS_GetFunctionName(fun) : 0;
+    if (name && *name)
+      out << name;
+    else
+      out << (fun ? "(anonymous)" : "(top level)");
+
+    if (script) {
+      char const *file = JS_GetScriptFilename(cx, script);
+      out << " (" << (file ? file : "?") << ':'
+          << JS_GetScriptBaseLineNumber(cx, script) << ')';
+    } else {
+      out << " [native]";
+    }
+
+    std::string result = out.str();
+    // Semicolons separate the frames in the folded format.
+    std::replace(result.begin(), result.end(), ';', ',');
+    return result;
+  }
+
+  bool more_self_samples(
+    profiler::function_samples const &a, profiler::function_samples const &b)
+  {
+    if (a.self != b.self)
+      return a.self > b.self;
+    if (a.total != b.total)
+      return a.total > b.total;
+    return a.frame < b.frame;
+  }
+}
+
+void Impl::sample_stack(JSContext *cx, unsigned weight) {
+  std::vector<std::string> stack;
+  JSStackFrame *iter = 0;
+  JSStackFrame *fp;
+  while ((fp = JS_FrameIterator(cx, &iter)) != 0) {
+    if (!JS_GetFrameFunction(cx, fp) && !JS_GetFrameScript(cx, fp))
+      continue;
+    stack.push_back(frame_name(cx, fp));
+  }
+  if (stack.empty())
+    return;
+  std::reverse(stack.begin(), stack.end());
+  profiler::get().add_sample(stack, weight);
+}
+
+double const profiler::default_interval = 1;
+
+class profiler::impl {
+public:
+  impl() : samples(0) {}
+
+  unsigned long samples;
+  std::map<std::string, unsigned long> stacks;
+  std::map<std::string, function_samples> functions;
+};
+
+profiler &profiler::get() {
+  if (!p_instance.get())
+    p_instance.reset(new profiler);
+  return *p_instance;
+}
+
+profiler::profiler() : p(new impl) {}
+
+profiler::~profiler() {}
+
+void profiler::start(double interval_ms) {
+  if (interval_ms <= 0)
+    throw exception("The sampling interval must be positive", "RangeError");
+  Impl::set_sample_interval(Impl::get_context(current_context()), interval_ms);
+}
+
+void profiler::stop() {
+  Impl::set_sample_interval(Impl::get_context(current_context()), 0);
+}
+
+bool profiler::is_running() const {
+  return Impl::get_sample_interval(Impl::get_context(current_context())) > 0;
+}
+
+void profiler::reset() {
+  p->samples = 0;
+  p->stacks.clear();
+  p->functions.clear();
+}
+
+unsigned long profiler::samples() const {
+  return p->samples;
+}
+
+void profiler::add_sample(
+  std::vector<std::string> const &stack, unsigned weight)
+{
+  if (stack.empty() || !weight)
+    return;
+
+  p->samples += weight;
+
+  std::string folded;
+  std::set<std::string> seen;
+  BOOST_FOREACH(std::string const &frame, stack) {
+    if (!folded.empty())
+      folded += ';';
+    folded += frame;
+
+    // Recursive functions count once per sample in total.
+    if (seen.insert(frame).second) {
+      function_samples &f = p->functions[frame];
+      f.frame = frame;
+      f.total += weight;
+    }
+  }
+  p->functions[stack.back()].self += weight;
+  p->stacks[folded] += weight;
+}
+
+std::vector<profiler::function_samples> profiler::top(std::size_t n) const {
+  std::vector<function_samples> result;
+  result.reserve(p->functions.size());
+  typedef std::map<std::string, function_samples>::value_type entry;
+  BOOST_FOREACH(entry const &e, p->functions)
+    result.push_back(e.second);
+
+  n = std::min(n, result.size());
+  std::partial_sort(
+    result.begin(), result.begin() + n, result.end(), &more_self_samples);
+  result.resize(n);
+  return result;
+}
+
+void profiler::write_folded(std::ostream &out) const {
+  typedef std::map<std::string, unsigned long>::value_type entry;
+  BOOST_FOREACH(entry const &e, p->stacks)
+    out << e.first << ' ' << e.second << '\n';
+}
+
+void profiler::write_summary(std::ostream &out, std::size_t n) const {
+  double const percent = p->samples ? 100.0 / p->samples : 0;
+
+  out << p->samples << " samples\n"
+      << "   self  total  function\n";
+  BOOST_FOREACH(function_samples const &f, top(n)) {
+    out << std::fixed << std::setprecision(1)
+        << std::setw(6) << f.self * percent << '%'
+        << std::setw(6) << f.total * percent << "%  "
+        << f.frame << '\n';
+  }
+}
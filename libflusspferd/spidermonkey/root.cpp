@@ -25,69 +25,119 @@ THE SOFTWARE.
 */
 
 #include "flusspferd/root.hpp"
+#include "flusspferd/root_arena.hpp"
 #include "flusspferd/init.hpp"
-#include "flusspferd/exception.hpp"
 #include "flusspferd/value.hpp"
 #include "flusspferd/object.hpp"
 #include "flusspferd/string.hpp"
 #include "flusspferd/array.hpp"
 #include "flusspferd/spidermonkey/init.hpp"
-#include "flusspferd/spidermonkey/context.hpp"
 #include "flusspferd/spidermonkey/value.hpp"
 #include <js/jsapi.h>
+#include <vector>
+
+using namespace flusspferd;
+
+void Impl::root_block::link_block() {
+  if (!block_prev)
+    get_root_list().insert(*this);
+}
+
+void Impl::root_block::trace_block(void *opaque) {
+  JSTracer *trc = static_cast<JSTracer *>(opaque);
+
+  switch (block_kind) {
+  case value_slot:
+    JS_CALL_VALUE_TRACER(trc, *static_cast<jsval *>(block_data), "root_value");
+    break;
+  case object_slot:
+    if (JSObject *o = *static_cast<JSObject **>(block_data))
+      JS_CALL_OBJECT_TRACER(trc, o, "root_object");
+    break;
+  case string_slot:
+    if (JSString *s = *static_cast<JSString **>(block_data))
+      JS_CALL_STRING_TRACER(trc, s, "root_string");
+    break;
+  case value_vector:
+    {
+      std::vector<value> const &v =
+        *static_cast<std::vector<value> const *>(block_data);
+      for (std::size_t i = 0; i < v.size(); ++i)
+        JS_CALL_VALUE_TRACER(trc, get_jsval(v[i]), "root_arena");
+    }
+    break;
+  case jsval_vector:
+    {
+      std::vector<jsval> const &v =
+        *static_cast<std::vector<jsval> const *>(block_data);
+      for (std::size_t i = 0; i < v.size(); ++i)
+        JS_CALL_VALUE_TRACER(trc, v[i], "arguments");
+    }
+    break;
+  }
+}
+
+std::size_t Impl::root_block::block_size() const {
+  switch (block_kind) {
+  case value_vector:
+    return static_cast<std::vector<value> const *>(block_data)->size();
+  case jsval_vector:
+    return static_cast<std::vector<jsval> const *>(block_data)->size();
+  default:
+    return 1;
+  }
+}
 
 namespace flusspferd { namespace detail {
 
-#ifndef JS_TYPED_ROOTING_API
-#define JS_AddValueRoot(cx, ptr)       JS_AddRoot(cx, ptr)
-#define JS_AddGCThingRoot(cx, ptr)     JS_AddRoot(cx, ptr)
-#define JS_RemoveValueRoot(cx, ptr)    JS_RemoveRoot(cx, ptr)
-#define JS_RemoveGCThingRoot(cx, ptr)  JS_RemoveRoot(cx, ptr)
-#endif
+template<typename T>
+struct root_kind {
+  static Impl::root_block::kind_type const kind =
+    Impl::root_block::object_slot;
+};
+
+template<>
+struct root_kind<string> {
+  static Impl::root_block::kind_type const kind =
+    Impl::root_block::string_slot;
+};
 
 template<typename T>
 root<T>::root(T const &o)
-  : T(o)
+  : T(o), Impl::root_block(root_kind<T>::kind, T::get_gcptr())
 {
-  JSBool status = JS_AddGCThingRoot(
-    Impl::current_context(),
-    T::get_gcptr());
-
-  if (status == JS_FALSE) {
-    throw exception("Cannot root Javascript value");
-  }
+  link_block();
 }
 
 template<typename T>
-root<T>::~root() {
-  JS_RemoveGCThingRoot(
-    Impl::current_context(),
-    T::get_gcptr());
-}
+root<T>::~root() { }
 
 // value
 template<>
 root<value>::root(value const &o)
-  : value(o)
+  : value(o), Impl::root_block(value_slot, Impl::value_impl::getp())
 {
-  JSBool status = JS_AddValueRoot(
-    Impl::current_context(),
-    Impl::value_impl::getp());
-
-  if (status == JS_FALSE) {
-    throw exception("Cannot root Javascript value");
-  }
+  link_block();
 }
 
 template<>
-root<value>::~root() {
-  JS_RemoveValueRoot(
-    Impl::current_context(),
-    Impl::value_impl::getp());
-}
+root<value>::~root() { }
 
 template class root<value>;
 template class root<object>;
 template class root<string>;
 template class root<array>;
 }}
+
+root_arena::root_arena()
+  : Impl::root_block(value_vector, &slots)
+{
+  link_block();
+}
+
+root_arena::~root_arena() { }
+
+void root_arena::push(value const &v) {
+  slots.push_back(value());
+  slots.back() = v;
+}
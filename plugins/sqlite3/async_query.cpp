@@ -0,0 +1,310 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "async_query.hpp"
+#include <boost/bind.hpp>
+
+namespace sqlite3_plugin {
+
+// Result batches buffered before the thread waits for poll() to take some.
+static std::size_t const max_queued_results = 4;
+
+///////////////////////////
+async_executor::async_executor(std::string const &dsn)
+: dsn(dsn)
+, conn(0)
+, stopping(false)
+{
+}
+
+///////////////////////////
+async_executor::~async_executor()
+{
+    // The thread is done: it keeps the executor alive while running
+    if (thread) {
+        thread->detach();
+    }
+}
+
+///////////////////////////
+void async_executor::submit(async_job &job) {
+    boost::mutex::scoped_lock lock(mutex);
+
+    jobs.push_back(async_job());
+    jobs.back().swap(job);
+
+    if (!thread) {
+        thread.reset(new boost::thread(
+            boost::bind(&async_executor::run, shared_from_this())));
+    }
+    jobs_cond.notify_one();
+}
+
+///////////////////////////
+bool async_executor::take_result(async_result &out,
+                                 boost::optional<int> timeout)
+{
+    boost::mutex::scoped_lock lock(mutex);
+
+    if (timeout) {
+        boost::system_time const deadline =
+            boost::get_system_time() + boost::posix_time::milliseconds(*timeout);
+        while (results.empty())
+            if (!results_cond.timed_wait(lock, deadline))
+                break;
+    } else {
+        while (results.empty())
+            results_cond.wait(lock);
+    }
+
+    if (results.empty()) {
+        return false;
+    }
+    out.swap(results.front());
+    results.pop_front();
+    space_cond.notify_all();
+    return true;
+}
+
+///////////////////////////
+void async_executor::signal_stop() {
+    boost::mutex::scoped_lock lock(mutex);
+    stopping = true;
+    jobs.clear();
+    if (conn) {
+        sqlite3_interrupt(conn);
+    }
+    jobs_cond.notify_all();
+    space_cond.notify_all();
+}
+
+///////////////////////////
+void async_executor::shutdown() {
+    signal_stop();
+
+    if (thread) {
+        thread->join();
+        thread.reset();
+    }
+}
+
+///////////////////////////
+void async_executor::stop() {
+    signal_stop();
+
+    if (thread) {
+        thread->detach();
+        thread.reset();
+    }
+}
+
+///////////////////////////
+bool async_executor::push_result(async_result &r) {
+    boost::mutex::scoped_lock lock(mutex);
+    while (results.size() >= max_queued_results && !stopping)
+        space_cond.wait(lock);
+    if (stopping)
+        return false;
+    results.push_back(async_result());
+    results.back().swap(r);
+    results_cond.notify_all();
+    return true;
+}
+
+///////////////////////////
+void async_executor::run() {
+    ::sqlite3 *c = 0;
+    int rc = sqlite3_open_v2(dsn.c_str(), &c, SQLITE_OPEN_READWRITE, 0);
+    std::string open_error;
+    if (rc != SQLITE_OK) {
+        open_error = c ? sqlite3_errmsg(c) : "out of memory";
+        sqlite3_close(c);
+        c = 0;
+    }
+    else {
+        // Wait for writers on the main connection instead of failing
+        sqlite3_busy_timeout(c, 5000);
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        conn = c;
+    }
+
+    for (;;) {
+        async_job job;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            while (jobs.empty() && !stopping)
+                jobs_cond.wait(lock);
+            if (stopping)
+                break;
+            job.swap(jobs.front());
+            jobs.pop_front();
+        }
+
+        if (!c) {
+            async_result r;
+            r.id = job.id;
+            r.done = r.failed = true;
+            r.error = "SQLite3 Error: " + open_error;
+            push_result(r);
+            continue;
+        }
+
+        execute(job);
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        conn = 0;
+    }
+    sqlite3_close(c);
+}
+
+///////////////////////////
+namespace {
+    int bind_async_value(sqlite3_stmt *sth, int n, async_value const &v) {
+        // The job outlives the statement, so nothing has to be copied.
+        switch (v.kind) {
+        case async_value::integer_type:
+            return sqlite3_bind_int64(sth, n, sqlite3_int64(v.number));
+        case async_value::float_type:
+            return sqlite3_bind_double(sth, n, v.number);
+        case async_value::text_type:
+            return sqlite3_bind_text16(sth, n, v.text.data(),
+                                       int(v.text.size() * 2), SQLITE_STATIC);
+        case async_value::blob_type:
+            return sqlite3_bind_blob(sth, n, v.bytes.data(),
+                                     int(v.bytes.size()), SQLITE_STATIC);
+        default:
+            return sqlite3_bind_null(sth, n);
+        }
+    }
+
+    void read_row(sqlite3_stmt *sth, async_row &row) {
+        int cols = sqlite3_column_count(sth);
+        row.resize(cols);
+        for (int i = 0; i < cols; ++i) {
+            async_value &v = row[i];
+            switch (sqlite3_column_type(sth, i)) {
+            case SQLITE_INTEGER:
+                v.kind = async_value::integer_type;
+                v.number = double(sqlite3_column_int64(sth, i));
+                break;
+            case SQLITE_FLOAT:
+                v.kind = async_value::float_type;
+                v.number = sqlite3_column_double(sth, i);
+                break;
+            case SQLITE_TEXT:
+            {
+                v.kind = async_value::text_type;
+                flusspferd::js_char16_t const *text =
+                    static_cast<flusspferd::js_char16_t const*>(
+                        sqlite3_column_text16(sth, i));
+                if (text) {
+                    v.text.assign(text, sqlite3_column_bytes16(sth, i) / 2);
+                }
+            }
+            break;
+            case SQLITE_BLOB:
+            {
+                v.kind = async_value::blob_type;
+                char const *bytes =
+                    static_cast<char const*>(sqlite3_column_blob(sth, i));
+                if (bytes) {
+                    v.bytes.assign(bytes, sqlite3_column_bytes(sth, i));
+                }
+            }
+            break;
+            default:
+                v.kind = async_value::null_type;
+                break;
+            }
+        }
+    }
+}
+
+void async_executor::execute(async_job &job) {
+    async_result r;
+    r.id = job.id;
+
+    sqlite3_stmt *sth = 0;
+    int rc = sqlite3_prepare16_v2(conn, job.sql.data(), int(job.sql.size() * 2),
+                                  &sth, 0);
+    if (rc == SQLITE_OK && sth) {
+        int n = sqlite3_bind_parameter_count(sth);
+        if (std::size_t(n) > job.binds.size()) {
+            r.done = r.failed = true;
+            r.error = "SQLite3() not all placeholders bound on executed statement!";
+        }
+        for (int i = 1; i <= n && !r.failed; ++i) {
+            rc = bind_async_value(sth, i, job.binds[i - 1]);
+            if (rc != SQLITE_OK)
+                break;
+        }
+
+        while (rc == SQLITE_OK && !r.failed) {
+            int code = sqlite3_step(sth);
+            if (code == SQLITE_ROW) {
+                r.rows.push_back(async_row());
+                read_row(sth, r.rows.back());
+                if (r.rows.size() >= job.batch_size) {
+                    if (!push_result(r))
+                        break;
+                    r = async_result();
+                    r.id = job.id;
+                }
+            }
+            else if (code == SQLITE_DONE) {
+                r.done = true;
+                break;
+            }
+            else {
+                rc = code;
+            }
+        }
+    }
+
+    else if (rc == SQLITE_OK) {
+        // Nothing but whitespace or comments
+        r.done = true;
+    }
+
+    if (rc != SQLITE_OK && !r.failed) {
+        r.done = r.failed = true;
+        r.error = std::string("SQLite3 Error: ") + sqlite3_errmsg(conn);
+        r.rows.clear();
+    }
+
+    sqlite3_finalize(sth);
+
+    if (r.done) {
+        push_result(r);
+    }
+}
+
+}
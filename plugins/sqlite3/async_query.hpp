@@ -0,0 +1,148 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#ifndef GUARD_FLUSSPFERD_PLUGINS_SQLITE3_ASYNC_QUERY_HPP_INCLUDED
+#define GUARD_FLUSSPFERD_PLUGINS_SQLITE3_ASYNC_QUERY_HPP_INCLUDED
+
+#include "flusspferd/spidermonkey/string.hpp"
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <sqlite3.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace sqlite3_plugin {
+
+typedef std::basic_string<flusspferd::js_char16_t> u16string;
+
+// A bind parameter or result cell that does not depend on the JS runtime,
+// so it can be passed between threads.
+struct async_value {
+    enum kind_type { null_type, integer_type, float_type, text_type, blob_type };
+
+    async_value() : kind(null_type), number(0) {}
+
+    kind_type kind;
+    double number;
+    u16string text;
+    std::string bytes;
+};
+
+typedef std::vector<async_value> async_row;
+
+struct async_job {
+    async_job() : id(0), batch_size(0) {}
+
+    void swap(async_job &o) {
+        std::swap(id, o.id);
+        sql.swap(o.sql);
+        binds.swap(o.binds);
+        std::swap(batch_size, o.batch_size);
+    }
+
+    unsigned long id;
+    u16string sql;
+    async_row binds;
+    std::size_t batch_size;
+};
+
+// A batch of rows of one query. The last batch has done set; if the query
+// failed it has failed set and the message in error.
+struct async_result {
+    async_result() : id(0), done(false), failed(false) {}
+
+    void swap(async_result &o) {
+        std::swap(id, o.id);
+        std::swap(done, o.done);
+        std::swap(failed, o.failed);
+        error.swap(o.error);
+        rows.swap(o.rows);
+    }
+
+    unsigned long id;
+    bool done;
+    bool failed;
+    std::string error;
+    std::vector<async_row> rows;
+};
+
+// Runs queries on a thread with its own connection to the database file and
+// queues the results until the JS thread takes them. Only a few batches are
+// queued; then the thread waits for take_result() before reading more rows.
+// The thread holds a shared_ptr to the executor until it is finished, so it
+// must be created with new and owned by a shared_ptr.
+class async_executor
+    : boost::noncopyable,
+      public boost::enable_shared_from_this<async_executor>
+{
+public:
+    explicit async_executor(std::string const &dsn);
+    ~async_executor();
+
+    // Queue a query. The job is swapped out.
+    void submit(async_job &job);
+
+    // Take the next result, waiting at most timeout milliseconds (forever if
+    // not given). Returns false if there was none.
+    bool take_result(async_result &out, boost::optional<int> timeout);
+
+    // Interrupt the running query, drop the queued ones and stop the thread.
+    void shutdown();
+
+    // Like shutdown(), but does not wait for the thread: a running step may
+    // still wait for a lock for the whole busy timeout. The thread closes its
+    // connection and exits on its own.
+    void stop();
+
+private:
+    void run();
+    void execute(async_job &job);
+    void signal_stop();
+    // Waits while the queue is full. Returns false if shutting down.
+    bool push_result(async_result &r);
+
+    std::string dsn;
+    ::sqlite3 *conn; // only used by the thread, guarded for interrupts
+
+    boost::mutex mutex;
+    boost::condition_variable jobs_cond;
+    boost::condition_variable results_cond;
+    boost::condition_variable space_cond;
+    std::deque<async_job> jobs;
+    std::deque<async_result> results;
+    bool stopping;
+    boost::scoped_ptr<boost::thread> thread;
+};
+
+}
+
+#endif //GUARD_FLUSSPFERD_PLUGINS_SQLITE3_ASYNC_QUERY_HPP_INCLUDED
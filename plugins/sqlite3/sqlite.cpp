@@ -25,9 +25,12 @@ THE SOFTWARE.
 */
 
 #include "sqlite.hpp"
+#include "sqlite_blob.hpp"
 #include <boost/assign/list_of.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/fusion/include/make_vector.hpp>
+#include <algorithm>
+#include <vector>
 
 using namespace flusspferd;
 using namespace boost::assign;
@@ -35,6 +38,8 @@ namespace fusion = boost::fusion;
 
 namespace sqlite3_plugin {
 
+static int const default_statement_cache_size = 16;
+
 void raise_sqlite_error(::sqlite3* db)
 {
     std::string s = "SQLite3 Error: ";
@@ -42,16 +47,35 @@ void raise_sqlite_error(::sqlite3* db)
     throw exception(s.c_str());
 }
 
+static void check_statement_cache_size(int n)
+{
+    if (n < 0) {
+        throw exception("SQLite3.statementCacheSize must not be negative",
+                        "RangeError");
+    }
+}
+
 sqlite3::sqlite3(object const &obj, call_context &x)
 : base_type(obj)
 , db(0)
+, next_async_id(0)
+, in_batch(false)
 {
     if (x.arg.size() == 0) {
         throw exception ("SQLite3 requires more than 0 arguments");
     }
     string dsn = x.arg[0];
 
-    // TODO: pull arguments from 2nd/options argument
+    int cache_size = default_statement_cache_size;
+    if (x.arg.size() > 1 && x.arg[1].is_object()) {
+        object options = x.arg[1].get_object();
+        value size = options.get_property("statementCacheSize");
+        if (!size.is_undefined_or_null()) {
+            cache_size = int(size.to_integral_number(32, true));
+            check_statement_cache_size(cache_size);
+        }
+    }
+
     if (sqlite3_open(dsn.c_str(), &db) != SQLITE_OK) {
         if (db) {
             raise_sqlite_error(db);
@@ -60,17 +84,41 @@ sqlite3::sqlite3(object const &obj, call_context &x)
             throw std::bad_alloc(); // out of memory. better way to signal this?
         }
     }
+
+    cache.reset(new statement_cache(db, cache_size));
+    profiler.reset(new statement_profiler);
+    filename = dsn.to_string();
 }
 ///////////////////////////
 sqlite3::~sqlite3()
 {
+    // Don't wait for the query thread while collecting garbage, it may be
+    // waiting for a lock.
+    if (async) {
+        async->stop();
+        async.reset();
+    }
     close();
 }
 
 ///////////////////////////
 void sqlite3::close()
 {
+    if (in_batch) {
+        throw exception("SQLite3.close() called while executeBatch() is"
+                        " running");
+    }
+
+    if (async) {
+        async->shutdown();
+        async.reset();
+        async_callbacks.clear();
+    }
+
     if (db) {
+        // Cursors still in use finalize their statements themselves.
+        cache->close();
+        profiler->disable(db);
         sqlite3_close(db);
         db = NULL;
     }
@@ -136,6 +184,224 @@ void sqlite3::execMany(call_context & x) {
 
 }
 
+///////////////////////////
+namespace {
+    // Holds a statement taken from the cache and gives it back when the
+    // scope is left, also when an exception is thrown.
+    class cached_statement_guard {
+    public:
+        cached_statement_guard(statement_cache &cache,
+                               statement_profiler &profiler,
+                               statement_cache::key_type const &key)
+        : cache(cache), profiler(profiler), key(key), st(cache.acquire(key))
+        , active(true)
+        {}
+
+        ~cached_statement_guard() {
+            release();
+        }
+
+        void release() {
+            if (!active) {
+                return;
+            }
+            active = false;
+            if (profiler.enabled()) {
+                profiler.collect(st.sth, 0);
+            }
+            cache.release(key, st);
+        }
+
+        sqlite3_stmt *get() const { return st.sth; }
+
+    private:
+        statement_cache &cache;
+        statement_profiler &profiler;
+        statement_cache::key_type const &key;
+        statement_cache::statement st;
+        bool active;
+    };
+
+    // Marks the connection as running a batch until released or destroyed.
+    class batch_flag_guard {
+    public:
+        batch_flag_guard(bool &flag) : flag(flag), active(true) {
+            flag = true;
+        }
+
+        ~batch_flag_guard() {
+            release();
+        }
+
+        void release() {
+            if (active) {
+                flag = false;
+                active = false;
+            }
+        }
+
+    private:
+        bool &flag;
+        bool active;
+    };
+}
+
+void sqlite3::execute_batch(call_context & x) {
+    local_root_scope scope;
+    ensure_opened();
+
+    if (x.arg.size() < 2 || x.arg.size() > 3) {
+        throw exception("SQLite3.executeBatch() requires 2 or 3 arguments");
+    }
+
+    if (!x.arg[1].is_object() || !x.arg[1].get_object().is_array()) {
+        throw exception("SQLite3.executeBatch() expected an array of rows"
+                        " as second argument");
+    }
+    array rows = x.arg[1].get_object();
+
+    std::size_t chunk_size = 0;
+    bool transaction = true;
+    if (x.arg.size() > 2 && x.arg[2].is_object()) {
+        object options = x.arg[2].get_object();
+        value v = options.get_property("chunkSize");
+        if (!v.is_undefined_or_null()) {
+            chunk_size = std::size_t(v.to_integral_number(32, false));
+        }
+        v = options.get_property("transaction");
+        if (!v.is_undefined_or_null()) {
+            transaction = v.to_boolean();
+        }
+    }
+
+    // Don't try to nest transactions if the caller already started one.
+    transaction = transaction && sqlite3_get_autocommit(db);
+
+    string sql = x.arg[0].to_string();
+    statement_cache::key_type key(sql.data(), sql.length());
+
+    // Slow queries are only reported once the batch is done, and the
+    // connection can not be closed meanwhile by the code run to stringify
+    // the values.
+    batch_flag_guard batch(in_batch);
+    cached_statement_guard guard(*cache, *profiler, key);
+    sqlite3_stmt *sth = guard.get();
+
+    int const num_binds = sqlite3_bind_parameter_count(sth);
+    std::size_t const num_rows = rows.length();
+    if (chunk_size == 0) {
+        chunk_size = num_rows;
+    }
+
+    int count = 0;
+    bool in_transaction = false;
+    std::vector<value> values;
+    values.reserve(num_binds);
+
+    try {
+        for (std::size_t idx = 0; idx < num_rows; ++idx) {
+            if (transaction && !in_transaction) {
+                begin();
+                in_transaction = true;
+            }
+
+            value v = rows.get_element(idx);
+            if (!v.is_object() || !v.get_object().is_array()) {
+                throw exception("SQLite3.executeBatch() expects every row to"
+                                " be an array");
+            }
+            array row = v.get_object();
+            if (row.length() < std::size_t(num_binds)) {
+                throw exception("SQLite3.executeBatch(): row " +
+                                boost::lexical_cast<std::string>(idx) +
+                                " has fewer values than placeholders");
+            }
+
+            // Fetching and stringifying a value can run user code (getters,
+            // toString) which could resize or empty a blob bound earlier.
+            // So resolve the whole row first; after that no JS runs before
+            // the step and blobs can be bound without copying them.
+            values.clear();
+            for (int n = 0; n < num_binds; ++n) {
+                value e = row.get_element(n);
+                if (e.is_object() && !is_native<binary>(e.get_object())) {
+                    e = e.to_string();
+                }
+                values.push_back(e);
+            }
+            for (int n = 1; n <= num_binds; ++n) {
+                bind_value(sth, n, values[n - 1], false);
+            }
+
+            int code = sqlite3_step(sth);
+            if (code != SQLITE_DONE && code != SQLITE_ROW) {
+                raise_sqlite_error(db);
+            }
+            sqlite3_reset(sth);
+            count += sqlite3_changes(db);
+
+            if (in_transaction && (idx + 1) % chunk_size == 0) {
+                commit();
+                in_transaction = false;
+            }
+        }
+
+        if (in_transaction) {
+            commit();
+        }
+    }
+    catch (...) {
+        sqlite3_reset(sth);
+        if (in_transaction) {
+            sqlite3_exec(db, "ROLLBACK TRANSACTION", 0, 0, 0);
+        }
+        throw;
+    }
+
+    guard.release();
+    batch.release();
+    report_slow_queries();
+    x.result = count;
+}
+
+///////////////////////////
+void sqlite3::open_blob(call_context & x) {
+    local_root_scope scope;
+    ensure_opened();
+
+    if (x.arg.size() < 3 || x.arg.size() > 4) {
+        throw exception("SQLite3.openBlob() requires 3 or 4 arguments");
+    }
+
+    std::string table = x.arg[0].to_std_string();
+    std::string column = x.arg[1].to_std_string();
+    sqlite3_int64 rowid = sqlite3_int64(x.arg[2].to_number());
+
+    bool writable = false;
+    std::string database = "main";
+    if (x.arg.size() > 3 && x.arg[3].is_object()) {
+        object options = x.arg[3].get_object();
+        writable = options.get_property("write").to_boolean();
+        value v = options.get_property("database");
+        if (!v.is_undefined_or_null()) {
+            database = v.to_std_string();
+        }
+    }
+
+    sqlite3_blob *blob = 0;
+    if (sqlite3_blob_open(db, database.c_str(), table.c_str(), column.c_str(),
+                          rowid, writable ? 1 : 0, &blob) != SQLITE_OK)
+    {
+        if (blob) {
+            sqlite3_blob_close(blob);
+        }
+        raise_sqlite_error(db);
+    }
+
+    x.result = create<sqlite3_blob_stream>(
+        fusion::make_vector(blob, writable, object(*this)));
+}
+
 ///////////////////////////
 int sqlite3::exec_internal( array arr ) {
     local_root_scope scope;
@@ -160,10 +426,14 @@ int sqlite3::exec_internal( array arr ) {
         }
 
         object result = compile( obj.get_property("sql").to_string(), bind); 
-        
-        result.call("next");
 
+        // Run the statement and hand it back to the cache right away, so
+        // the next entry with the same SQL can reuse it.
+        sqlite3_cursor &cursor =
+            flusspferd::get_native<sqlite3_cursor>(result);
+        cursor.step();
         count += sqlite3_changes(db);
+        cursor.close();
     }
     
     return count;
@@ -173,23 +443,16 @@ int sqlite3::exec_internal( array arr ) {
 object sqlite3::compile(flusspferd::string sql_in, value bind ) {
     local_root_scope scope;
 
-    size_t n_bytes = sql_in.length() * 2;
-    sqlite3_stmt * sth = 0;
-    js_char16_t * tail = 0; // uncompiled part of the sql (when multiple stmts)
-    
-    if (sqlite3_prepare16_v2(db, sql_in.data(), n_bytes, &sth, (const void**)&tail) != SQLITE_OK)
-    {
-        raise_sqlite_error(db);
-    }
+    statement_cache::key_type key(sql_in.data(), sql_in.length());
+    statement_cache::statement st = cache->acquire(key);
 
-    object cursor = create<sqlite3_cursor>(fusion::make_vector(sth));
+    object cursor =
+        create<sqlite3_cursor>(
+            fusion::make_vector(object(*this), cache, profiler, key, st));
 
-    string tail_str;
-    if (tail) {
-        tail_str = string(tail);
-    }
-    
-    string sql = sql_in.substr( 0, sql_in.size() - tail_str.size() );
+    string sql = sql_in.substr(0, st.sql_length);
+    string tail_str =
+        sql_in.substr(st.sql_length, sql_in.length() - st.sql_length);
 
     cursor.define_property("sql", sql);
     cursor.define_property("tail", tail_str);        
@@ -224,6 +487,7 @@ void sqlite3::begin() {
     if ( sqlite3_exec(db, "BEGIN TRANSACTION", 0, 0, 0) != SQLITE_OK ) {
          raise_sqlite_error(db);
     }
+    report_slow_queries();
 }
 
 ///////////////////////////
@@ -233,6 +497,7 @@ void sqlite3::commit() {
     if ( sqlite3_exec(db, "COMMIT TRANSACTION", 0, 0, 0) != SQLITE_OK ) {
          raise_sqlite_error(db);
     }
+    report_slow_queries();
 }
 
 ///////////////////////////
@@ -242,7 +507,296 @@ void sqlite3::rollback() {
     if ( sqlite3_exec(db, "ROLLBACK TRANSACTION", 0, 0, 0) != SQLITE_OK ) {
         raise_sqlite_error(db);
     }
+    report_slow_queries();
+}
+
+///////////////////////////
+object sqlite3::statement_cache_stats() {
+    object stats = create<object>();
+    stats.set_property("hits", double(cache->hits()));
+    stats.set_property("misses", double(cache->misses()));
+    stats.set_property("evictions", double(cache->evictions()));
+    stats.set_property("size", double(cache->size()));
+    stats.set_property("capacity", double(cache->capacity()));
+    return stats;
+}
+
+///////////////////////////
+int sqlite3::get_statement_cache_size() {
+    return cache->capacity();
+}
+
+///////////////////////////
+void sqlite3::set_statement_cache_size(int n) {
+    check_statement_cache_size(n);
+    cache->set_capacity(n);
+}
+
+///////////////////////////
+namespace {
+    typedef statement_profiler::map_type::value_type stats_item;
+
+    bool by_total_time(stats_item const *a, stats_item const *b) {
+        return a->second.total_ms > b->second.total_ms;
+    }
+}
+
+array sqlite3::stats() {
+    statement_profiler::map_type const &entries = profiler->entries();
+
+    std::vector<stats_item const*> sorted;
+    sorted.reserve(entries.size());
+    for (statement_profiler::map_type::const_iterator it = entries.begin();
+         it != entries.end(); ++it)
+    {
+        sorted.push_back(&*it);
+    }
+    std::sort(sorted.begin(), sorted.end(), &by_total_time);
+
+    array result = create<array>();
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        statement_profiler::entry const &e = sorted[i]->second;
+        object o = create<object>();
+        o.set_property("sql", sorted[i]->first);
+        o.set_property("count", double(e.count));
+        o.set_property("totalTime", e.total_ms);
+        o.set_property("maxTime", e.max_ms);
+        o.set_property("rows", double(e.rows));
+        o.set_property("fullScanSteps", double(e.fullscan_steps));
+        o.set_property("sorts", double(e.sorts));
+        o.set_property("autoIndexes", double(e.autoindexes));
+        result.set_element(i, o);
+    }
+    return result;
+}
+
+///////////////////////////
+void sqlite3::reset_stats() {
+    profiler->reset();
+}
+
+///////////////////////////
+bool sqlite3::get_profiling() {
+    return profiler->enabled();
+}
+
+///////////////////////////
+void sqlite3::set_profiling(bool on) {
+    if (on == profiler->enabled()) {
+        return;
+    }
+    if (on) {
+        ensure_opened();
+        profiler->enable(db);
+    }
+    else {
+        profiler->disable(db);
+    }
+}
+
+///////////////////////////
+double sqlite3::get_slow_query_threshold() {
+    return profiler->threshold();
+}
+
+///////////////////////////
+void sqlite3::set_slow_query_threshold(double ms) {
+    if (ms < 0) {
+        throw exception("SQLite3.slowQueryThreshold must not be negative",
+                        "RangeError");
+    }
+    profiler->set_threshold(ms);
 }
 
+///////////////////////////
+void sqlite3::report_slow_queries() {
+    // Queries of a running batch stay queued until it is done.
+    if (in_batch || !profiler->has_slow_queries()) {
+        return;
+    }
+
+    local_root_scope scope;
+
+    std::vector<statement_profiler::slow_query> queries;
+    profiler->take_slow_queries(queries);
+
+    value callback = get_property("onSlowQuery");
+    if (!callback.is_object() || !callback.get_object().is_function()) {
+        return;
+    }
+
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        apply(callback.get_object(), queries[i].sql, queries[i].ms);
+    }
 }
 
+///////////////////////////
+namespace {
+    async_value to_async_value(value const &v) {
+        async_value result;
+
+        if (v.is_undefined()) {
+            throw exception("SQLite3.queryAsync() attempt to bind undefined"
+                            " value");
+        }
+        else if (v.is_int()) {
+            result.kind = async_value::integer_type;
+            result.number = v.get_int();
+        }
+        else if (v.is_double()) {
+            result.kind = async_value::float_type;
+            result.number = v.get_double();
+        }
+        else if (v.is_null()) {
+            result.kind = async_value::null_type;
+        }
+        else if (v.is_object() && is_native<binary>(v.get_object())) {
+            binary::vector_type const &vec =
+                flusspferd::get_native<binary>(v.get_object()).get_const_data();
+            result.kind = async_value::blob_type;
+            result.bytes.assign(vec.begin(), vec.end());
+        }
+        else {
+            string text = v.to_string();
+            result.kind = async_value::text_type;
+            result.text.assign(text.data(), text.length());
+        }
+        return result;
+    }
+
+    value from_async_value(async_value const &v) {
+        switch (v.kind) {
+        case async_value::integer_type:
+        case async_value::float_type:
+            return value(v.number);
+        case async_value::text_type:
+            return string(v.text);
+        case async_value::blob_type:
+            return create<byte_string>(fusion::make_vector(
+                reinterpret_cast<binary::element_type const*>(v.bytes.data()),
+                v.bytes.size()));
+        default:
+            return object();
+        }
+    }
+}
+
+void sqlite3::query_async(call_context &x) {
+    local_root_scope scope;
+    ensure_opened();
+
+    // (sql, callback), (sql, bind, callback) or (sql, bind, callback, options)
+    std::size_t cb_index = x.arg.size() == 2 ? 1 : 2;
+    if (x.arg.size() < 2 || x.arg.size() > 4 ||
+        !x.arg[cb_index].is_object() ||
+        !x.arg[cb_index].get_object().is_function())
+    {
+        throw exception("SQLite3.queryAsync() requires an SQL statement, optional"
+                        " bind parameters and a callback function");
+    }
+
+    if (filename.empty() || filename == ":memory:") {
+        throw exception("SQLite3.queryAsync() needs a database file, in-memory"
+                        " databases cannot be opened by a second connection");
+    }
+
+    async_job job;
+    string sql = x.arg[0].to_string();
+    job.sql.assign(sql.data(), sql.length());
+    job.batch_size = 100;
+
+    if (cb_index == 2 && !x.arg[1].is_undefined_or_null()) {
+        value bind = x.arg[1];
+        if (bind.is_object() && bind.get_object().is_array()) {
+            array a = bind.get_object();
+            for (std::size_t i = 0; i < a.length(); ++i) {
+                job.binds.push_back(to_async_value(a.get_element(i)));
+            }
+        }
+        else if (bind.is_object() && !is_native<binary>(bind.get_object())) {
+            throw exception("SQLite3.queryAsync() only supports positional"
+                            " (Array) bind parameters", "TypeError");
+        }
+        else {
+            job.binds.push_back(to_async_value(bind));
+        }
+    }
+
+    if (x.arg.size() == 4 && x.arg[3].is_object()) {
+        value v = x.arg[3].get_object().get_property("batchSize");
+        if (!v.is_undefined_or_null()) {
+            int n = v.to_integral_number(32, true);
+            if (n <= 0) {
+                throw exception("SQLite3.queryAsync() requires a positive"
+                                " batchSize", "RangeError");
+            }
+            job.batch_size = std::size_t(n);
+        }
+    }
+
+    if (!async) {
+        async.reset(new async_executor(filename));
+    }
+
+    job.id = ++next_async_id;
+    async_callbacks[job.id] = x.arg[cb_index];
+    x.result = value(double(job.id));
+    async->submit(job);
+}
+
+///////////////////////////
+int sqlite3::poll(boost::optional<int> timeout) {
+    int delivered = 0;
+    async_result r;
+
+    // Only wait for the first result, then take what is there already
+    while (!async_callbacks.empty() &&
+           async->take_result(r, delivered ? boost::optional<int>(0) : timeout))
+    {
+        local_root_scope scope;
+
+        std::map<unsigned long, value>::iterator it = async_callbacks.find(r.id);
+        if (it == async_callbacks.end()) {
+            continue;
+        }
+        root_value callback(it->second);
+        if (r.done) {
+            async_callbacks.erase(it);
+        }
+        ++delivered;
+
+        if (r.failed) {
+            apply(callback.get_object(), r.error, object(), true);
+            continue;
+        }
+
+        array rows = create<array>();
+        for (std::size_t i = 0; i < r.rows.size(); ++i) {
+            async_row const &src = r.rows[i];
+            array row = create<array>();
+            for (std::size_t j = 0; j < src.size(); ++j) {
+                row.set_element(j, from_async_value(src[j]));
+            }
+            rows.set_element(i, row);
+        }
+        apply(callback.get_object(), object(), rows, r.done);
+    }
+
+    return delivered;
+}
+
+///////////////////////////
+int sqlite3::get_pending_queries() {
+    return int(async_callbacks.size());
+}
+
+///////////////////////////
+void sqlite3::trace(tracer &trc) {
+    for (std::map<unsigned long, value>::iterator it = async_callbacks.begin();
+         it != async_callbacks.end(); ++it)
+    {
+        trc("SQLite3#async_callback", it->second);
+    }
+}
+
+}
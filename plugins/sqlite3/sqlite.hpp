@@ -29,6 +29,9 @@ THE SOFTWARE.
 #include "flusspferd.hpp"
 #include <sqlite3.h>
 #include "sqlite_cursor.hpp"
+#include "async_query.hpp"
+#include <boost/shared_ptr.hpp>
+#include <map>
 
 namespace sqlite3_plugin{
 
@@ -42,11 +45,26 @@ FLUSSPFERD_CLASS_DESCRIPTION(
         ("query", bind, query)
         ("exec", bind, exec)
         ("execMany", bind, execMany)
+        ("executeBatch", bind, execute_batch)
+        ("openBlob", bind, open_blob)
         ("close", bind, close)
         ("lastInsertID", bind, last_insert_id)
         ("begin", bind, begin)
         ("commit", bind, commit)
-        ("rollback", bind, rollback))
+        ("rollback", bind, rollback)
+        ("statementCacheStats", bind, statement_cache_stats)
+        ("stats", bind, stats)
+        ("resetStats", bind, reset_stats)
+        ("queryAsync", bind, query_async)
+        ("poll", bind, poll))
+    (properties,
+        ("statementCacheSize", getter_setter,
+            (get_statement_cache_size, set_statement_cache_size))
+        ("profiling", getter_setter, (get_profiling, set_profiling))
+        ("slowQueryThreshold", getter_setter,
+            (get_slow_query_threshold, set_slow_query_threshold))
+        ("onSlowQuery", variable, flusspferd::object())
+        ("pendingQueries", getter, get_pending_queries))
     (constructor_properties,
         ("version", constant, SQLITE_VERSION_NUMBER)
         ("versionStr", constant, SQLITE_VERSION)))
@@ -64,16 +82,51 @@ public: // JS methods
     void query(flusspferd::call_context &x);
     void exec(flusspferd::call_context & x);
     void execMany(flusspferd::call_context & x);
+    void execute_batch(flusspferd::call_context & x);
+    void open_blob(flusspferd::call_context & x);
     void last_insert_id(flusspferd::call_context &x);
 
     void begin();
     void commit();
     void rollback();
 
+    flusspferd::object statement_cache_stats();
+    int get_statement_cache_size();
+    void set_statement_cache_size(int n);
+
+    flusspferd::array stats();
+    void reset_stats();
+    bool get_profiling();
+    void set_profiling(bool on);
+    double get_slow_query_threshold();
+    void set_slow_query_threshold(double ms);
+
+    // Pass the slow queries recorded by the profiler to onSlowQuery.
+    void report_slow_queries();
+
+    void query_async(flusspferd::call_context &x);
+    int poll(boost::optional<int> timeout);
+    int get_pending_queries();
+
+    void trace(flusspferd::tracer &trc);
+
 protected:
     int exec_internal( flusspferd::array arr );
     flusspferd::object compile(flusspferd::string sql, flusspferd::value bind);
     void ensure_opened();
+
+    boost::shared_ptr<statement_cache> cache;
+    boost::shared_ptr<statement_profiler> profiler;
+
+    // Off-thread queries: the file they open and the callbacks of the
+    // queries that have not delivered their last batch yet.
+    std::string filename;
+    boost::shared_ptr<async_executor> async;
+    std::map<unsigned long, flusspferd::value> async_callbacks;
+    unsigned long next_async_id;
+
+    // Set while executeBatch() runs.
+    bool in_batch;
 };
 
 }
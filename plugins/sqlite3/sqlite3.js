@@ -57,11 +57,93 @@ if(!exports.SQLite3) {
 var SQLite3 = exports.SQLite3;
 
 /**
- *  new sqlite3.SQLite3(dsn)
+ *  new sqlite3.SQLite3(dsn[, options])
  *  - dsn (String): Path to database file, or ':memory:'
+ *  - options (Object): settings for the handle
  *
  *  Opens a handle to the database `dsn`, which will usually be a filename, but
  *  could also be ":memory:", or any other special string understood by SQLite3.
+ *
+ *  The only option so far is `statementCacheSize`, see
+ *  [[sqlite3.SQLite3#statementCacheSize]].
+ **/
+
+/**
+ *  sqlite3.SQLite3#statementCacheSize -> Number
+ *
+ *  Maximum number of prepared statements kept for reuse (16 by default, 0
+ *  disables the cache).
+ *
+ *  Statements are cached by their SQL text. When a cursor is closed, or a
+ *  statement run by [[sqlite3.SQLite3#exec]] finishes, the statement is reset
+ *  and kept, so running the same SQL again does not have to compile it again.
+ *  The least recently used statements are dropped when the cache is full.
+ **/
+
+/**
+ *  sqlite3.SQLite3#statementCacheStats() -> Object
+ *
+ *  Counters of the statement cache: `hits` and `misses` of lookups by SQL
+ *  text, `evictions` of statements dropped because the cache was full, and
+ *  the current `size` and `capacity`.
+ **/
+
+/**
+ *  sqlite3.SQLite3#profiling -> Boolean
+ *
+ *  Whether statements are profiled (off by default). While on, every
+ *  statement run through this handle is timed and its SQLite status counters
+ *  are collected; see [[sqlite3.SQLite3#stats]].
+ **/
+
+/**
+ *  sqlite3.SQLite3#slowQueryThreshold -> Number
+ *
+ *  Time in milliseconds from which a statement execution counts as slow
+ *  (0, the default, disables this). Only checked while
+ *  [[sqlite3.SQLite3#profiling]] is on.
+ **/
+
+/**
+ *  sqlite3.SQLite3#onSlowQuery -> Function
+ *
+ *  Called as `onSlowQuery(sql, milliseconds)` with `this` set to the handle
+ *  for every execution slower than [[sqlite3.SQLite3#slowQueryThreshold]].
+ *  It runs after the statement step that took that long has returned; for
+ *  [[sqlite3.SQLite3#executeBatch]] only once the whole batch is done.
+ *
+ *  ##### Example: #
+ *
+ *      db.profiling = true;
+ *      db.slowQueryThreshold = 50;
+ *      db.onSlowQuery = function(sql, ms) {
+ *        print('slow (' + ms + 'ms): ' + sql);
+ *      };
+ **/
+
+/**
+ *  sqlite3.SQLite3#stats() -> Array
+ *
+ *  Statistics collected while [[sqlite3.SQLite3#profiling]] was on, one
+ *  object per SQL text, ordered by total time (slowest first). Each has
+ *  these properties:
+ *
+ *  - `sql`: the statement
+ *  - `count`: number of executions
+ *  - `totalTime`, `maxTime`: execution time in milliseconds
+ *  - `rows`: number of rows returned to cursors
+ *  - `fullScanSteps`: steps in full table scans; a high value usually means a
+ *    missing index
+ *  - `sorts`: number of sort operations
+ *  - `autoIndexes`: rows inserted into automatic (temporary) indexes
+ *
+ *  The counters of a statement are added when its cursor is closed.
+ **/
+
+/**
+ *  sqlite3.SQLite3#resetStats() -> undefined
+ *
+ *  Discard the statistics collected so far.
  **/
 
 /**
@@ -81,7 +163,8 @@ var SQLite3 = exports.SQLite3;
  *  sqlite3.SQLite3#close() -> undefined
  *
  *  Close the database handle. Force the database handle to be closed now,
- *  instead of when the object gets garbage collected.
+ *  instead of when the object gets garbage collected. All cached statements
+ *  are finalized.
  **/
 
 /**
@@ -144,6 +227,30 @@ var SQLite3 = exports.SQLite3;
  *      ])
  **/
 
+/**
+ *  sqlite3.SQLite3#executeBatch(sql, rows[, options]) -> Number
+ *  - sql (String): SQL statement with positional placeholders
+ *  - rows (Array): an Array of Arrays, one per execution of `sql`
+ *  - options (Object): `chunkSize` and `transaction`
+ *
+ *  Executes `sql` once for every row in `rows`, binding the values of the row
+ *  to the placeholders in order. The statement is prepared only once and all
+ *  binding happens natively, which makes this much faster than calling
+ *  [[sqlite3.SQLite3#exec]] in a loop. Returns the number of rows affected.
+ *
+ *  Unless `transaction` is `false`, the rows are run inside transactions of
+ *  `chunkSize` rows each (all rows in one transaction by default). If a row
+ *  fails, the transaction of its chunk is rolled back and the error is thrown;
+ *  chunks already committed stay. No transaction is started when one is
+ *  already active.
+ *
+ *  ##### Example: #
+ *
+ *      db.executeBatch('INSERT INTO foobar VALUES(?,?,?)',
+ *                      [[1,2,3], [4,5,6], [7,8,9]],
+ *                      { chunkSize: 1000 });
+ **/
+
 /**
  * sqlite3.SQLite3#begin() -> undefined
  *
@@ -174,6 +281,79 @@ var SQLite3 = exports.SQLite3;
  *  later by using [[sqlite3.SQLite3.Cursor#bind]].
  **/
 
+/**
+ *  sqlite3.SQLite3#queryAsync(sql[, bind], callback[, options]) -> Number
+ *  - sql (String): SQL statement to run
+ *  - bind (Array): positional bind parameters for `sql`
+ *  - callback (Function): called as `callback(error, rows, done)`
+ *  - options (Object): `batchSize`, the number of rows per callback (100)
+ *
+ *  Run `sql` on a background thread and return an id for the query. The
+ *  thread uses its own connection to the database file, so this does not
+ *  work on `:memory:` databases, and the query only sees committed data.
+ *
+ *  Nothing is delivered until [[sqlite3.SQLite3#poll]] is called. The rows
+ *  arrive as arrays in batches; `done` is `true` for the last batch. If the
+ *  query fails, `error` is the error message and `rows` is `null`.
+ *
+ *  Only a few batches are buffered: once they are, the background thread
+ *  waits for [[sqlite3.SQLite3#poll]] to take them before reading further, so
+ *  large results are not held in memory as a whole. A query that is not
+ *  polled keeps its read transaction open meanwhile.
+ *
+ *  [[sqlite3.SQLite3#close]] waits for the background thread to stop. If the
+ *  handle is garbage collected instead, the thread is not waited for: it
+ *  closes its connection and exits on its own.
+ *
+ *  ##### Example: #
+ *
+ *      db.queryAsync('SELECT * FROM big_report', function(err, rows, done) {
+ *        if (err) throw new Error(err);
+ *        rows.forEach(handle_row);
+ *      });
+ *      while (db.pendingQueries) {
+ *        db.poll(10);
+ *        serve_requests();
+ *      }
+ **/
+
+/**
+ *  sqlite3.SQLite3#poll([timeout]) -> Number
+ *  - timeout (Number): milliseconds to wait for a result
+ *
+ *  Call the callbacks of [[sqlite3.SQLite3#queryAsync]] for all row batches
+ *  that are ready. If none are ready, waits up to `timeout` milliseconds (or
+ *  until one is, if no timeout is given). Returns immediately if no queries
+ *  are pending. Returns the number of callbacks made.
+ **/
+
+/**
+ *  sqlite3.SQLite3#pendingQueries -> Number
+ *
+ *  Number of [[sqlite3.SQLite3#queryAsync]] queries that have not delivered
+ *  their last batch yet. Closing the handle cancels them.
+ **/
+
+/**
+ *  sqlite3.SQLite3#openBlob(table, column, rowid[, options]) -> sqlite3.SQLite3.Blob
+ *  - table (String): name of the table
+ *  - column (String): name of the BLOB column
+ *  - rowid (Number): ROWID of the row
+ *  - options (Object): `write` (open for writing, default `false`) and
+ *    `database` (default `"main"`)
+ *
+ *  Open the BLOB in the given cell for incremental reading and writing,
+ *  without loading it into memory as a whole.
+ *
+ *  ##### Example: #
+ *
+ *      db.exec('INSERT INTO docs(body) VALUES(zeroblob(?))', [size]);
+ *      var blob = db.openBlob('docs', 'body', db.lastInsertID(),
+ *                             { write: true });
+ *      blob.write(chunk);
+ *      blob.close();
+ **/
+
 
 /**
  *  class sqlite3.SQLite3.Cursor
@@ -207,6 +387,51 @@ var SQLite3 = exports.SQLite3;
  *  array.
  **/
 
+/**
+ *  sqlite3.SQLite3.Cursor#fetchMany(count[, want_object]) -> Array
+ *  - count (Number): maximum number of rows to fetch
+ *  - want_object (Boolean): get the rows as objects or as arrays
+ *
+ *  Get up to `count` rows in one call, in the same form as
+ *  [[sqlite3.SQLite3.Cursor#next]] returns them. Fewer rows are returned when
+ *  the result set ends; an empty Array means there are no more rows.
+ *
+ *  Column names are read once per cursor, so row objects are cheap to build.
+ **/
+
+/**
+ *  sqlite3.SQLite3.Cursor#fetchAll([want_object]) -> Array
+ *  - want_object (Boolean): get the rows as objects or as arrays
+ *
+ *  Get all remaining rows in one call.
+ **/
+
+/**
+ *  sqlite3.SQLite3.Cursor#fetchColumns([options]) -> Array
+ *  - options (Object): `limit`, the maximum number of rows to read
+ *
+ *  Read the remaining rows (or up to `limit` rows) column by column into
+ *  packed buffers instead of one value per cell. Returns an Array with one
+ *  object per column with these properties:
+ *
+ *  - `name`: the column name
+ *  - `length`: the number of rows read
+ *  - `type`: `"number"`, `"text"` or `"blob"`, taken from the first non-NULL
+ *    value of the column; other values are converted by SQLite
+ *  - `data`: a [[binary.Float64Buffer]] of the values for numbers (NULL is
+ *    `NaN`), otherwise a [[binary.ByteString]] of all values concatenated
+ *    (text as UTF-8)
+ *  - `offsets`: only for text and blobs, a [[binary.Float64Buffer]] of
+ *    `length + 1` byte offsets, value `i` is `data.slice(offsets[i], offsets[i+1])`
+ *
+ *  ##### Example: #
+ *
+ *      var cols = db.query('SELECT price FROM items').fetchColumns();
+ *      var sum = 0, prices = cols[0].data;
+ *      for (var i = 0; i < prices.length; ++i)
+ *        sum += prices[i];
+ **/
+
 /**
  *  sqlite3.SQLite3.Cursor#close() -> undefined
  *
@@ -215,7 +440,8 @@ var SQLite3 = exports.SQLite3;
  *
  *  You don't _have_ to call this method, but its probably a good idea to call
  *  if you know you wont need to use this cursor any more, since garbage
- *  collection might take a long time to run.
+ *  collection might take a long time to run. Closing a cursor also returns its
+ *  statement to the statement cache of the database handle.
  **/
 
 /**
@@ -226,6 +452,41 @@ var SQLite3 = exports.SQLite3;
  *  This does not clear any bound parameters.
  **/
 
+/**
+ *  class sqlite3.SQLite3.Blob < IO.Stream
+ *
+ *  Stream reading and writing a single BLOB value, returned by
+ *  [[sqlite3.SQLite3#openBlob]].
+ *
+ *  The size of the BLOB cannot be changed through the stream; writes stop at
+ *  its end. Use SQL `zeroblob(n)` to create a BLOB of the needed size first.
+ *  Close all blobs before closing the database handle.
+ **/
+
+/**
+ *  sqlite3.SQLite3.Blob#length -> Number
+ *
+ *  Size of the BLOB in bytes.
+ **/
+
+/**
+ *  sqlite3.SQLite3.Blob#seek(offset) -> undefined
+ *
+ *  Move the read/write position to `offset` bytes from the start.
+ **/
+
+/**
+ *  sqlite3.SQLite3.Blob#tell() -> Number
+ *
+ *  Current read/write position.
+ **/
+
+/**
+ *  sqlite3.SQLite3.Blob#close() -> undefined
+ *
+ *  Close the blob handle now instead of when it gets garbage collected.
+ **/
+
 /**
  *  sqlite3.SQLite3.Cursor#__iterator__() -> Iterator
  *
@@ -235,6 +496,9 @@ var SQLite3 = exports.SQLite3;
  *      for (row in myCursor) { ... }
  *
  *  and each row will only be fetched from SQLite as needed, by calling [[sqlite3.SQLite3.Cursor#next]].
+ *  So the loop can be left and [[sqlite3.SQLite3.Cursor#next]] called
+ *  afterwards without losing rows. Use [[sqlite3.SQLite3.Cursor#fetchMany]]
+ *  to save the native call per row.
  **/
 
 // generators are easier to write in JS space
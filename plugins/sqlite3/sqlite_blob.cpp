@@ -0,0 +1,206 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "sqlite_blob.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace flusspferd;
+
+namespace sqlite3_plugin {
+
+///////////////////////////
+blob_streambuf::blob_streambuf(sqlite3_blob *blob, bool writable)
+: blob(blob)
+, writable(writable)
+, pos(0)
+{
+    setg(buffer, buffer, buffer);
+}
+
+///////////////////////////
+blob_streambuf::~blob_streambuf()
+{
+    close();
+}
+
+///////////////////////////
+void blob_streambuf::close() {
+    if (blob) {
+        sqlite3_blob_close(blob);
+        blob = 0;
+    }
+    setg(buffer, buffer, buffer);
+}
+
+///////////////////////////
+blob_streambuf::int_type blob_streambuf::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    int n = std::min(int(sizeof(buffer)), size() - pos);
+    if (n <= 0 || sqlite3_blob_read(blob, buffer, n, pos) != SQLITE_OK) {
+        return traits_type::eof();
+    }
+
+    setg(buffer, buffer, buffer + n);
+    pos += n;
+    return traits_type::to_int_type(*gptr());
+}
+
+///////////////////////////
+std::streamsize blob_streambuf::xsgetn(char *s, std::streamsize n) {
+    std::streamsize done = std::min(n, std::streamsize(egptr() - gptr()));
+    std::memcpy(s, gptr(), done);
+    gbump(int(done));
+
+    // Read the rest without going through the buffer
+    int rest = int(std::min(n - done, std::streamsize(size() - pos)));
+    if (rest > 0) {
+        if (sqlite3_blob_read(blob, s + done, rest, pos) != SQLITE_OK) {
+            return done;
+        }
+        pos += rest;
+        done += rest;
+        setg(buffer, buffer, buffer);
+    }
+    return done;
+}
+
+///////////////////////////
+blob_streambuf::int_type blob_streambuf::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        return traits_type::not_eof(c);
+    }
+    char ch = traits_type::to_char_type(c);
+    return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+}
+
+///////////////////////////
+std::streamsize blob_streambuf::xsputn(char const *s, std::streamsize n) {
+    if (!blob || !writable) {
+        return 0;
+    }
+
+    // Drop what was read ahead, writes go to the current position
+    pos = position();
+    setg(buffer, buffer, buffer);
+
+    int count = int(std::min(n, std::streamsize(size() - pos)));
+    if (count <= 0 || sqlite3_blob_write(blob, s, count, pos) != SQLITE_OK) {
+        return 0;
+    }
+    pos += count;
+    return count;
+}
+
+///////////////////////////
+blob_streambuf::pos_type blob_streambuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode)
+{
+    off_type base;
+    if (dir == std::ios_base::beg) {
+        base = 0;
+    } else if (dir == std::ios_base::cur) {
+        base = position();
+    } else {
+        base = size();
+    }
+
+    off_type np = base + off;
+    if (!blob || np < 0 || np > size()) {
+        return pos_type(off_type(-1));
+    }
+
+    pos = int(np);
+    setg(buffer, buffer, buffer);
+    return pos_type(np);
+}
+
+///////////////////////////
+blob_streambuf::pos_type blob_streambuf::seekpos(
+    pos_type p, std::ios_base::openmode which)
+{
+    return seekoff(off_type(p), std::ios_base::beg, which);
+}
+
+///////////////////////////
+sqlite3_blob_stream::sqlite3_blob_stream(object const &obj,
+                                         sqlite3_blob *blob,
+                                         bool writable,
+                                         object const &db)
+: base_type(obj, (std::streambuf*)0)
+, buf(blob, writable)
+, db(db)
+{
+    set_streambuf(&buf);
+}
+
+///////////////////////////
+sqlite3_blob_stream::~sqlite3_blob_stream()
+{
+}
+
+///////////////////////////
+void sqlite3_blob_stream::trace(tracer &trc) {
+    trc("SQLite3.Blob#db", db);
+}
+
+///////////////////////////
+void sqlite3_blob_stream::close() {
+    buf.close();
+}
+
+///////////////////////////
+void sqlite3_blob_stream::ensure_open() {
+    if (!buf.is_open()) {
+        throw exception("SQLite3.Blob method called on a closed blob");
+    }
+}
+
+///////////////////////////
+void sqlite3_blob_stream::seek(int offset) {
+    ensure_open();
+    if (buf.pubseekpos(offset) == std::streampos(std::streamoff(-1))) {
+        throw exception("SQLite3.Blob.seek() offset out of range",
+                        "RangeError");
+    }
+}
+
+///////////////////////////
+int sqlite3_blob_stream::tell() {
+    ensure_open();
+    return int(buf.pubseekoff(0, std::ios_base::cur));
+}
+
+///////////////////////////
+int sqlite3_blob_stream::get_length() {
+    ensure_open();
+    return buf.size();
+}
+
+}
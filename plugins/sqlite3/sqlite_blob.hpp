@@ -0,0 +1,105 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#ifndef GUARD_FLUSSPFERD_PLUGINS_SQLITE3_SQLITE_BLOB_HPP_INCLUDED
+#define GUARD_FLUSSPFERD_PLUGINS_SQLITE3_SQLITE_BLOB_HPP_INCLUDED
+
+#include "flusspferd.hpp"
+#include "flusspferd/io/stream.hpp"
+#include <sqlite3.h>
+#include <streambuf>
+
+namespace sqlite3_plugin {
+
+// streambuf over an open sqlite3_blob. Reads go through a small buffer (or
+// straight into the caller's memory for large reads), writes go directly to
+// the blob. The size of a blob is fixed, so writing stops at its end.
+class blob_streambuf : public std::streambuf {
+public:
+    blob_streambuf(sqlite3_blob *blob, bool writable);
+    ~blob_streambuf();
+
+    void close();
+    bool is_open() const { return blob != 0; }
+    int size() const { return blob ? sqlite3_blob_bytes(blob) : 0; }
+
+protected:
+    int_type underflow();
+    std::streamsize xsgetn(char *s, std::streamsize n);
+    int_type overflow(int_type c);
+    std::streamsize xsputn(char const *s, std::streamsize n);
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which);
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+private:
+    // Offset in the blob of the current read/write position.
+    int position() const { return pos - int(egptr() - gptr()); }
+
+    sqlite3_blob *blob;
+    bool writable;
+    int pos; // offset in the blob of the end of the get area
+    char buffer[4096];
+};
+
+FLUSSPFERD_CLASS_DESCRIPTION(
+    sqlite3_blob_stream,
+    (base, flusspferd::io::stream)
+    (constructible, false)
+    (full_name, "SQLite3.Blob")
+    (constructor_name, "Blob")
+    (methods,
+        ("close", bind, close)
+        ("seek", bind, seek)
+        ("tell", bind, tell))
+    (properties,
+        ("length", getter, get_length)))
+{
+public:
+    sqlite3_blob_stream(flusspferd::object const &obj,
+                        sqlite3_blob *blob,
+                        bool writable,
+                        flusspferd::object const &db);
+    ~sqlite3_blob_stream();
+
+    void trace(flusspferd::tracer &trc);
+
+public: // JS methods
+    void close();
+    void seek(int offset);
+    int tell();
+    int get_length();
+
+private:
+    void ensure_open();
+
+    blob_streambuf buf;
+    // The database handle, kept alive as long as the blob is reachable.
+    flusspferd::object db;
+};
+
+}
+
+#endif //GUARD_FLUSSPFERD_PLUGINS_SQLITE3_SQLITE_BLOB_HPP_INCLUDED
@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include "sqlite.hpp"
 #include <sstream>
 #include <new>
+#include <limits>
 #include <boost/lexical_cast.hpp>
 #include <boost/fusion/include/make_vector.hpp>
 
@@ -38,11 +39,22 @@ namespace sqlite3_plugin {
 
 ///////////////////////////
 // 'Private' constructor that is called from sqlite3::cursor
-sqlite3_cursor::sqlite3_cursor(object const &obj, sqlite3_stmt *_sth)
+sqlite3_cursor::sqlite3_cursor(object const &obj,
+                               object const &db,
+                               boost::shared_ptr<statement_cache> const &cache,
+                               boost::shared_ptr<statement_profiler> const &profiler,
+                               statement_cache::key_type const &sql,
+                               statement_cache::statement const &st)
 : base_type(obj)
-, sth(_sth)
+, sth(st.sth)
+, cache(cache)
+, cache_key(sql)
+, sql_length(st.sql_length)
+, db(db)
+, profiler(profiler)
+, rows_stepped(0)
 , state(CursorState_Init)
-, param_bound( sqlite3_bind_parameter_count(_sth), false )
+, param_bound( sqlite3_bind_parameter_count(st.sth), false )
 {        
 }
 
@@ -56,7 +68,12 @@ sqlite3_cursor::~sqlite3_cursor()
 ///////////////////////////
 void sqlite3_cursor::close() {
     if (sth) {
-        sqlite3_finalize(sth);
+        if (profiler->enabled()) {
+            profiler->collect(sth, rows_stepped);
+        }
+        rows_stepped = 0;
+        statement_cache::statement st = { sth, sql_length };
+        cache->release(cache_key, st);
         sth = NULL;
     }
 }
@@ -71,16 +88,30 @@ void sqlite3_cursor::reset() {
 void sqlite3_cursor::next(call_context & x) {
     local_root_scope scope;
 
+    if (!step()) {
+        // We've seen the last row, return the EOF indicator
+        x.result = object();
+        return;
+    }
+
+    if ( x.arg.size() == 1 && x.arg[0].is_boolean() && x.arg[0].get_boolean() ) {
+        x.result = create_result_object();
+    }
+    else {
+        x.result = create_result_array();
+    }
+}
+
+///////////////////////////
+bool sqlite3_cursor::step() {
     if (!sth){
         throw exception("SQLite3.Cursor.next called on closed cursor");
     }
 
     switch (state) {
         case CursorState_Finished:
-            // We've seen the last row, remember it and return the 
-            // EOF indicator
-            x.result = object();
-            return;
+            // We've seen the last row, remember it
+            return false;
         case CursorState_Errored:
             throw exception("SQLite3.Cursor: This cursor has seen an error and"
                             " needs to be reset");
@@ -94,8 +125,8 @@ void sqlite3_cursor::next(call_context & x) {
 
     if (code == SQLITE_DONE) {
         state = CursorState_Finished;
-        x.result = object();
-        return;
+        report_slow_queries();
+        return false;
     } else if (code != SQLITE_ROW) {
         if (sqlite3_errcode( sqlite3_db_handle(sth) ) != SQLITE_OK) {
             state = CursorState_Errored;
@@ -107,12 +138,15 @@ void sqlite3_cursor::next(call_context & x) {
     }
 
     state = CursorState_InProgress;
+    ++rows_stepped;
+    report_slow_queries();
+    return true;
+}
 
-    if ( x.arg.size() == 1 && x.arg[0].is_boolean() && x.arg[0].get_boolean() ) {
-        x.result = create_result_object();
-    }
-    else {
-        x.result = create_result_array();
+///////////////////////////
+void sqlite3_cursor::report_slow_queries() {
+    if (profiler->has_slow_queries()) {
+        flusspferd::get_native<sqlite3>(db).report_slow_queries();
     }
 }
 
@@ -132,19 +166,229 @@ object sqlite3_cursor::create_result_array() {
 ///////////////////////////
 object sqlite3_cursor::create_result_object() {
     local_root_scope scope;
-    // Build up the row object.
-    int cols = sqlite3_column_count(sth);
+    cache_column_names();
+    // Build up the row object. Setting the same names in the same order
+    // lets all rows share one shape.
+    int cols = int(column_names.size());
     object row = create<object>();
     for (int i=0; i < cols; i++)
+    {
+        row.set_property( column_names[i], get_column(i) );
+    }
+    return row;    
+}
+
+///////////////////////////
+void sqlite3_cursor::cache_column_names() {
+    if (!column_names.empty()) {
+        return;
+    }
+
+    int cols = sqlite3_column_count(sth);
+    std::vector<value> names;
+    names.reserve(cols);
+    for (int i=0; i < cols; i++)
     {
         js_char16_t const * name_str = reinterpret_cast<js_char16_t const *>( sqlite3_column_name16(sth, i) );
         if ( !name_str ) {
             throw exception("Couldn't retrieve column name for column");
         }
-        string name = std::basic_string<js_char16_t>(name_str);
-        row.set_property( name, get_column(i) );
+        names.push_back( string(name_str, std::char_traits<js_char16_t>::length(name_str)) );
     }
-    return row;    
+    column_names.swap(names);
+}
+
+///////////////////////////
+void sqlite3_cursor::trace(tracer &trc) {
+    trc("SQLite3.Cursor#db", db);
+    for (std::size_t i = 0; i < column_names.size(); ++i) {
+        trc("SQLite3.Cursor#column_name", column_names[i]);
+    }
+}
+
+///////////////////////////
+// Read up to max_rows rows (0 means all remaining) into an array.
+array sqlite3_cursor::fetch_rows(std::size_t max_rows, bool as_object) {
+    local_root_scope scope;
+
+    array rows = create<array>();
+    for (std::size_t n = 0; max_rows == 0 || n < max_rows; ++n) {
+        if (!step()) {
+            break;
+        }
+        if (as_object) {
+            rows.set_element(n, create_result_object());
+        }
+        else {
+            rows.set_element(n, create_result_array());
+        }
+    }
+    return rows;
+}
+
+///////////////////////////
+void sqlite3_cursor::fetch_many(call_context & x) {
+    local_root_scope scope;
+
+    if (x.arg.size() < 1 || x.arg.size() > 2) {
+        throw exception("SQLite3.Cursor.fetchMany() requires 1 or 2 arguments");
+    }
+
+    int n = x.arg[0].to_integral_number(32, true);
+    if (n <= 0) {
+        throw exception("SQLite3.Cursor.fetchMany() requires a positive count",
+                        "RangeError");
+    }
+
+    bool as_object = x.arg.size() == 2 && x.arg[1].to_boolean();
+    x.result = fetch_rows(std::size_t(n), as_object);
+}
+
+///////////////////////////
+void sqlite3_cursor::fetch_all(call_context & x) {
+    local_root_scope scope;
+
+    bool as_object = x.arg.size() >= 1 && x.arg[0].to_boolean();
+    x.result = fetch_rows(0, as_object);
+}
+
+///////////////////////////
+namespace {
+    // One column of a fetchColumns() result while it is being read. The kind
+    // is fixed by the first non-NULL value; later values are converted by
+    // SQLite to that kind.
+    struct packed_column {
+        enum kind_type { undecided, number, text, blob };
+
+        packed_column() : kind(undecided), rows(0) {}
+
+        kind_type kind;
+        std::size_t rows;
+        float64_buffer::vector_type numbers;
+        binary::vector_type bytes;
+        float64_buffer::vector_type offsets;
+
+        void decide(kind_type k) {
+            kind = k;
+            if (k == number) {
+                numbers.assign(rows, std::numeric_limits<double>::quiet_NaN());
+            }
+            else {
+                offsets.assign(rows + 1, 0.0);
+            }
+        }
+
+        void add_null() {
+            if (kind == number) {
+                numbers.push_back(std::numeric_limits<double>::quiet_NaN());
+            }
+            else if (kind != undecided) {
+                offsets.push_back(double(bytes.size()));
+            }
+            ++rows;
+        }
+
+        void add(sqlite3_stmt *sth, int i) {
+            int type = sqlite3_column_type(sth, i);
+            if (type == SQLITE_NULL) {
+                add_null();
+                return;
+            }
+
+            if (kind == undecided) {
+                decide(type == SQLITE_TEXT ? text :
+                       type == SQLITE_BLOB ? blob : number);
+            }
+
+            if (kind == number) {
+                numbers.push_back(sqlite3_column_double(sth, i));
+            }
+            else {
+                unsigned char const *p = kind == text ?
+                    sqlite3_column_text(sth, i) :
+                    reinterpret_cast<unsigned char const*>(
+                        sqlite3_column_blob(sth, i));
+                int n = sqlite3_column_bytes(sth, i);
+                if (p) {
+                    bytes.insert(bytes.end(), p, p + n);
+                }
+                offsets.push_back(double(bytes.size()));
+            }
+            ++rows;
+        }
+    };
+
+    object make_float64_buffer(float64_buffer::vector_type &v) {
+        float64_buffer &buf = create<float64_buffer>(
+            fusion::make_vector(float64_buffer::vector_type()));
+        buf.get_data().swap(v);
+        buf.update_external_bytes();
+        return buf;
+    }
+}
+
+void sqlite3_cursor::fetch_columns(call_context & x) {
+    local_root_scope scope;
+
+    std::size_t limit = 0;
+    if (x.arg.size() > 0 && x.arg[0].is_object()) {
+        value v = x.arg[0].get_object().get_property("limit");
+        if (!v.is_undefined_or_null()) {
+            int n = v.to_integral_number(32, true);
+            if (n <= 0) {
+                throw exception("SQLite3.Cursor.fetchColumns() requires a"
+                                " positive limit", "RangeError");
+            }
+            limit = std::size_t(n);
+        }
+    }
+
+    int cols = sqlite3_column_count(sth);
+    std::vector<packed_column> columns(cols);
+    std::size_t rows = 0;
+
+    for (; limit == 0 || rows < limit; ++rows) {
+        if (!step()) {
+            break;
+        }
+        for (int i = 0; i < cols; ++i) {
+            columns[i].add(sth, i);
+        }
+    }
+
+    cache_column_names();
+
+    array result = create<array>();
+    for (int i = 0; i < cols; ++i) {
+        packed_column &c = columns[i];
+        object col = create<object>();
+        col.set_property("name", column_names[i]);
+        col.set_property("length", value(double(rows)));
+
+        switch (c.kind) {
+        case packed_column::undecided:
+            // Only NULLs (or no rows at all)
+            c.decide(packed_column::number);
+            // fall through
+        case packed_column::number:
+            col.set_property("type", "number");
+            col.set_property("data", make_float64_buffer(c.numbers));
+            break;
+        case packed_column::text:
+        case packed_column::blob:
+            col.set_property("type",
+                             c.kind == packed_column::text ? "text" : "blob");
+            col.set_property("data",
+                create<byte_string>(fusion::make_vector(
+                    c.bytes.empty() ? 0 : &c.bytes[0], c.bytes.size())));
+            col.set_property("offsets", make_float64_buffer(c.offsets));
+            break;
+        }
+
+        result.set_element(i, col);
+    }
+
+    x.result = result;
 }
 
 ///////////////////////////
@@ -294,6 +538,16 @@ void sqlite3_cursor::bind_dict(object &o, size_t num_binds) {
 ///////////////////////////
 // Bind the actual para
 void sqlite3_cursor::do_bind_param(int n, value v) {
+    bind_value(sth, n, v);
+
+    if(n > 0 && size_t(n) <= param_bound.size())
+    {
+        param_bound[ size_t(n - 1) ] = true;
+    }
+}
+
+///////////////////////////
+void bind_value(sqlite3_stmt *sth, int n, value v, bool copy) {
     int ok;
 
     if (v.is_undefined()){
@@ -311,7 +565,8 @@ void sqlite3_cursor::do_bind_param(int n, value v) {
     } else if ( v.is_object() && is_native<binary>(v.get_object()) ) {
         binary & b = flusspferd::get_native<binary>(v.get_object());        
         binary::vector_type const & vec = b.get_const_data();
-        ok = sqlite3_bind_blob( sth, n, (vec.empty() ? 0 : &vec[0]), vec.size(), SQLITE_TRANSIENT );
+        ok = sqlite3_bind_blob( sth, n, (vec.empty() ? 0 : &vec[0]), vec.size(),
+                                copy ? SQLITE_TRANSIENT : SQLITE_STATIC );
     } else {
         // Default, stringify the object
         string bind = v.to_string();
@@ -319,12 +574,7 @@ void sqlite3_cursor::do_bind_param(int n, value v) {
     }    
 
     if (ok != SQLITE_OK) {
-        raise_sqlite_error(); 
-    }
-
-    if(n > 0 && size_t(n) <= param_bound.size())
-    {
-        param_bound[ size_t(n - 1) ] = true;
+        raise_sqlite_error(sqlite3_db_handle(sth)); 
     }
 }
 
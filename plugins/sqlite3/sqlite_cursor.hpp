@@ -27,10 +27,20 @@ THE SOFTWARE.
 #define GUARD_FLUSSPFERD_PLUGINS_SQLITE3_SQLITE_CURSOR_HPP_INCLUDED
 
 #include "flusspferd.hpp"
+#include "statement_cache.hpp"
+#include "statement_profiler.hpp"
+#include <boost/shared_ptr.hpp>
 #include <sqlite3.h>
 
 namespace sqlite3_plugin {
 
+// Bind v to placeholder n (1-based) of sth. Throws on undefined values and
+// on SQLite errors. With copy == false blobs are bound without copying
+// them (SQLITE_STATIC); the caller has to keep the binary alive and
+// unchanged until the statement has been stepped and reset.
+void bind_value(sqlite3_stmt *sth, int n, flusspferd::value v,
+                bool copy = true);
+
 FLUSSPFERD_CLASS_DESCRIPTION(
     sqlite3_cursor,
     (constructible, false)
@@ -40,15 +50,36 @@ FLUSSPFERD_CLASS_DESCRIPTION(
         ("close", bind, close)
         ("reset", bind, reset)
         ("next", bind, next)
+        ("fetchMany", bind, fetch_many)
+        ("fetchAll", bind, fetch_all)
+        ("fetchColumns", bind, fetch_columns)
         ("bind", bind, bind)))
 {
 public:
     sqlite3_cursor(flusspferd::object const &obj, 
-                   sqlite3_stmt *sth);
+                   flusspferd::object const &db,
+                   boost::shared_ptr<statement_cache> const &cache,
+                   boost::shared_ptr<statement_profiler> const &profiler,
+                   statement_cache::key_type const &sql,
+                   statement_cache::statement const &st);
     ~sqlite3_cursor();
 
+    // Execute the next step of the statement. Returns true if it produced a
+    // row, false when the statement is done.
+    bool step();
+
 private:
     sqlite3_stmt *sth;
+
+    // Where the statement goes back to when the cursor is closed.
+    boost::shared_ptr<statement_cache> cache;
+    statement_cache::key_type cache_key;
+    std::size_t sql_length;
+
+    // The SQLite3 object this cursor belongs to, for the slow query callback.
+    flusspferd::object db;
+    boost::shared_ptr<statement_profiler> profiler;
+    unsigned long rows_stepped;
   
     enum  {
         CursorState_Init = 0,
@@ -58,18 +89,30 @@ private:
     } state;
     std::vector<bool> param_bound;
 
+    // Column names as JS strings, filled in when the first row is turned
+    // into an object and reused for every following row.
+    std::vector<flusspferd::value> column_names;
+
     // Methods that help wiht binding
     void bind_array(flusspferd::array &a, size_t num_binds);
     void bind_dict(flusspferd::object &o, size_t num_binds);
     void do_bind_param(int n, flusspferd::value v);
     void raise_sqlite_error();
+    void report_slow_queries();
     flusspferd::value get_column(int i);
     object create_result_array();
     object create_result_object();
+    void cache_column_names();
+    flusspferd::array fetch_rows(std::size_t max_rows, bool as_object);
+public:
+    void trace(flusspferd::tracer &trc);
 public: // JS methods
     void close();
     void reset();
     void next(flusspferd::call_context & x);
+    void fetch_many(flusspferd::call_context & x);
+    void fetch_all(flusspferd::call_context & x);
+    void fetch_columns(flusspferd::call_context & x);
     void bind(flusspferd::call_context &x);    
     bool all_params_bound() const;
     void ensure_all_params_bound() const;
@@ -30,15 +30,20 @@ THE SOFTWARE.
 
 #include "sqlite.hpp"
 #include "sqlite_cursor.hpp"
+#include "sqlite_blob.hpp"
 
 using namespace flusspferd;
 
 // Put everything in an anon-namespace so typeid wont clash ever.
 namespace {
 
-FLUSSPFERD_LOADER_SIMPLE(exports) {
+FLUSSPFERD_LOADER(exports, context) {
+  // SQLite3.Blob derives from IO.Stream
+  context.call("require", "io");
+
   object ctor = load_class<sqlite3_plugin::sqlite3>(exports);
   load_class<sqlite3_plugin::sqlite3_cursor>(ctor);
+  load_class<sqlite3_plugin::sqlite3_blob_stream>(ctor);
 }
 
 }
@@ -0,0 +1,122 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "statement_cache.hpp"
+#include "sqlite.hpp"
+
+using namespace flusspferd;
+
+namespace sqlite3_plugin {
+
+///////////////////////////
+statement_cache::statement_cache(::sqlite3 *db, std::size_t capacity)
+: db(db)
+, capacity_(capacity)
+, hits_(0)
+, misses_(0)
+, evictions_(0)
+{
+}
+
+///////////////////////////
+statement_cache::~statement_cache()
+{
+    close();
+}
+
+///////////////////////////
+statement_cache::statement statement_cache::acquire(key_type const &sql) {
+    if (!db) {
+        throw exception("SQLite3 method called on a closed database handle");
+    }
+
+    boost::unordered_map<key_type, lru_list::iterator>::iterator it =
+        index.find(sql);
+
+    if (it != index.end()) {
+        ++hits_;
+        statement st = it->second->second;
+        lru.erase(it->second);
+        index.erase(it);
+        return st;
+    }
+
+    ++misses_;
+
+    statement st;
+    js_char16_t const *tail = 0; // uncompiled part of the sql
+    if (sqlite3_prepare16_v2(db, sql.data(), sql.size() * 2, &st.sth,
+                             (const void**)&tail) != SQLITE_OK)
+    {
+        raise_sqlite_error(db);
+    }
+    st.sql_length = tail ? tail - sql.data() : sql.size();
+    return st;
+}
+
+///////////////////////////
+void statement_cache::release(key_type const &sql, statement const &st) {
+    if (!db || !capacity_ || index.count(sql)) {
+        sqlite3_finalize(st.sth);
+        return;
+    }
+
+    sqlite3_reset(st.sth);
+    sqlite3_clear_bindings(st.sth);
+
+    lru.push_front(std::make_pair(sql, st));
+    index[sql] = lru.begin();
+
+    evict(capacity_);
+}
+
+///////////////////////////
+void statement_cache::close() {
+    for (lru_list::iterator it = lru.begin(); it != lru.end(); ++it) {
+        sqlite3_finalize(it->second.sth);
+    }
+    lru.clear();
+    index.clear();
+    db = 0;
+}
+
+///////////////////////////
+void statement_cache::set_capacity(std::size_t n) {
+    capacity_ = n;
+    evict(capacity_);
+}
+
+///////////////////////////
+void statement_cache::evict(std::size_t keep) {
+    while (lru.size() > keep) {
+        sqlite3_finalize(lru.back().second.sth);
+        index.erase(lru.back().first);
+        lru.pop_back();
+        ++evictions_;
+    }
+}
+
+}
@@ -0,0 +1,90 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#ifndef GUARD_FLUSSPFERD_PLUGINS_SQLITE3_STATEMENT_CACHE_HPP_INCLUDED
+#define GUARD_FLUSSPFERD_PLUGINS_SQLITE3_STATEMENT_CACHE_HPP_INCLUDED
+
+#include "flusspferd/spidermonkey/string.hpp"
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+#include <sqlite3.h>
+#include <list>
+#include <string>
+
+namespace sqlite3_plugin {
+
+// Idle prepared statements of one database handle, keyed by their SQL text
+// and kept in least recently used order. Cursors take a statement out of the
+// cache while they use it and give it back when they are closed; it is then
+// reset and its bindings cleared, so the next user only has to rebind.
+class statement_cache : boost::noncopyable {
+public:
+    typedef std::basic_string<flusspferd::js_char16_t> key_type;
+
+    struct statement {
+        sqlite3_stmt *sth;
+        // Number of characters of the SQL text compiled into sth. The rest
+        // of the text is the tail (the following statements).
+        std::size_t sql_length;
+    };
+
+    statement_cache(::sqlite3 *db, std::size_t capacity);
+    ~statement_cache();
+
+    // Take the idle statement for sql, or prepare a new one.
+    statement acquire(key_type const &sql);
+
+    // Give back a statement taken with acquire().
+    void release(key_type const &sql, statement const &st);
+
+    // Finalize all idle statements. Statements released afterwards are
+    // finalized right away.
+    void close();
+
+    std::size_t capacity() const { return capacity_; }
+    void set_capacity(std::size_t n);
+
+    std::size_t size() const { return index.size(); }
+    unsigned long hits() const { return hits_; }
+    unsigned long misses() const { return misses_; }
+    unsigned long evictions() const { return evictions_; }
+
+private:
+    typedef std::list<std::pair<key_type, statement> > lru_list;
+
+    void evict(std::size_t keep);
+
+    ::sqlite3 *db;
+    std::size_t capacity_;
+    lru_list lru; // most recently used first
+    boost::unordered_map<key_type, lru_list::iterator> index;
+    unsigned long hits_;
+    unsigned long misses_;
+    unsigned long evictions_;
+};
+
+}
+
+#endif //GUARD_FLUSSPFERD_PLUGINS_SQLITE3_STATEMENT_CACHE_HPP_INCLUDED
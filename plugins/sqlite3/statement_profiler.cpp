@@ -0,0 +1,109 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "statement_profiler.hpp"
+
+namespace sqlite3_plugin {
+
+///////////////////////////
+statement_profiler::entry::entry()
+: count(0)
+, total_ms(0)
+, max_ms(0)
+, rows(0)
+, fullscan_steps(0)
+, sorts(0)
+, autoindexes(0)
+{
+}
+
+///////////////////////////
+statement_profiler::statement_profiler()
+: enabled_(false)
+, threshold_(0)
+{
+}
+
+///////////////////////////
+void statement_profiler::enable(::sqlite3 *db) {
+    sqlite3_profile(db, &statement_profiler::profile_callback, this);
+    enabled_ = true;
+}
+
+///////////////////////////
+void statement_profiler::disable(::sqlite3 *db) {
+    if (db) {
+        sqlite3_profile(db, 0, 0);
+    }
+    enabled_ = false;
+}
+
+///////////////////////////
+void statement_profiler::profile_callback(
+    void *self_, char const *sql, sqlite3_uint64 ns)
+{
+    // Called from inside SQLite: only record, the slow query callback is run
+    // by the caller of sqlite3_step once it returns.
+    statement_profiler &self = *static_cast<statement_profiler*>(self_);
+    double ms = double(ns) / 1e6;
+
+    entry &e = self.entries_[sql];
+    ++e.count;
+    e.total_ms += ms;
+    if (ms > e.max_ms) {
+        e.max_ms = ms;
+    }
+
+    if (self.threshold_ > 0 && ms >= self.threshold_) {
+        slow_query q;
+        q.sql = sql;
+        q.ms = ms;
+        self.slow_.push_back(q);
+    }
+}
+
+///////////////////////////
+void statement_profiler::collect(sqlite3_stmt *sth, unsigned long rows) {
+    char const *sql = sqlite3_sql(sth);
+    if (!sql) {
+        return;
+    }
+
+    entry &e = entries_[sql];
+    e.rows += rows;
+    e.fullscan_steps +=
+        sqlite3_stmt_status(sth, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    e.sorts += sqlite3_stmt_status(sth, SQLITE_STMTSTATUS_SORT, 1);
+    e.autoindexes += sqlite3_stmt_status(sth, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+}
+
+///////////////////////////
+void statement_profiler::take_slow_queries(std::vector<slow_query> &out) {
+    out.clear();
+    out.swap(slow_);
+}
+
+}
@@ -0,0 +1,94 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#ifndef GUARD_FLUSSPFERD_PLUGINS_SQLITE3_STATEMENT_PROFILER_HPP_INCLUDED
+#define GUARD_FLUSSPFERD_PLUGINS_SQLITE3_STATEMENT_PROFILER_HPP_INCLUDED
+
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+namespace sqlite3_plugin {
+
+// Per-SQL statistics of one database handle. Execution times come from the
+// sqlite3_profile hook; the sqlite3_stmt_status counters and the number of
+// rows are collected when a statement is given back to the statement cache.
+class statement_profiler : boost::noncopyable {
+public:
+    struct entry {
+        entry();
+
+        unsigned long count;
+        double total_ms;
+        double max_ms;
+        unsigned long rows;
+        unsigned long fullscan_steps;
+        unsigned long sorts;
+        unsigned long autoindexes;
+    };
+
+    struct slow_query {
+        std::string sql;
+        double ms;
+    };
+
+    typedef boost::unordered_map<std::string, entry> map_type;
+
+    statement_profiler();
+
+    // Install or remove the profile hook on db.
+    void enable(::sqlite3 *db);
+    void disable(::sqlite3 *db);
+    bool enabled() const { return enabled_; }
+
+    // Executions taking at least this long are queued as slow queries.
+    // 0 turns this off.
+    double threshold() const { return threshold_; }
+    void set_threshold(double ms) { threshold_ = ms; }
+
+    // Add the status counters of sth (and resets them).
+    void collect(sqlite3_stmt *sth, unsigned long rows);
+
+    map_type const &entries() const { return entries_; }
+    void reset() { entries_.clear(); }
+
+    bool has_slow_queries() const { return !slow_.empty(); }
+    void take_slow_queries(std::vector<slow_query> &out);
+
+private:
+    static void profile_callback(void *self, char const *sql,
+                                 sqlite3_uint64 ns);
+
+    bool enabled_;
+    double threshold_;
+    map_type entries_;
+    std::vector<slow_query> slow_;
+};
+
+}
+
+#endif //GUARD_FLUSSPFERD_PLUGINS_SQLITE3_STATEMENT_PROFILER_HPP_INCLUDED
@@ -26,11 +26,21 @@ THE SOFTWARE.
 #include "subprocess.hpp"
 
 #include <flusspferd/io/stream.hpp>
+#include <flusspferd/binary.hpp>
+#include <flusspferd/create/native_object.hpp>
+#include <flusspferd/create/function.hpp>
+#include <flusspferd/local_root_scope.hpp>
+#include <flusspferd/create/array.hpp>
 
 #include <boost/asio.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #if defined(BOOST_POSIX_API)
 # include <boost/process/posix_status.hpp>
+# include <signal.h>
+# include <pthread.h>
+# include <errno.h>
+# include <unistd.h>
+# include <fcntl.h>
 typedef boost::asio::posix::stream_descriptor asio_stream;
 #elif defined(BOOST_WINDOWS_API)
 # include <boost/process/win32_child.hpp>
@@ -40,6 +50,12 @@ typedef boost::asio::windows::stream_handle asio_stream;
 #endif
 
 #include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/weak_ptr.hpp>
+#include <string>
+#include <vector>
 
 namespace ba = ::boost::asio;
 
@@ -145,143 +161,644 @@ value Subprocess::wait_impl(bool poll) {
   if (!s)
     return object();
 
-  value ret;
+  value ret = status_to_value(*s);
+
+  define_property("returncode", ret, read_only_property | permanent_property );
+  return ret;
+}
+
+value subprocess::status_to_value( bp::status const &s ) {
 #if defined(BOOST_POSIX_API)
 
-  bp::posix_status p(s.get());
+  bp::posix_status p(s);
   // Stupid thing is protected. grr.
   //bp::posix_status status(s);
 
   if (p.signaled())
-    ret = value(-p.term_signal());
+    return value(-p.term_signal());
   else
 #endif
-  if (s->exited())
-    ret = value(s->exit_status());
+  if (s.exited())
+    return value(s.exit_status());
   else
     // This is unlikely to happen
-    ret = object();
-
-  define_property("returncode", ret, read_only_property | permanent_property );
-  return ret;
+    return object();
 }
 
 namespace {
+  // The event loop all children's pipes are registered with. It is exposed
+  // to Javascript as subprocess.loop, so scripts can drive the I/O of many
+  // children at once (see Subprocess#communicateAsync). Each thread has its
+  // own runtime and thus its own loop.
+  struct event_loop {
+    ba::io_service svc;
+
+    // Number of communicate() / pipeline() calls currently running the loop
+    // for their own child.
+    int sync_runs;
+
+    // The first exception thrown by a communicateAsync callback while one of
+    // those calls was running the loop. It must not unwind that unrelated
+    // call, so it is kept for the next subprocess.loop method instead. Only
+    // its type and message are kept: the loop may outlive the runtime.
+    bool has_deferred_error;
+    std::string deferred_type, deferred_message;
+
+    event_loop() : sync_runs(0), has_deferred_error(false) {}
+  };
+
+  boost::thread_specific_ptr<event_loop> p_event_loop;
+
+  event_loop &get_event_loop() {
+    if ( !p_event_loop.get() )
+      p_event_loop.reset( new event_loop );
+    return *p_event_loop;
+  }
+
   ba::io_service &get_io_service() {
-    // TODO: ideally this wouldn't use its own io_service if there is one in the process already.
-    static ba::io_service svc;
-    return svc;
+    return get_event_loop().svc;
+  }
+
+  // Call from a catch block around a communicateAsync callback.
+  void defer_or_rethrow( flusspferd::exception const &e ) {
+    event_loop &loop = get_event_loop();
+    if ( !loop.sync_runs )
+      throw e;
+    if ( loop.has_deferred_error )
+      return;
+
+    loop.has_deferred_error = true;
+    loop.deferred_type = "Error";
+    loop.deferred_message = e.what();
+
+    local_root_scope scope;
+    value v = e.val();
+    if ( v.is_object() && !v.is_null() ) {
+      object o = v.get_object();
+      value name = o.get_property( "name" );
+      value message = o.get_property( "message" );
+      if ( name.is_string() )
+        loop.deferred_type = name.to_std_string();
+      if ( message.is_string() )
+        loop.deferred_message = message.to_std_string();
+    }
+  }
+
+  void rethrow_deferred() {
+    event_loop &loop = get_event_loop();
+    if ( !loop.has_deferred_error )
+      return;
+    loop.has_deferred_error = false;
+    throw exception( loop.deferred_message, loop.deferred_type );
+  }
+
+  // Run one handler on behalf of a synchronous call.
+  void run_one_sync( ba::io_service &svc ) {
+    event_loop &loop = get_event_loop();
+    ++loop.sync_runs;
+    try {
+      svc.run_one();
+    }
+    catch (...) {
+      --loop.sync_runs;
+      throw;
+    }
+    --loop.sync_runs;
+    if ( svc.stopped() )
+      svc.reset();
+  }
+
+  // Run handlers of the loop; returns how many ran. Like io_service::run,
+  // the loop has to be restarted once it ran out of work.
+  int run_loop( std::size_t (ba::io_service::*fn)() ) {
+    rethrow_deferred();
+
+    ba::io_service &svc = get_io_service();
+    std::size_t n = (svc.*fn)();
+    if ( svc.stopped() )
+      svc.reset();
+    return int(n);
+  }
+
+  int loop_run() {
+    return run_loop( &ba::io_service::run );
+  }
+
+  int loop_run_one() {
+    return run_loop( &ba::io_service::run_one );
+  }
+
+  int loop_poll() {
+    return run_loop( &ba::io_service::poll );
   }
 }
 
-void Subprocess::handle_write( error_code const &ec, bool &done ) {
-  if (ec)
-    throw boost::system::system_error(ec, "Subprocess: writing to stdin");
+void subprocess::load_event_loop( object &exports ) {
+  object loop = create<object>();
+  exports.define_property( "loop", loop, read_only_property | permanent_property );
 
-  done = true;
+  create<function>( "run", &loop_run, param::_container = loop );
+  create<function>( "runOne", &loop_run_one, param::_container = loop );
+  create<function>( "poll", &loop_poll, param::_container = loop );
 }
 
 namespace {
+  // Reads one pipe. By default everything read is collected in a growing
+  // native buffer, which is turned into a string (decoded as UTF-8 in one
+  // go, so multibyte sequences split across reads are no problem) or a
+  // ByteString only once the pipe is at EOF. If on_data is set the chunks are
+  // passed to it instead; when it returns false reading pauses until
+  // resume() is called. A read error ends reading like EOF does and is kept
+  // in error: the handler may run on behalf of another child's call, so it
+  // must not throw.
   struct reader_state : public boost::enable_shared_from_this<reader_state> {
-    boost::array<char, 4096> buff;
-    bool &done;
+    std::vector<char> buff;
+    binary::vector_type data;
+    bool done;
+    bool paused;
+    error_code error;
     boost::scoped_ptr<asio_stream> s;
-    string str;
-    object o;
     std::string prop;
 
-    reader_state(bp::pistream &s_, ba::io_service &svc, bool &done_, object o_, std::string const &prop_)
-      : done(done_),
+    boost::function<bool (char const *, std::size_t)> on_data;
+    boost::function<void ()> on_eof;
+
+    reader_state(bp::pistream &s_, ba::io_service &svc, std::string const &prop_, std::size_t chunk_size)
+      : buff(chunk_size),
+        done(false),
+        paused(false),
         s(new asio_stream(svc)),
-        o(o_),
         prop(prop_)
     {
       s->assign( s_.handle().release() );
-      o.set_property(prop, str);
-      done = false;
     }
 
     void handle_read( error_code const &ec, std::size_t n_read ) {
+      bool more = true;
+
       if (n_read) {
-        str = string::concat( str, string(buff.data(), n_read) );
-        o.set_property(prop, str);
+        if (on_data) {
+          // Stays paused if the callback throws
+          paused = true;
+          more = on_data( &buff[0], n_read );
+          paused = false;
+        }
+        else
+          data.insert( data.end(), buff.begin(), buff.begin() + n_read );
       }
 
       // OSX gives EoF, Win32 gives EPIPE error.
-      if (ec == ba::error::eof || ec == ba::error::broken_pipe) {
+      if (ec && ec != ba::error::eof && ec != ba::error::broken_pipe)
+        error = ec;
+
+      if (ec) {
         s->close();
         done = true;
+        if (on_eof)
+          on_eof();
       }
-      else if (ec)
-        throw boost::system::system_error(ec, std::string("Subprocess: reading from ") + prop + " pipe");
-      else
+      else if (more)
         enqueue();
+      else
+        paused = true;
     }
 
+    std::string error_message() const {
+      return boost::system::system_error(
+        error, std::string("Subprocess: reading from ") + prop + " pipe").what();
+    }
+
+    void raise_error() const {
+      if (error)
+        throw exception( error_message() );
+    }
 
     void enqueue() {
-      ba::async_read(
-        *s, ba::buffer(buff),
+      s->async_read_some(
+        ba::buffer(buff),
         boost::bind( &reader_state::handle_read, shared_from_this(),
           boost::asio::placeholders::error,
           boost::asio::placeholders::bytes_transferred )
       );
     }
+
+    void resume() {
+      if (paused && !done) {
+        paused = false;
+        enqueue();
+      }
+    }
+
+    value result(bool as_binary) {
+      if (as_binary) {
+        byte_string &b = create<byte_string>( boost::fusion::make_vector(
+          (binary::element_type const*)0, std::size_t(0) ) );
+        b.get_data().swap(data);
+        b.update_external_bytes();
+        return b;
+      }
+      if (data.empty())
+        return string();
+      return string( reinterpret_cast<char const*>(&data[0]), data.size() );
+    }
   };
-}
 
-object Subprocess::communicate( optional<value> input_ ) {
+  std::size_t const default_chunk_size = 64 * 1024;
 
-  // stupid non-copyable root<T> objects. Right PITA they are.
-  boost::scoped_ptr<root_string> root_input;
+  struct communicate_options {
+    communicate_options() : as_binary(false), chunk_size(default_chunk_size) {}
 
-  ba::io_service &svc = get_io_service();
+    bool as_binary;
+    std::size_t chunk_size;
+  };
 
-  bool done_stdout = true, done_stderr = true, done_stdin = true;
+  communicate_options parse_options( optional<value> const &options_ ) {
+    communicate_options opts;
+    if ( options_ && options_->is_object() ) {
+      object options = options_->get_object();
+      opts.as_binary = options.get_property("binary").to_boolean();
+
+      value v = options.get_property("chunkSize");
+      if ( !v.is_undefined_or_null() ) {
+        int n = v.to_integral_number(32, true);
+        if ( n <= 0 )
+          throw exception("Subprocess#communicate: chunkSize must be positive", "RangeError");
+        opts.chunk_size = std::size_t(n);
+      }
+    }
+    return opts;
+  }
 
-  if ( input_ ) {
-    if ( stdin_ && stdin_->is_undefined() )
-      throw exception("Subprocess#communicate: input provided when child's stdin is closed");
+  // The input for the child. It is copied, so scripts running from the loop
+  // meanwhile cannot change it under the pending write, and stdin is closed
+  // afterwards so the child sees EOF. The pending write owns the state, so it
+  // survives its caller unwinding. Like reader_state it does not throw from
+  // the handler; a child that exits without reading all of its input is not
+  // an error (as with Python's communicate).
+  struct input_state : public boost::enable_shared_from_this<input_state> {
+    std::string data;
+    std::size_t written;
+    bp::detail::file_handle::handle_type fd;
+    boost::scoped_ptr<asio_stream> in;
+    bool done;
+    error_code error;
+    boost::function<void ()> on_done;
+
+    input_state() : written(0), done(false) {}
+
+    void start( bp::postream &s, value const &input, ba::io_service &svc ) {
+      if ( input.is_object() && is_native<binary>( input.get_object() ) ) {
+        binary::vector_type const &v =
+          flusspferd::get_native<binary>( input.get_object() ).get_const_data();
+        data.assign( v.begin(), v.end() );
+      }
+      else
+        data = input.to_std_string();
+
+      fd = s.handle().release();
+      in.reset( new asio_stream( svc ) );
+      in->assign( fd );
+
+#if defined(BOOST_POSIX_API)
+      // Writes are done by hand, see write_ready()
+      ::fcntl( fd, F_SETFL, ::fcntl( fd, F_GETFL ) | O_NONBLOCK );
+      wait_writable();
+#else
+      ba::async_write( *in, ba::buffer( data ),
+        boost::bind( &input_state::handle_write, shared_from_this(),
+          ba::placeholders::error ) );
+#endif
+    }
 
-    done_stdin = false;
+#if defined(BOOST_POSIX_API)
+    void wait_writable() {
+      in->async_write_some( ba::null_buffers(),
+        boost::bind( &input_state::write_ready, shared_from_this(),
+          ba::placeholders::error ) );
+    }
 
-    // We need the string to be rooted until the async_write compeltes.
-    root_input.reset( new root_string( input_->to_string() ) );
-    std::string const &s = root_input->to_string();
+    // Write with SIGPIPE blocked, so a child that exited early gives EPIPE
+    // instead of killing us. The signal is only blocked for the write itself
+    // (no children are started meanwhile, which would inherit the mask).
+    void write_ready( error_code const &ec ) {
+      if (ec) {
+        handle_write(ec);
+        return;
+      }
 
-    asio_stream in( svc );
-    in.assign( child_.get_stdin().handle().release() );
+      while ( written < data.size() ) {
+        sigset_t pipe_set, old_set, pending;
+        sigemptyset( &pipe_set );
+        sigaddset( &pipe_set, SIGPIPE );
+        sigpending( &pending );
+        bool was_pending = sigismember( &pending, SIGPIPE );
+
+        pthread_sigmask( SIG_BLOCK, &pipe_set, &old_set );
+        ssize_t n = ::write( fd, data.data() + written, data.size() - written );
+        int saved_errno = errno;
+        if ( n < 0 && saved_errno == EPIPE && !was_pending ) {
+          sigpending( &pending );
+          if ( sigismember( &pending, SIGPIPE ) ) {
+            int sig;
+            sigwait( &pipe_set, &sig );
+          }
+        }
+        pthread_sigmask( SIG_SETMASK, &old_set, 0 );
+
+        if ( n < 0 ) {
+          if ( saved_errno == EINTR )
+            continue;
+          if ( saved_errno == EAGAIN || saved_errno == EWOULDBLOCK ) {
+            wait_writable();
+            return;
+          }
+          handle_write( error_code( saved_errno, boost::system::get_system_category() ) );
+          return;
+        }
+        written += std::size_t(n);
+      }
 
-    ba::async_write( in, ba::buffer( s.data(), s.size() ),
-      boost::bind( &Subprocess::handle_write, this, ba::placeholders::error, done_stdin )
-    );
+      handle_write( error_code() );
+    }
+#endif
+
+    void handle_write( error_code const &ec ) {
+      error_code ignored;
+      in->close(ignored);
+      done = true;
+
+      if (ec && ec != ba::error::broken_pipe)
+        error = ec;
+
+      if (on_done)
+        on_done();
+    }
+
+    std::string error_message() const {
+      return boost::system::system_error(error, "Subprocess: writing to stdin").what();
+    }
+
+    void raise_error() const {
+      if (error)
+        throw exception( error_message() );
+    }
+  };
+}
+
+object Subprocess::communicate( optional<value> input_, optional<value> options_ ) {
+  ba::io_service &svc = get_io_service();
+  communicate_options opts = parse_options( options_ );
+
+  if ( async_ )
+    throw exception("Subprocess#communicate: communicateAsync is in progress");
+
+  boost::shared_ptr<input_state> input;
+  if ( input_ && !input_->is_undefined_or_null() ) {
+    if ( stdin_ && stdin_->is_undefined() )
+      throw exception("Subprocess#communicate: input provided when child's stdin is closed");
+
+    input.reset( new input_state );
+    input->start( child_.get_stdin(), *input_, svc );
   }
 
   object ret = create<object>();
   root_object root_ret(ret);
 
+  boost::shared_ptr<reader_state> out, err;
+
   if ( !stdout_ || !stdout_->is_undefined() ) {
-    boost::shared_ptr<reader_state> r(new reader_state(child_.get_stdout(), svc, done_stdout, ret, "stdout"));
-    r->enqueue();
+    out.reset(new reader_state(child_.get_stdout(), svc, "stdout", opts.chunk_size));
+    out->enqueue();
+  }
+
+  if ( !stderr_ || !stderr_->is_undefined() ) {
+    err.reset(new reader_state(child_.get_stderr(), svc, "stderr", opts.chunk_size));
+    err->enqueue();
+  }
+
+  // Only run until this child is done, other children registered with the
+  // loop make progress meanwhile.
+  while ( (out && !out->done) || (err && !err->done) || (input && !input->done) )
+    run_one_sync( svc );
+
+  value code = wait();
+
+  if ( input )
+    input->raise_error();
+  if ( out )
+    out->raise_error();
+  if ( err )
+    err->raise_error();
+
+  ret.set_property("stdout", out ? out->result(opts.as_binary) : value(object()));
+  ret.set_property("stderr", err ? err->result(opts.as_binary) : value(object()));
+  ret.set_property("returncode", code);
+
+  return ret;
+}
+
+// State of a communicateAsync() call. It roots the Subprocess object and the
+// callbacks until the child is done.
+struct Subprocess::async_state
+  : public boost::enable_shared_from_this<Subprocess::async_state>
+{
+  root_object self;
+  root_value on_stdout, on_stderr, on_exit;
+  communicate_options opts;
+  boost::shared_ptr<input_state> input;
+  boost::shared_ptr<reader_state> out, err;
+  bool finished;
+
+  async_state( object const &self_ )
+    : self(self_), finished(false)
+  {}
+
+  bool deliver( value const &callback, char const *p, std::size_t n ) {
+    local_root_scope scope;
+
+    value chunk;
+    if ( opts.as_binary )
+      chunk = create<byte_string>( boost::fusion::make_vector(
+        reinterpret_cast<binary::element_type const*>(p), n ) );
+    else
+      chunk = string( p, n );
+
+    // Returning false pauses reading until Subprocess#resume()
+    try {
+      value more = self.apply( callback.get_object(), chunk );
+      return more.is_undefined() || more.to_boolean();
+    }
+    catch ( flusspferd::exception &e ) {
+      defer_or_rethrow( e );
+      return false;
+    }
   }
-  else {
-    ret.set_property("stdout", object());
+
+  bool deliver_stdout( char const *p, std::size_t n ) {
+    return deliver( on_stdout, p, n );
+  }
+
+  bool deliver_stderr( char const *p, std::size_t n ) {
+    return deliver( on_stderr, p, n );
+  }
+
+  // Handlers queued on the loop must not hold the roots of a state: the loop
+  // lives as long as the thread, which may be longer than the runtime.
+  static void check_done_weak( boost::weak_ptr<async_state> const &w ) {
+    if ( boost::shared_ptr<async_state> st = w.lock() )
+      st->check_done();
+  }
+
+  void check_done() {
+    if ( finished || (out && !out->done) || (err && !err->done) || (input && !input->done) )
+      return;
+    finished = true;
+
+    // Keep ourselves alive while the Subprocess lets go of us
+    boost::shared_ptr<async_state> keep( shared_from_this() );
+    Subprocess &p = flusspferd::get_native<Subprocess>( self );
+    p.async_.reset();
+
+    local_root_scope scope;
+    object ret = create<object>();
+    if ( out )
+      ret.set_property("stdout", on_stdout.is_object() ? value() : out->result(opts.as_binary));
+    else
+      ret.set_property("stdout", object());
+    if ( err )
+      ret.set_property("stderr", on_stderr.is_object() ? value() : err->result(opts.as_binary));
+    else
+      ret.set_property("stderr", object());
+    ret.set_property("returncode", p.wait());
+
+    if ( input && input->error )
+      ret.set_property("error", input->error_message());
+    else if ( out && out->error )
+      ret.set_property("error", out->error_message());
+    else if ( err && err->error )
+      ret.set_property("error", err->error_message());
+
+    try {
+      self.apply( on_exit.get_object(), ret );
+    }
+    catch ( flusspferd::exception &e ) {
+      defer_or_rethrow( e );
+    }
+  }
+};
+
+void Subprocess::communicate_async( call_context &x ) {
+  ba::io_service &svc = get_io_service();
+
+  if ( async_ )
+    throw exception("Subprocess#communicateAsync: already in progress");
+
+  // communicateAsync([input, ] options)
+  optional<value> input_, options_;
+  if ( x.arg.size() == 1 )
+    options_ = x.arg[0];
+  else if ( x.arg.size() >= 2 ) {
+    input_ = x.arg[0];
+    options_ = x.arg[1];
+  }
+
+  boost::shared_ptr<async_state> st( new async_state( *this ) );
+  st->opts = parse_options( options_ );
+
+  if ( options_ && options_->is_object() ) {
+    object options = options_->get_object();
+    st->on_stdout = options.get_property("onStdout");
+    st->on_stderr = options.get_property("onStderr");
+    st->on_exit = options.get_property("onExit");
+    if ( !st->on_exit.is_object() || !st->on_exit.get_object().is_function() )
+      throw exception("Subprocess#communicateAsync: onExit must be a function", "TypeError");
+  }
+  else
+    throw exception("Subprocess#communicateAsync: requires an options object with onExit");
+
+  if ( input_ && !input_->is_undefined_or_null() ) {
+    if ( stdin_ && stdin_->is_undefined() )
+      throw exception("Subprocess#communicateAsync: input provided when child's stdin is closed");
+
+    st->input.reset( new input_state );
+    st->input->on_done = boost::bind( &async_state::check_done, st.get() );
+    st->input->start( child_.get_stdin(), *input_, svc );
+  }
+
+  if ( !stdout_ || !stdout_->is_undefined() ) {
+    st->out.reset( new reader_state( child_.get_stdout(), svc, "stdout", st->opts.chunk_size ) );
+    if ( st->on_stdout.is_object() )
+      st->out->on_data = boost::bind( &async_state::deliver_stdout, st.get(), _1, _2 );
+    st->out->on_eof = boost::bind( &async_state::check_done, st.get() );
   }
 
   if ( !stderr_ || !stderr_->is_undefined() ) {
-    boost::shared_ptr<reader_state> r(new reader_state(child_.get_stderr(), svc, done_stderr, ret, "stderr"));
-    r->enqueue();
+    st->err.reset( new reader_state( child_.get_stderr(), svc, "stderr", st->opts.chunk_size ) );
+    if ( st->on_stderr.is_object() )
+      st->err->on_data = boost::bind( &async_state::deliver_stderr, st.get(), _1, _2 );
+    st->err->on_eof = boost::bind( &async_state::check_done, st.get() );
   }
-  else {
-    ret.set_property("stderr", object());
+
+  async_ = st;
+
+  if ( st->out )
+    st->out->enqueue();
+  if ( st->err )
+    st->err->enqueue();
+
+  // Nothing to wait for: finish from the loop, not from inside this call
+  if ( !st->out && !st->err && !st->input )
+    svc.post( boost::bind( &async_state::check_done_weak,
+                           boost::weak_ptr<async_state>( st ) ) );
+}
+
+void Subprocess::resume() {
+  if ( !async_ )
+    return;
+  if ( async_->out )
+    async_->out->resume();
+  if ( async_->err )
+    async_->err->resume();
+}
+
+object subprocess::run_pipeline( bp::children &cs, optional<value> input_,
+                                 bool capture_stdout, optional<value> options_ )
+{
+  ba::io_service &svc = get_io_service();
+  communicate_options opts = parse_options( options_ );
+
+  // Only the input of the first and the output of the last child pass
+  // through here, the children in between are connected directly.
+  boost::shared_ptr<input_state> input;
+  if ( input_ && !input_->is_undefined_or_null() ) {
+    input.reset( new input_state );
+    input->start( cs.front().get_stdin(), *input_, svc );
   }
 
-  while (!done_stderr || !done_stdout || !done_stderr) {
-    svc.run();
+  boost::shared_ptr<reader_state> out;
+  if ( capture_stdout ) {
+    out.reset(new reader_state(cs.back().get_stdout(), svc, "stdout", opts.chunk_size));
+    out->enqueue();
   }
-  svc.reset();
 
-  ret.set_property("returncode", wait());
+  while ( (out && !out->done) || (input && !input->done) )
+    run_one_sync( svc );
+
+  object ret = create<object>();
+  root_object root_ret(ret);
+
+  array codes = create<array>();
+  ret.set_property("returncodes", codes);
+  for ( std::size_t i = 0; i < cs.size(); ++i )
+    codes.set_element( i, status_to_value( *cs[i].wait() ) );
+  ret.set_property("returncode", codes.get_element( cs.size() - 1 ));
+
+  if ( input )
+    input->raise_error();
+  if ( out )
+    out->raise_error();
+
+  ret.set_property("stdout", out ? out->result(opts.as_binary) : value(object()));
 
   return ret;
 }
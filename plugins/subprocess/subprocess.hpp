@@ -35,6 +35,8 @@ THE SOFTWARE.
 
 #include <boost/process/child.hpp>
 #include <boost/process/context.hpp>
+#include <boost/process/status.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace subprocess {
   namespace bp = boost::process;
@@ -51,6 +53,8 @@ FLUSSPFERD_CLASS_DESCRIPTION(
     ("wait", bind, wait)
     ("poll", bind, poll)
     ("communicate", bind, communicate)
+    ("communicateAsync", bind, communicate_async)
+    ("resume", bind, resume)
   )
   (properties,
     ("pid", getter, get_pid)
@@ -72,6 +76,10 @@ FLUSSPFERD_CLASS_DESCRIPTION(
     get_stream(boost::optional<flusspferd::value>&s, T& (bp::child::* getter)() const);
 
     flusspferd::value wait_impl(bool poll);
+
+    // State of a running communicateAsync()
+    struct async_state;
+    boost::shared_ptr<async_state> async_;
   public:
     Subprocess( flusspferd::object const &o, bp::child child, bp::context ctx );
 
@@ -90,11 +98,26 @@ FLUSSPFERD_CLASS_DESCRIPTION(
     flusspferd::value wait() { return wait_impl(false); }
     flusspferd::value poll() { return wait_impl(true); }
 
-    flusspferd::object communicate( boost::optional<flusspferd::value> stdin_ );
-
-    void handle_write( boost::system::error_code const &ec, bool &done );
+    flusspferd::object communicate( boost::optional<flusspferd::value> stdin_,
+                                    boost::optional<flusspferd::value> options );
+    void communicate_async( flusspferd::call_context &x );
+    void resume();
 };
 
+// Define subprocess.loop, the event loop the children's pipes use.
+void load_event_loop( flusspferd::object &exports );
+
+// The returncode for a status: the exit status, or minus the signal number.
+flusspferd::value status_to_value( bp::status const &s );
+
+// Feed input to the first child of a pipeline launched with
+// bp::launch_pipeline, collect the output of the last one (if captured) and
+// wait for all of them.
+flusspferd::object run_pipeline( bp::children &cs,
+                                 boost::optional<flusspferd::value> input,
+                                 bool capture_stdout,
+                                 boost::optional<flusspferd::value> options );
+
 } // namespace subprocess
 
 #endif
@@ -57,6 +57,7 @@ using namespace flusspferd;
 
 namespace subprocess {
   void popen(flusspferd::call_context &x);
+  void pipeline(flusspferd::call_context &x);
 }
 
 FLUSSPFERD_LOADER_SIMPLE(exports) {
@@ -64,7 +65,12 @@ FLUSSPFERD_LOADER_SIMPLE(exports) {
     "popen", &subprocess::popen,
      param::_container = exports);
 
+  create<flusspferd::function>(
+    "pipeline", &subprocess::pipeline,
+     param::_container = exports);
+
   load_class<subprocess::Subprocess>(exports);
+  subprocess::load_event_loop(exports);
 
   exports.define_properties(read_only_property | permanent_property)
 #ifdef WIN32
@@ -140,8 +146,8 @@ namespace {
       return boost::none;
 
     value v = o.get_property(prop);
-    if ( v.is_string() )
-      throw exception( format("subprocess.popen: optional property `%s' is not a string") % prop, "TypeError");
+    if ( !v.is_string() )
+      throw exception( format("subprocess: optional property `%s' is not a string") % prop, "TypeError");
     return v.to_std_string();
   }
 
@@ -153,6 +159,56 @@ namespace {
     return v.to_boolean();
   }
 
+  // Rewrite exe/args to run args through the system shell.
+  void shell_command( optional<std::string> &exe, std::vector<std::string> &args ) {
+#if defined(BOOST_POSIX_API)
+
+    exe = "/bin/sh";
+    args.insert( args.begin(), 2, "");
+    args[0] = "sh";
+    args[1] = "-c";
+#elif defined(BOOST_WINDOWS_API)
+    char sysdir[MAX_PATH];
+    UINT size = ::GetSystemDirectoryA(sysdir, sizeof(sysdir));
+    if (!size) {
+      boost::throw_exception(
+        bs::system_error(bs::error_code(::GetLastError(), bs::get_system_category()),
+          "subprocess: GetWindowsDirectory failed"
+        )
+      );
+    }
+    BOOST_ASSERT(size < MAX_PATH);
+
+    exe = std::string(sysdir) + (sysdir[size - 1] != '\\' ? "\\cmd.exe" : "cmd.exe");
+    args.insert( args.begin(), 2, "");
+    args[0] = "cmd";
+    args[1] = "/c";
+#endif
+  }
+
+  // Set the environment of ctx from the `env' property of o, or copy the
+  // current one if there is none.
+  void environment_from_obj( object const &o, bp::context &ctx ) {
+    if (!o.has_own_property("env"))
+      ctx.environment = bp::self::get_environment();
+    else if (o.get_property("env").is_object() == false)
+      throw exception("subprocess: 'env' property must be an object","TypeError");
+    else {
+      bp::environment env;
+      object const &js_env = o.get_property("env").to_object();
+      for ( property_iterator i = js_env.begin(), end = js_env.end();
+            i != end; ++i )
+      {
+        if ( !js_env.has_own_property(*i) )
+          continue;
+        env.insert(boost::process::environment::value_type(
+          i->to_std_string(), js_env.get_property(*i).to_std_string()
+        ));
+      }
+      ctx.environment = env;
+    }
+  }
+
   // Validate the object arg passed to subprocess.popen has everything it needs.
   value popen_from_obj(object &o, bp::context &ctx) {
 
@@ -180,52 +236,55 @@ namespace {
       ctx.stderr_behavior = bp::close_stream();
 
     if ( get_bool( o, "shell") ) {
-#if defined(BOOST_POSIX_API)
+      shell_command( exe, args );
+    }
 
-      exe = "/bin/sh";
-      args.insert( args.begin(), 2, "");
-      args[0] = "sh";
-      args[1] = "-c";
-#elif defined(BOOST_WINDOWS_API)
-      char sysdir[MAX_PATH];
-      UINT size = ::GetSystemDirectoryA(sysdir, sizeof(sysdir));
-      if (!size) {
-        boost::throw_exception(
-          bs::system_error(bs::error_code(::GetLastError(), bs::get_system_category()),
-            "subprocess.popen: GetWindowsDirectory failed"
-          )
-        );
-      }
-      BOOST_ASSERT(size < MAX_PATH);
+    environment_from_obj( o, ctx );
 
-      exe = std::string(sysdir) + (sysdir[size - 1] != '\\' ? "\\cmd.exe" : "cmd.exe");
-      args.insert( args.begin(), 2, "");
-      args[0] = "cmd";
-      args[1] = "/c";
-#endif
-    }
+    bp::child c = bp::launch( exe.get(), args, ctx );
+    return create<subprocess::Subprocess>( boost::fusion::make_vector( c, ctx ) );
+  }
 
-    if (!o.has_own_property("env"))
+  // One command of subprocess.pipeline: a shell command string, an argv
+  // array or an object with args, executable, shell and env.
+  bp::pipeline_entry pipeline_entry_from_spec( value const &spec, bp::context ctx ) {
+    optional<std::string> exe;
+    std::vector<std::string> args;
+
+    if ( spec.is_string() ) {
+      args.push_back( spec.to_std_string() );
+      shell_command( exe, args );
       ctx.environment = bp::self::get_environment();
-    else if (o.get_property("env").is_object() == false)
-      throw exception("subprocess.popen: 'env' property must be an object","TypeError");
-    else {
-      bp::environment env;
-      object const &js_env = o.get_property("env").to_object();
-      for ( property_iterator i = js_env.begin(), end = js_env.end();
-            i != end; ++i )
-      {
-        if ( !js_env.has_own_property(*i) )
-          continue;
-        env.insert(boost::process::environment::value_type(
-          i->to_std_string(), js_env.get_property(*i).to_std_string()
-        ));
-      }
-      ctx.environment = env;
     }
+    else if ( spec.is_object() && spec.get_object().is_array() ) {
+      args = array_to_vector( array( spec.get_object() ) );
+      ctx.environment = bp::self::get_environment();
+    }
+    else if ( spec.is_object() ) {
+      object o = spec.get_object();
 
-    bp::child c = bp::launch( exe.get(), args, ctx );
-    return create<subprocess::Subprocess>( boost::fusion::make_vector( c, ctx ) );
+      value v = o.get_property("args");
+      if ( !v.is_object() || !v.get_object().is_array() )
+        throw exception( "subprocess.pipeline: required property `args' is not an array", "TypeError");
+      args = array_to_vector( array( v.get_object() ) );
+
+      exe = get_string( o, "executable" );
+
+      if ( get_bool( o, "shell" ) )
+        shell_command( exe, args );
+
+      environment_from_obj( o, ctx );
+    }
+    else
+      throw exception( "subprocess.pipeline: command must be a string, an array or an object", "TypeError");
+
+    if ( args.empty() )
+      throw exception( "subprocess.pipeline: empty command" );
+
+    if ( !exe )
+      exe = args.front();
+
+    return bp::pipeline_entry( exe.get(), args, ctx );
   }
 }
 
@@ -296,3 +355,65 @@ void subprocess::popen(flusspferd::call_context &x) {
 
 }
 
+void subprocess::pipeline(flusspferd::call_context &x) {
+  //  pipeline( [ cmd1, cmd2, ... ] )
+  //  pipeline( [ cmd1, cmd2, ... ], { ... } )
+
+  if ( x.arg.size() < 1 || !x.arg[0].is_object() || !x.arg[0].get_object().is_array() )
+    throw exception("subprocess.pipeline: first argument must be an array of commands", "TypeError");
+
+  array specs( x.arg[0].get_object() );
+  if ( specs.length() < 2 )
+    throw exception("subprocess.pipeline: at least two commands are required");
+
+  optional<value> options;
+  optional<value> input;
+  tribool stdout_ = indeterminate,
+          stderr_ = indeterminate;
+
+  if ( x.arg.size() >= 2 && !x.arg[1].is_undefined_or_null() ) {
+    if ( !x.arg[1].is_object() )
+      throw exception("subprocess.pipeline: options must be an object", "TypeError");
+
+    object o = x.arg[1].get_object();
+    options = x.arg[1];
+
+    if ( o.has_property("input") )
+      input = o.get_property("input");
+    stdout_ = get_bool( o, "stdout" );
+    stderr_ = get_bool( o, "stderr" );
+  }
+
+  // The last child's stdout is captured unless stdout is explicitly false.
+  bool const capture_stdout = indeterminate( stdout_ ) || bool( stdout_ );
+
+  // Only the ends of the pipeline are visible to us: the first child's stdin
+  // (if there is input) and the last one's stdout. Everything in between is
+  // connected by launch_pipeline.
+  std::vector<bp::pipeline_entry> entries;
+  std::size_t const n = specs.length();
+  for ( std::size_t i = 0; i < n; ++i ) {
+    bp::context ctx;
+
+    if ( i == 0 )
+      ctx.stdin_behavior = input && !input->is_undefined_or_null()
+                         ? bp::capture_stream() : bp::inherit_stream();
+    else
+      ctx.stdin_behavior = bp::close_stream();
+
+    if ( i == n - 1 )
+      ctx.stdout_behavior = capture_stdout
+                          ? bp::capture_stream() : bp::inherit_stream();
+    else
+      ctx.stdout_behavior = bp::close_stream();
+
+    ctx.stderr_behavior = stderr_ == false
+                        ? bp::silence_stream() : bp::inherit_stream();
+
+    entries.push_back( pipeline_entry_from_spec( specs.get_element( i ), ctx ) );
+  }
+
+  bp::children cs = bp::launch_pipeline( entries );
+
+  x.result = run_pipeline( cs, input, capture_stdout, options );
+}
@@ -0,0 +1,391 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "worker.hpp"
+
+#include "flusspferd/array.hpp"
+#include "flusspferd/binary.hpp"
+#include "flusspferd/create/array.hpp"
+#include "flusspferd/create/native_object.hpp"
+#include "flusspferd/create/object.hpp"
+#include "flusspferd/current_context_scope.hpp"
+#include "flusspferd/exception.hpp"
+#include "flusspferd/io/filesystem-base.hpp"
+#include "flusspferd/load_core.hpp"
+#include "flusspferd/property_iterator.hpp"
+#include "flusspferd/security.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/fusion/include/make_vector.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace flusspferd;
+using namespace worker;
+
+namespace fs = boost::filesystem;
+
+// Deeper values are most likely cyclic.
+static unsigned const max_depth = 128;
+
+void message::swap(message &o) {
+  std::swap(kind, o.kind);
+  std::swap(number, o.number);
+  text.swap(o.text);
+  keys.swap(o.keys);
+  items.swap(o.items);
+  bytes.swap(o.bytes);
+  std::swap(source, o.source);
+}
+
+void message::pack(value const &v, unsigned depth) {
+  if (depth > max_depth)
+    throw exception("Worker: message is cyclic or nested too deeply",
+                    "TypeError");
+
+  if (v.is_undefined()) {
+    kind = undefined_type;
+  } else if (v.is_null()) {
+    kind = null_type;
+  } else if (v.is_boolean()) {
+    kind = boolean_type;
+    number = v.get_boolean();
+  } else if (v.is_number()) {
+    kind = number_type;
+    number = v.to_number();
+  } else if (v.is_string()) {
+    kind = string_type;
+    text = v.to_std_string();
+  } else if (v.is_function()) {
+    throw exception("Worker: functions cannot be sent", "TypeError");
+  } else {
+    object o = v.get_object();
+
+    if (is_native<byte_array>(o)) {
+      kind = byte_array_type;
+      source = &get_native<byte_array>(o);
+    } else if (is_native<binary>(o)) {
+      kind = byte_string_type;
+      binary::vector_type const &data = get_native<binary>(o).get_const_data();
+      bytes.assign(data.begin(), data.end());
+    } else if (o.is_array()) {
+      kind = array_type;
+      array a(o);
+      items.resize(a.length());
+      for (std::size_t i = 0; i < items.size(); ++i)
+        items[i].pack(a.get_element(i), depth + 1);
+    } else {
+      kind = object_type;
+      for (property_iterator it = o.begin(); it != o.end(); ++it) {
+        std::string key = it->to_std_string();
+        keys.push_back(key);
+        items.push_back(message());
+        items.back().pack(o.get_property(key), depth + 1);
+      }
+    }
+  }
+
+  // Only take the buffers once the whole value could be packed.
+  if (depth == 0)
+    take_buffers();
+}
+
+void message::take_buffers() {
+  if (source) {
+    bytes.swap(source->get_data());
+    source->update_external_bytes();
+    source = 0;
+  }
+  for (std::size_t i = 0; i < items.size(); ++i)
+    items[i].take_buffers();
+}
+
+value message::unpack() {
+  switch (kind) {
+  case null_type:
+    return object();
+  case boolean_type:
+    return value(number != 0);
+  case number_type:
+    return value(number);
+  case string_type:
+    return string(text);
+  case array_type:
+    {
+      root_array a(create<array>());
+      for (std::size_t i = 0; i < items.size(); ++i)
+        a.set_element(i, items[i].unpack());
+      return a;
+    }
+  case object_type:
+    {
+      root_object o(create<object>());
+      for (std::size_t i = 0; i < items.size(); ++i)
+        o.set_property(keys[i], items[i].unpack());
+      return o;
+    }
+  case byte_string_type:
+  case byte_array_type:
+    {
+      binary::element_type *none = 0;
+      binary &b = kind == byte_array_type
+        ? static_cast<binary&>(
+            create<byte_array>(boost::fusion::make_vector(none, 0u)))
+        : static_cast<binary&>(
+            create<byte_string>(boost::fusion::make_vector(none, 0u)));
+      b.get_data().swap(bytes);
+      b.update_external_bytes();
+      return b;
+    }
+  default:
+    return value();
+  }
+}
+
+bool message_queue::push(message &m) {
+  boost::mutex::scoped_lock lock(mutex);
+  if (is_closed)
+    return false;
+  queue.push_back(message());
+  queue.back().swap(m);
+  cond.notify_one();
+  return true;
+}
+
+message_queue::pop_result
+message_queue::pop(message &m, boost::optional<int> timeout) {
+  boost::mutex::scoped_lock lock(mutex);
+
+  if (timeout) {
+    boost::system_time const deadline =
+      boost::get_system_time() + boost::posix_time::milliseconds(*timeout);
+    while (queue.empty() && !is_closed)
+      if (!cond.timed_wait(lock, deadline))
+        break;
+  } else {
+    while (queue.empty() && !is_closed)
+      cond.wait(lock);
+  }
+
+  if (!queue.empty()) {
+    m.swap(queue.front());
+    queue.pop_front();
+    return popped;
+  }
+  return is_closed ? closed : timed_out;
+}
+
+void message_queue::close() {
+  boost::mutex::scoped_lock lock(mutex);
+  is_closed = true;
+  cond.notify_all();
+}
+
+namespace {
+
+boost::thread_specific_ptr<channel_ptr> thread_channel;
+
+void send(message_queue &queue, value const &v) {
+  message m;
+  m.pack(v);
+  if (!queue.push(m))
+    throw exception("Worker: the channel is closed");
+}
+
+value receive_from(message_queue &queue, boost::optional<int> timeout) {
+  message m;
+  switch (queue.pop(m, timeout)) {
+  case message_queue::popped:
+    return m.unpack();
+  case message_queue::timed_out:
+    return value();
+  default:
+    return object();
+  }
+}
+
+// Relative ids are resolved against the current directory, since there is
+// no requiring module to resolve them against.
+std::string resolve_id(std::string const &id) {
+  if (id.compare(0, 2, "./") != 0 && id.compare(0, 3, "../") != 0)
+    return id;
+
+  fs::path path(id);
+  if (path.extension().empty())
+    path = id + ".js";
+  return "file://" + io::fs_base::canonicalize(path).string();
+}
+
+// Makes the worker's context available to Worker::~Worker while it runs.
+class running_scope : private boost::noncopyable {
+public:
+  running_scope(channel &chan, context const &co) : chan(chan) {
+    boost::mutex::scoped_lock lock(chan.context_mutex);
+    chan.running = co;
+    if (chan.stopped)
+      chan.running.interrupt();
+  }
+
+  ~running_scope() {
+    boost::mutex::scoped_lock lock(chan.context_mutex);
+    chan.running = context();
+  }
+
+private:
+  channel &chan;
+};
+
+void run_worker(
+    channel_ptr chan,
+    std::string const &id,
+    std::vector<std::string> const &paths,
+    std::string const &argv0)
+{
+  thread_channel.reset(new channel_ptr(chan));
+
+  try {
+    // A new thread gets its own runtime with the first context.
+    context co(context::create());
+    current_context_scope scope(co);
+    running_scope running(*chan, co);
+
+    try {
+      security::create(global());
+      load_core(global(), argv0);
+
+      array require_paths(
+        global().get_property_object("require").get_property_object("paths"));
+      for (std::size_t i = 0; i < paths.size(); ++i)
+        require_paths.call("push", paths[i]);
+
+      global().call("require", id);
+    } catch (std::exception &e) {
+      boost::mutex::scoped_lock lock(chan->error_mutex);
+      chan->error = std::string(e.what());
+    }
+  } catch (std::exception &e) {
+    boost::mutex::scoped_lock lock(chan->error_mutex);
+    chan->error = std::string(e.what());
+  }
+
+  chan->inbox.close();
+  chan->outbox.close();
+}
+
+}
+
+channel_ptr worker::current_channel() {
+  channel_ptr *chan = thread_channel.get();
+  return chan ? *chan : channel_ptr();
+}
+
+Worker::Worker(object const &o, call_context &x)
+  : base_type(o)
+{
+  if (x.arg.empty())
+    throw exception("Worker: no module id given", "TypeError");
+  id = resolve_id(x.arg[0].to_std_string());
+  start();
+}
+
+Worker::Worker(object const &o, std::string const &id_)
+  : base_type(o), id(resolve_id(id_))
+{
+  start();
+}
+
+// A Worker that is collected while its thread still runs stops the thread:
+// its receive() calls return null and its scripts are interrupted. The
+// collection does not wait for it, since the thread may be blocked in native
+// code; it only holds the shared channel and ends on its own.
+Worker::~Worker() {
+  if (chan) {
+    chan->inbox.close();
+
+    boost::mutex::scoped_lock lock(chan->context_mutex);
+    chan->stopped = true;
+    if (chan->running.is_valid())
+      chan->running.interrupt();
+  }
+  if (thread)
+    thread->detach();
+}
+
+void Worker::start() {
+  // The worker searches the same module paths as this thread.
+  std::vector<std::string> paths;
+  array require_paths(
+    global().get_property_object("require").get_property_object("paths"));
+  for (std::size_t i = 0; i < require_paths.length(); ++i)
+    paths.push_back(require_paths.get_element(i).to_std_string());
+
+  std::string argv0 = global().call("require", "flusspferd").to_object()
+                        .get_property("executableName").to_std_string();
+
+  chan.reset(new channel);
+  thread.reset(new boost::thread(
+    boost::bind(&run_worker, chan, id, paths, argv0)));
+}
+
+value Worker::get_error() {
+  boost::mutex::scoped_lock lock(chan->error_mutex);
+  if (!chan->error)
+    return value();
+  return string(*chan->error);
+}
+
+void Worker::post_message(value msg) {
+  send(chan->inbox, msg);
+}
+
+value Worker::receive(boost::optional<int> timeout) {
+  return receive_from(chan->outbox, timeout);
+}
+
+void Worker::close() {
+  chan->inbox.close();
+}
+
+void Worker::join() {
+  chan->inbox.close();
+  if (thread) {
+    thread->join();
+    thread.reset();
+  }
+}
+
+Port::Port(object const &o, channel_ptr chan)
+  : base_type(o), chan(chan)
+{ }
+
+void Port::post_message(value msg) {
+  send(chan->outbox, msg);
+}
+
+value Port::receive(boost::optional<int> timeout) {
+  return receive_from(chan->inbox, timeout);
+}
@@ -0,0 +1,191 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_PLUGIN_WORKER_HPP
+#define FLUSSPFERD_PLUGIN_WORKER_HPP
+
+#include "flusspferd/binary.hpp"
+#include "flusspferd/class_description.hpp"
+#include "flusspferd/context.hpp"
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace worker {
+
+// A copy of a Javascript value that does not depend on any runtime, so it
+// can be handed to another thread. The contents of ByteArrays are moved into
+// the message instead of being copied; ByteStrings are immutable and are
+// copied.
+class message {
+public:
+  enum kind_type {
+    undefined_type,
+    null_type,
+    boolean_type,
+    number_type,
+    string_type,
+    array_type,
+    object_type,
+    byte_string_type,
+    byte_array_type
+  };
+
+  message() : kind(undefined_type), number(0), source(0) {}
+
+  void swap(message &o);
+
+  // Fill the message from a value. Throws a TypeError for functions and for
+  // cyclic or too deeply nested values.
+  void pack(flusspferd::value const &v, unsigned depth = 0);
+
+  // Create a value in the current context. Binary data is moved out of the
+  // message.
+  flusspferd::value unpack();
+
+private:
+  void take_buffers();
+
+  kind_type kind;
+  double number;
+  std::string text;
+  std::vector<std::string> keys;
+  std::vector<message> items;
+  flusspferd::binary::vector_type bytes;
+  flusspferd::byte_array *source; // only set while packing
+};
+
+// A queue of messages to one thread.
+class message_queue : private boost::noncopyable {
+public:
+  message_queue() : is_closed(false) {}
+
+  enum pop_result { popped, timed_out, closed };
+
+  // Returns false if the queue has been closed.
+  bool push(message &m);
+
+  // Wait for a message, at most timeout milliseconds if given.
+  pop_result pop(message &m, boost::optional<int> timeout);
+
+  // Wake up all waiting readers. Queued messages can still be popped.
+  void close();
+
+private:
+  boost::mutex mutex;
+  boost::condition_variable cond;
+  std::deque<message> queue;
+  bool is_closed;
+};
+
+// The state shared between a Worker and the thread it runs.
+struct channel : private boost::noncopyable {
+  message_queue inbox;  // to the worker
+  message_queue outbox; // to the parent
+
+  boost::mutex error_mutex;
+  boost::optional<std::string> error;
+
+  // The worker's context while it runs its module, so the Worker can stop
+  // it. Both are guarded by context_mutex.
+  boost::mutex context_mutex;
+  flusspferd::context running;
+  bool stopped;
+
+  channel() : stopped(false) {}
+};
+
+typedef boost::shared_ptr<channel> channel_ptr;
+
+FLUSSPFERD_CLASS_DESCRIPTION(
+  Worker,
+  (constructor_name, "Worker")
+  (full_name, "worker.Worker")
+  (constructor_arity, 1)
+  (methods,
+    ("postMessage", bind, post_message)
+    ("receive", bind, receive)
+    ("close", bind, close)
+    ("join", bind, join)
+  )
+  (properties,
+    ("id", getter, get_id)
+    ("error", getter, get_error)
+  )
+) {
+public:
+  Worker(flusspferd::object const &o, flusspferd::call_context &x);
+  Worker(flusspferd::object const &o, std::string const &id);
+  ~Worker();
+
+  std::string get_id() { return id; }
+  flusspferd::value get_error();
+
+  void post_message(flusspferd::value msg);
+  flusspferd::value receive(boost::optional<int> timeout);
+  void close();
+  void join();
+
+private:
+  void start();
+
+  std::string id;
+  channel_ptr chan;
+  boost::shared_ptr<boost::thread> thread;
+};
+
+FLUSSPFERD_CLASS_DESCRIPTION(
+  Port,
+  (constructor_name, "Port")
+  (full_name, "worker.Port")
+  (constructible, false)
+  (methods,
+    ("postMessage", bind, post_message)
+    ("receive", bind, receive)
+  )
+) {
+public:
+  Port(flusspferd::object const &o, channel_ptr chan);
+
+  void post_message(flusspferd::value msg);
+  flusspferd::value receive(boost::optional<int> timeout);
+
+private:
+  channel_ptr chan;
+};
+
+// The channel to the parent if the current thread is a worker.
+channel_ptr current_channel();
+
+} // namespace worker
+
+#endif
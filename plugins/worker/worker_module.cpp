@@ -0,0 +1,72 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "flusspferd/modules.hpp"
+#include "flusspferd/class.hpp"
+#include "flusspferd/create.hpp"
+#include "flusspferd/create/array.hpp"
+#include "flusspferd/create/function.hpp"
+#include "flusspferd/create/native_object.hpp"
+
+#include "worker.hpp"
+
+#include <boost/fusion/include/make_vector.hpp>
+
+using namespace flusspferd;
+
+namespace worker {
+  array spawn(std::string const &id, boost::optional<int> count);
+}
+
+FLUSSPFERD_LOADER_SIMPLE(exports) {
+  load_class<worker::Worker>(exports);
+  load_class<worker::Port>(exports);
+
+  create<flusspferd::function>(
+    "spawn", &worker::spawn,
+    param::_container = exports);
+
+  worker::channel_ptr chan = worker::current_channel();
+  value parent;
+  if (chan)
+    parent = create<worker::Port>(boost::fusion::make_vector(chan));
+  else
+    parent = object();
+
+  exports.define_property("parent", parent,
+                          read_only_property | permanent_property);
+}
+
+array worker::spawn(std::string const &id, boost::optional<int> count) {
+  int n = count ? *count : 1;
+  if (n < 0)
+    throw exception("worker.spawn: negative worker count", "RangeError");
+
+  root_array result(create<array>());
+  for (int i = 0; i < n; ++i)
+    result.set_element(i, create<Worker>(boost::fusion::make_vector(id)));
+  return result;
+}
@@ -35,7 +35,7 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_attr_class(object &exports) {
-    load_class<attr>(exports);
+    load_class_lazy<attr>(exports);
   }
 }
 
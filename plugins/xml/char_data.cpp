@@ -35,10 +35,10 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_char_classes(object &exports) {
-    load_class<character_data>(exports);
-    load_class<text>(exports);
-    load_class<comment>(exports);
-    load_class<cdata>(exports);
+    load_class_lazy<character_data>(exports);
+    load_class_lazy<text>(exports);
+    load_class_lazy<comment>(exports);
+    load_class_lazy<cdata>(exports);
   }
 }
 
@@ -36,7 +36,7 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_doctype_class(object &exports) {
-    load_class<doctype>(exports);
+    load_class_lazy<doctype>(exports);
   }
 }
 
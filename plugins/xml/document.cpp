@@ -37,8 +37,8 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_doc_classes(object &exports) {
-    load_class<document>(exports);
-    load_class<document_fragment>(exports);
+    load_class_lazy<document>(exports);
+    load_class_lazy<document_fragment>(exports);
   }
 }
 
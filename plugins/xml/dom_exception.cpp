@@ -31,7 +31,7 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_exception_class(object &exports) {
-    load_class<dom_exception>(exports);
+    load_class_lazy<dom_exception>(exports);
   }
 }
 
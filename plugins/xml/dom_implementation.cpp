@@ -37,7 +37,7 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_domimpl_class(object &exports) {
-    load_class<dom_implementation>(exports);
+    load_class_lazy<dom_implementation>(exports);
 
     // Create the singleton domImplementation
     create<dom_implementation>(
@@ -36,7 +36,7 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_element_class(object &exports) {
-    load_class<element>(exports);
+    load_class_lazy<element>(exports);
   }
 }
 
@@ -36,7 +36,7 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_namedmap_class(object &exports) {
-    load_class<named_node_map>(exports);
+    load_class_lazy<named_node_map>(exports);
   }
 }
 
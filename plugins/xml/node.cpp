@@ -42,7 +42,7 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_node(object &exports) {
-    load_class<node>(exports);
+    load_class_lazy<node>(exports);
   }
 }
 
@@ -36,7 +36,7 @@ using namespace xml_plugin;
 
 namespace xml_plugin {
   void load_nodelist(object &exports) {
-    load_class<node_list>(exports);
+    load_class_lazy<node_list>(exports);
   }
 }
 
@@ -60,10 +60,10 @@ FLUSSPFERD_LOADER_SIMPLE(exports) {
   load_element_class(exports);
   load_namedmap_class(exports);
 
-  load_class<entity>(exports);
-  load_class<entity_ref>(exports);
-  load_class<notation>(exports);
-  load_class<processing_instruction>(exports);
+  load_class_lazy<entity>(exports);
+  load_class_lazy<entity_ref>(exports);
+  load_class_lazy<notation>(exports);
+  load_class_lazy<processing_instruction>(exports);
 
 }
 
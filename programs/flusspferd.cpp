@@ -73,6 +73,13 @@ class flusspferd_repl {
 
   std::string history_file;
 
+  std::string trace_modules_file;
+
+  std::string trace_native_calls_file;
+
+  std::string profile_file;
+  double profile_interval;
+
   int argc;
   char ** argv;
 
@@ -93,7 +100,13 @@ class flusspferd_repl {
   void print_cmakefile();
   void add_runnable(std::string const &path, Type type, bool del_interactive);
   void set_gc_zeal(std::string const &s);
+  void set_engine_option(std::string const &name, std::string const &s);
   void load_config();
+  void write_module_trace();
+  void write_native_call_trace();
+  void start_profile(std::string const &file);
+  void set_profile_interval(std::string const &s);
+  void write_profile();
 
   // Handle options from "// flusspferd: opts" lines
   void handle_file_options(const flusspferd::root_object &opts);
@@ -109,23 +122,27 @@ class flusspferd_repl {
   void run_cmdline();
   void repl_loop();
 public:
-  flusspferd_repl(int argc, char** argv);
+  flusspferd_repl(int argc, char** argv, std::size_t stack_chunk_size);
+  ~flusspferd_repl();
 
   int run();
 };
 
-flusspferd_repl::flusspferd_repl(int argc, char **argv)
+flusspferd_repl::flusspferd_repl(
+    int argc, char **argv, std::size_t stack_chunk_size)
   : interactive(true),
     interactive_set(false),
     machine_mode(false),
     //file("typein"),
     in(std::cin.rdbuf()),
     config_loaded(false),
-    co(flusspferd::context::create()),
+    co(flusspferd::context::create(
+        flusspferd::context::default_stack_limit, stack_chunk_size)),
     scope(flusspferd::current_context_scope(co)),
     running(false),
     exit_code(0),
     history_file(HISTORY_FILE_DEFAULT),
+    profile_interval(flusspferd::profiler::default_interval),
     argc(argc),
     argv(argv)
 {
@@ -160,6 +177,16 @@ flusspferd_repl::flusspferd_repl(int argc, char **argv)
   flusspferd::gc();
 }
 
+flusspferd_repl::~flusspferd_repl() {
+  try {
+    write_module_trace();
+    write_native_call_trace();
+    write_profile();
+  } catch (std::exception &e) {
+    std::cerr << "ERROR: " << e.what() << '\n';
+  }
+}
+
 int flusspferd_repl::run() {
   try {
     parse_cmdline();
@@ -360,6 +387,95 @@ void flusspferd_repl::set_gc_zeal(std::string const &s) {
   }
 }
 
+void flusspferd_repl::set_engine_option(
+  std::string const &name, std::string const &s)
+{
+  std::size_t n;
+  try {
+    n = boost::lexical_cast<std::size_t>(s);
+  }
+  catch(...) {
+    interactive_set = true;
+    interactive = false;
+    std::cerr << "ERROR: Invalid " << name << " option: " << s << std::endl;
+    throw flusspferd::js_quit();
+  }
+
+  flusspferd::init &engine = flusspferd::init::initialize();
+
+  if (name == "max-heap")
+    engine.set_max_bytes(n);
+  else if (name == "max-malloc")
+    engine.set_max_malloc_bytes(n);
+  else if (name == "gc-trigger-factor") {
+    if (!engine.set_gc_trigger_factor(n))
+      std::cerr << "Warning: Unable to set GC trigger factor" << std::endl;
+  }
+  else if (name == "stack-limit")
+    co.set_stack_limit(n);
+  // stack-chunk-size is handled before the context is created
+}
+
+void flusspferd_repl::write_module_trace() {
+  if (trace_modules_file.empty())
+    return;
+
+  std::ofstream out(trace_modules_file.c_str());
+  if (!out)
+    throw std::runtime_error("Couldn't open module trace file `" +
+                             trace_modules_file + "'");
+
+  flusspferd::module_stats::get().write_trace(out);
+}
+
+void flusspferd_repl::write_native_call_trace() {
+  if (trace_native_calls_file.empty())
+    return;
+
+  std::ofstream out(trace_native_calls_file.c_str());
+  if (!out)
+    throw std::runtime_error("Couldn't open native call trace file `" +
+                             trace_native_calls_file + "'");
+
+  flusspferd::native_call_stats::get().write(out);
+}
+
+void flusspferd_repl::start_profile(std::string const &file) {
+  profile_file = file;
+  flusspferd::profiler::get().start(profile_interval);
+}
+
+void flusspferd_repl::set_profile_interval(std::string const &s) {
+  try {
+    profile_interval = boost::lexical_cast<double>(s);
+  }
+  catch(...) {
+    profile_interval = 0;
+  }
+
+  if (profile_interval <= 0) {
+    interactive_set = true;
+    interactive = false;
+    std::cerr << "ERROR: Invalid profile-interval option: " << s << std::endl;
+    throw flusspferd::js_quit();
+  }
+}
+
+void flusspferd_repl::write_profile() {
+  if (profile_file.empty())
+    return;
+
+  flusspferd::profiler &prof = flusspferd::profiler::get();
+  prof.stop();
+
+  std::ofstream out(profile_file.c_str());
+  if (!out)
+    throw std::runtime_error("Couldn't open profile file `" +
+                             profile_file + "'");
+
+  prof.write_folded(out);
+  prof.write_summary(std::cerr);
+}
 
 void flusspferd_repl::load_config() {
   // Define the prelude property so its not a strict warning to assign to it.
@@ -559,7 +675,87 @@ flusspferd::object flusspferd_repl::option_spec(bool for_main_repl) {
     flusspferd::param::_signature = flusspferd::param::type<void (flusspferd::value, std::string)>(),
     flusspferd::param::_container = gc_zeal);
 
+  static char const * const engine_options[][2] = {
+    { "max-heap", "Set the maximum JS heap size (bytes)" },
+    { "max-malloc", "Set how many bytes may be allocated before a GC is triggered" },
+    { "gc-trigger-factor", "Set the heap growth (percent) that triggers a GC" },
+    { "stack-limit", "Set the C stack limit for scripts (bytes)" }
+  };
+
+  for (std::size_t i = 0;
+       i < sizeof(engine_options) / sizeof(engine_options[0]);
+       ++i)
+  {
+    flusspferd::object option(flusspferd::create<flusspferd::object>());
+    spec.set_property(engine_options[i][0], option);
+    option.set_property("doc", engine_options[i][1]);
+    option.set_property("argument_type", "int");
+    option.set_property("argument", "required");
+    flusspferd::create<flusspferd::function>(
+      "callback",
+      phoenix::bind(&flusspferd_repl::set_engine_option, this,
+                    std::string(engine_options[i][0]), args::arg2),
+      flusspferd::param::_signature = flusspferd::param::type<void (flusspferd::value, std::string)>(),
+      flusspferd::param::_container = option);
+  }
+
   if (for_main_repl) {
+    // Applied by stack_chunk_size_option() before getopt runs
+    flusspferd::object stack_chunk_size(flusspferd::create<flusspferd::object>());
+    spec.set_property("stack-chunk-size", stack_chunk_size);
+    stack_chunk_size.set_property("doc", "Set the interpreter stack chunk size (bytes). Must come first, as --stack-chunk-size=N");
+    stack_chunk_size.set_property("argument_type", "int");
+    stack_chunk_size.set_property("argument", "required");
+    flusspferd::create<flusspferd::function>(
+      "callback",
+      phoenix::val(0),
+      flusspferd::param::_signature = flusspferd::param::type<void ()>(),
+      flusspferd::param::_container = stack_chunk_size);
+
+    flusspferd::object trace_modules(flusspferd::create<flusspferd::object>());
+    spec.set_property("trace-modules", trace_modules);
+    trace_modules.set_property("doc", "Write module load timings to file (Chrome trace format) on exit.");
+    trace_modules.set_property("argument", "required");
+    trace_modules.set_property("argument_type", "file");
+    flusspferd::create<flusspferd::function>(
+      "callback",
+      phoenix::ref(trace_modules_file) = args::arg2,
+      flusspferd::param::_signature = flusspferd::param::type<void (flusspferd::value, std::string)>(),
+      flusspferd::param::_container = trace_modules);
+
+    flusspferd::object trace_native_calls(flusspferd::create<flusspferd::object>());
+    spec.set_property("trace-native-calls", trace_native_calls);
+    trace_native_calls.set_property("doc", "Write call counts and times of native functions to file on exit. Needs a build with ENABLE_NATIVE_CALL_STATS.");
+    trace_native_calls.set_property("argument", "required");
+    trace_native_calls.set_property("argument_type", "file");
+    flusspferd::create<flusspferd::function>(
+      "callback",
+      phoenix::ref(trace_native_calls_file) = args::arg2,
+      flusspferd::param::_signature = flusspferd::param::type<void (flusspferd::value, std::string)>(),
+      flusspferd::param::_container = trace_native_calls);
+
+    flusspferd::object profile(flusspferd::create<flusspferd::object>());
+    spec.set_property("profile", profile);
+    profile.set_property("doc", "Sample the JS stack and write it to file (collapsed stacks for flame graphs) on exit.");
+    profile.set_property("argument", "required");
+    profile.set_property("argument_type", "file");
+    flusspferd::create<flusspferd::function>(
+      "callback",
+      phoenix::bind(&flusspferd_repl::start_profile, this, args::arg2),
+      flusspferd::param::_signature = flusspferd::param::type<void (flusspferd::value, std::string)>(),
+      flusspferd::param::_container = profile);
+
+    flusspferd::object profile_interval_(flusspferd::create<flusspferd::object>());
+    spec.set_property("profile-interval", profile_interval_);
+    profile_interval_.set_property("doc", "Set the sampling interval of --profile (milliseconds). Must come before --profile");
+    profile_interval_.set_property("argument", "required");
+    profile_interval_.set_property("argument_type", "ms");
+    flusspferd::create<flusspferd::function>(
+      "callback",
+      phoenix::bind(&flusspferd_repl::set_profile_interval, this, args::arg2),
+      flusspferd::param::_signature = flusspferd::param::type<void (flusspferd::value, std::string)>(),
+      flusspferd::param::_container = profile_interval_);
+
     // Hidden Options for Generator Purpose
     flusspferd::object man_gen_(flusspferd::create<flusspferd::object>());
     spec.set_property("hidden-man", man_gen_);
@@ -683,10 +879,33 @@ bool flusspferd_repl::getline(std::string &source, char const *prompt) {
   }
 }
 
+// The chunk size of the interpreter stack has to be known when creating the
+// context, which is before the options are parsed by getopt. Look for it in
+// the leading options.
+static std::size_t stack_chunk_size_option(int argc, char **argv) {
+  std::string const prefix = "--stack-chunk-size=";
+
+  for (int i = 1; i < argc; ++i) {
+    std::string const arg = argv[i];
+    if (arg.compare(0, prefix.size(), prefix) == 0) {
+      try {
+        return boost::lexical_cast<std::size_t>(arg.substr(prefix.size()));
+      }
+      catch (boost::bad_lexical_cast &) {
+        throw std::runtime_error("Invalid stack-chunk-size option: " + arg);
+      }
+    }
+    if (arg.empty() || arg[0] != '-' || arg == "--")
+      break;
+  }
+
+  return flusspferd::context::default_stack_chunk_size;
+}
+
 int main(int argc, char **argv) {
   try {
     flusspferd::init::initialize();
-    flusspferd_repl repl(argc, argv);
+    flusspferd_repl repl(argc, argv, stack_chunk_size_option(argc, argv));
     return repl.run();
   } catch (flusspferd::js_quit&) {
   } catch (std::exception &e) {
@@ -0,0 +1,136 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "benchmark.hpp"
+#include "flusspferd/binary.hpp"
+#include "flusspferd/create.hpp"
+#include "flusspferd/create/function.hpp"
+#include "flusspferd/evaluate.hpp"
+#include "flusspferd/exception.hpp"
+#include "flusspferd/string_view.hpp"
+#include "flusspferd/spidermonkey/init.hpp"
+#include <iostream>
+
+// Overhead of the native callback trampolines: the context scope entered for
+// every call, reporting errors by throwing versus set_pending_error(), and
+// the argument conversion done by the function adapters.
+
+static int noop(int x) {
+  return x;
+}
+
+static std::size_t string_length(std::string const &s) {
+  return s.size();
+}
+
+static std::size_t view_length(flusspferd::string_view s) {
+  return s.size();
+}
+
+static double add(double a, boost::optional<int> b) {
+  return a + b.get_value_or(0);
+}
+
+static int thrower(int) {
+  throw flusspferd::exception("bench error", "TypeError");
+}
+
+static int reporter(int) {
+  flusspferd::set_pending_error("bench error", "TypeError");
+  return 0;
+}
+
+static void run_script(
+    char const *name, char const *loop, unsigned long n)
+{
+  flusspferd::global().set_property("n", (double) n);
+  benchmark_timer timer;
+  flusspferd::evaluate(loop);
+  benchmark_report(name, n, timer);
+}
+
+int main(int argc, char **argv) {
+  using namespace flusspferd;
+
+  try {
+    benchmark_context ctx;
+    unsigned long const n = benchmark_iterations(argc, argv, 200000);
+
+    JSContext *cx = Impl::current_context();
+
+    {
+      benchmark_timer timer;
+      for (unsigned long i = 0; i < n; ++i)
+        current_context_scope scope(Impl::wrap_context(cx));
+      benchmark_report("current_context_scope (before)", n, timer);
+    }
+
+    {
+      benchmark_timer timer;
+      for (unsigned long i = 0; i < n; ++i)
+        Impl::callback_context_scope scope(cx);
+      benchmark_report("callback_context_scope (after)", n, timer);
+    }
+
+    object g = global();
+    g.set_property("noop", create<function>("noop", &noop));
+    g.set_property("thrower", create<function>("thrower", &thrower));
+    g.set_property("reporter", create<function>("reporter", &reporter));
+    g.set_property("stringLength",
+      create<function>("stringLength", &string_length));
+    g.set_property("viewLength", create<function>("viewLength", &view_length));
+    g.set_property("add", create<function>("add", &add));
+    load_binary_module(g);
+
+    run_script("native call",
+      "for (var i = 0; i < n; ++i) noop(i);", n);
+
+    run_script("double, optional<int> arguments",
+      "for (var i = 0; i < n; ++i) add(i, 1);", n);
+
+    run_script("std::string argument",
+      "var s = 'some string argument';"
+      "for (var i = 0; i < n; ++i) stringLength(s);", n);
+
+    run_script("string_view argument",
+      "var s = 'some string argument';"
+      "for (var i = 0; i < n; ++i) viewLength(s);", n);
+
+    run_script("native error, thrown (before)",
+      "for (var i = 0; i < n; ++i) try { thrower(i) } catch (e) {}", n);
+
+    run_script("native error, pending (after)",
+      "for (var i = 0; i < n; ++i) try { reporter(i) } catch (e) {}", n);
+
+    run_script("ByteString#indexOf, invalid byte",
+      "var b = new ByteString([1, 2, 3]);"
+      "for (var i = 0; i < n; ++i) try { b.indexOf({}) } catch (e) {}", n);
+  } catch (std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,70 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "benchmark.hpp"
+#include "flusspferd/context_pool.hpp"
+#include "flusspferd/evaluate.hpp"
+#include <iostream>
+
+// Short script executions per second, creating a fresh context for each one
+// versus taking one from a context_pool.
+
+static char const script[] =
+  "var binary = require('binary');"
+  "var total = 0;"
+  "for (var i = 0; i < 10; ++i) total += i;"
+  "total";
+
+int main(int argc, char **argv) {
+  using namespace flusspferd;
+
+  try {
+    unsigned long const n = benchmark_iterations(argc, argv, 2000);
+
+    {
+      benchmark_timer timer;
+      for (unsigned long i = 0; i < n; ++i) {
+        benchmark_context ctx;
+        evaluate(script, "bench");
+      }
+      benchmark_report("fresh context", n, timer);
+    }
+
+    {
+      context_pool pool(4, "bench");
+      benchmark_timer timer;
+      for (unsigned long i = 0; i < n; ++i) {
+        context_pool::lease lease(pool);
+        lease.evaluate(script, "bench");
+      }
+      benchmark_report("context_pool::lease", n, timer);
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
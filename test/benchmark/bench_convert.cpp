@@ -0,0 +1,111 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "benchmark.hpp"
+#include "flusspferd/array.hpp"
+#include "flusspferd/binary.hpp"
+#include "flusspferd/convert.hpp"
+#include "flusspferd/create/native_object.hpp"
+#include "flusspferd/local_root_scope.hpp"
+#include "flusspferd/string.hpp"
+#include <boost/fusion/include/make_vector.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Conversion of large arrays between Javascript and std::vector, and of
+// Float64Buffers. The argument is the number of elements.
+
+int main(int argc, char **argv) {
+  using namespace flusspferd;
+
+  try {
+    benchmark_context ctx;
+    unsigned long const n = benchmark_iterations(argc, argv, 1000000);
+
+    std::vector<double> numbers(n);
+    for (unsigned long i = 0; i < n; ++i)
+      numbers[i] = i * 0.5;
+
+    root_value js_numbers;
+    {
+      benchmark_timer timer;
+      js_numbers = value(numbers);
+      benchmark_report("std::vector<double> -> Array", n, timer);
+    }
+
+    {
+      benchmark_timer timer;
+      convert<std::vector<double> >::from_value conv;
+      conv.perform(js_numbers);
+      benchmark_report("Array -> std::vector<double>", n, timer);
+    }
+
+    std::vector<int> ints(n);
+    for (unsigned long i = 0; i < n; ++i)
+      ints[i] = int(i);
+    root_value js_ints((value(ints)));
+
+    {
+      benchmark_timer timer;
+      convert<std::vector<int> >::from_value conv;
+      conv.perform(js_ints);
+      benchmark_report("Array -> std::vector<int>", n, timer);
+    }
+
+    std::vector<std::string> strings(n, "some string");
+
+    root_value js_strings;
+    {
+      benchmark_timer timer;
+      js_strings = value(strings);
+      benchmark_report("std::vector<std::string> -> Array", n, timer);
+    }
+
+    {
+      benchmark_timer timer;
+      convert<std::vector<std::string> >::from_value conv;
+      conv.perform(js_strings);
+      benchmark_report("Array -> std::vector<std::string>", n, timer);
+    }
+
+    load_class<float64_buffer>(global());
+
+    {
+      benchmark_timer timer;
+      local_root_scope scope;
+      float64_buffer &buf =
+        create<float64_buffer>(boost::fusion::make_vector(numbers));
+      convert<std::vector<double> >::from_value conv;
+      conv.perform(value(buf));
+      benchmark_report("Float64Buffer <-> std::vector<double>", n, timer);
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
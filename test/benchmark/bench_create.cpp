@@ -0,0 +1,96 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "benchmark.hpp"
+#include "flusspferd/binary.hpp"
+#include "flusspferd/class_description.hpp"
+#include "flusspferd/create/native_object.hpp"
+#include "flusspferd/local_root_scope.hpp"
+#include <boost/fusion/container/vector.hpp>
+#include <iostream>
+
+// Native object creation rate, dominated by the prototype lookup in
+// create<T>().
+
+FLUSSPFERD_CLASS_DESCRIPTION(
+  empty_class,
+  (full_name, "bench.Empty")
+  (constructor_name, "Empty")
+  (constructible, false)
+)
+{
+public:
+  empty_class(object const &obj) : base_type(obj) {}
+};
+
+int main(int argc, char **argv) {
+  using namespace flusspferd;
+
+  try {
+    benchmark_context ctx;
+    unsigned long const n = benchmark_iterations(argc, argv, 200000);
+
+    load_class<empty_class>(global());
+    load_binary_module(global());
+
+    {
+      benchmark_timer timer;
+      for (unsigned long i = 0; i < n; ++i) {
+        local_root_scope scope;
+        create<empty_class>();
+      }
+      benchmark_report("create<empty_class>()", n, timer);
+    }
+
+    {
+      benchmark_timer timer;
+      for (unsigned long i = 0; i < n; ++i) {
+        local_root_scope scope;
+        create<byte_string>(
+          boost::fusion::vector2<binary::element_type*, std::size_t>(0, 0));
+      }
+      benchmark_report("create<byte_string>()", n, timer);
+    }
+
+    {
+      benchmark_timer timer;
+      for (unsigned long i = 0; i < n; ++i)
+        current_context().prototype<byte_string>();
+      benchmark_report("context::prototype<byte_string>()", n, timer);
+    }
+
+    {
+      benchmark_timer timer;
+      for (unsigned long i = 0; i < n; ++i)
+        current_context().prototype("binary.ByteString");
+      benchmark_report("context::prototype(name)", n, timer);
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
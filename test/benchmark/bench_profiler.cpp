@@ -0,0 +1,88 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "benchmark.hpp"
+#include "flusspferd/evaluate.hpp"
+#include "flusspferd/profiler.hpp"
+#include <iostream>
+
+// Cost of the sampling profiler: the same script without profiling, at the
+// default interval and at a longer one. The overhead is relative to the run
+// without profiling.
+
+static char const script[] =
+  "function leaf(x) { return x * 2 + 1; }"
+  "function middle(x) {"
+  "  var s = 0;"
+  "  for (var j = 0; j < 10; ++j) s += leaf(j);"
+  "  return s + x;"
+  "}"
+  "var total = 0;"
+  "for (var i = 0; i < n; ++i) total += middle(i);"
+  "total";
+
+static double run(char const *name, double interval, unsigned long n) {
+  using namespace flusspferd;
+
+  profiler &prof = profiler::get();
+  prof.reset();
+  if (interval > 0)
+    prof.start(interval);
+
+  benchmark_timer timer;
+  evaluate(script, "bench");
+  double s = timer.seconds();
+  prof.stop();
+
+  benchmark_report(name, n, timer);
+  return s;
+}
+
+static void report_overhead(char const *name, double base, double s) {
+  std::printf("%-36s %11.1f %%\n",
+              name, base > 0 ? (s - base) / base * 100 : 0.0);
+}
+
+int main(int argc, char **argv) {
+  using namespace flusspferd;
+
+  try {
+    benchmark_context ctx;
+    unsigned long const n = benchmark_iterations(argc, argv, 2000000);
+    global().set_property("n", (double) n);
+
+    double base = run("no profiler", 0, n);
+    double def = run("default interval", profiler::default_interval, n);
+    double slow = run("10 ms interval", 10, n);
+
+    report_overhead("overhead, default interval", base, def);
+    report_overhead("overhead, 10 ms interval", base, slow);
+  } catch (std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,84 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef FLUSSPFERD_BENCHMARK_HPP
+#define FLUSSPFERD_BENCHMARK_HPP
+
+#include "flusspferd/current_context_scope.hpp"
+#include "flusspferd/load_core.hpp"
+#include "flusspferd/security.hpp"
+#include "flusspferd/init.hpp"
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <cstdio>
+#include <cstdlib>
+
+// Shared helpers for the programs in test/benchmark. Each program takes the
+// number of iterations as its only (optional) argument.
+
+class benchmark_context {
+public:
+  benchmark_context() : scope(flusspferd::context::create()) {
+    flusspferd::security::create(flusspferd::current_context().global());
+    flusspferd::load_core(flusspferd::current_context().global(), "bench");
+  }
+
+private:
+  flusspferd::current_context_scope scope;
+};
+
+class benchmark_timer {
+public:
+  benchmark_timer() : start(now()) {}
+
+  double seconds() const {
+    return (now() - start).total_microseconds() / 1e6;
+  }
+
+private:
+  static boost::posix_time::ptime now() {
+    return boost::posix_time::microsec_clock::universal_time();
+  }
+
+  boost::posix_time::ptime start;
+};
+
+inline unsigned long benchmark_iterations(
+    int argc, char **argv, unsigned long fallback)
+{
+  if (argc > 1)
+    return std::strtoul(argv[1], 0, 10);
+  return fallback;
+}
+
+inline void benchmark_report(
+    char const *name, unsigned long n, benchmark_timer const &timer)
+{
+  double s = timer.seconds();
+  std::printf("%-36s %12.0f /s  (%lu in %.3f s)\n",
+              name, s > 0 ? n / s : 0.0, n, s);
+}
+
+#endif
@@ -8,5 +8,25 @@ exports.test_decodeToString = function() {
 	asserts.same(b.decodeToString(), "AB");
 }
 
+exports.test_Float64Buffer = function() {
+  var f = new binary.Float64Buffer([1.5, -2, 3]);
+  asserts.same(f.length, 3);
+  asserts.same(f[0], 1.5);
+  asserts.same(f.get(1), -2);
+
+  f[2] = 0.25;
+  f.set(0, 10);
+  asserts.same(f.toArray(), [10, -2, 0.25]);
+
+  var copy = new binary.Float64Buffer(f.toByteArray());
+  asserts.same(copy.toArray(), [10, -2, 0.25]);
+
+  asserts.same(new binary.Float64Buffer(4).toArray(), [0, 0, 0, 0]);
+  asserts.throwsOk(function() { f.get(3) });
+  asserts.throwsOk(function() {
+    new binary.Float64Buffer(binary.ByteString([1, 2, 3]))
+  });
+}
+
 if (require.main === module)
   require('test').runner(exports);
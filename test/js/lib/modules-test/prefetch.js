@@ -0,0 +1,7 @@
+#!/usr/bin/env flusspferd
+// -*- coding: utf-8 -*-
+// flusspferd: -a -b
+//
+
+exports.id = require.id;
+exports.text = "préfetch";
@@ -0,0 +1,2 @@
+// Runs until it is stopped.
+while (true) {}
@@ -0,0 +1,10 @@
+// Sends every message back, or the square of msg.square.
+const parent = require('worker').parent;
+
+var msg;
+while ((msg = parent.receive()) !== null) {
+  if (msg && typeof msg == 'object' && 'square' in msg)
+    parent.postMessage(msg.square * msg.square);
+  else
+    parent.postMessage(msg);
+}
@@ -0,0 +1 @@
+throw new Error("worker failed");
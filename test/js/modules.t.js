@@ -67,5 +67,31 @@ exports.test_relative_dso = function() {
                "Can load " + m + " DSO by relative include");
 }
 
+exports.test_moduleStats = function() {
+  var a1 = require('./lib/modules-test/a1'),
+      stats = require('flusspferd').moduleStats(),
+      entry = stats[a1.id];
+
+  asserts.ok(entry, "stats recorded for " + a1.id);
+  asserts.same(entry.native, false, "a1 is not native");
+  asserts.ok(entry.bytesRead > 0, "bytes read recorded");
+  asserts.ok(entry.charsDecoded > 0, "decoded length recorded");
+  asserts.ok(entry.total >= entry.compile + entry.execute, "phases add up");
+  asserts.same(entry.dependencies.length, 0, "a1 has no dependencies");
+}
+
+exports.test_prefetch = function() {
+  require.prefetch(['./lib/modules-test/prefetch',
+                    './lib/modules-test/no-such-module']);
+
+  var m = require('./lib/modules-test/prefetch');
+  asserts.matches(m.id, "file://.*/prefetch.js$");
+  asserts.same(m.text, "pr\u00e9fetch", "source decoded");
+  asserts.same(require.module_cache[m.id].options.flusspferd.join(" "), "-a -b",
+               "option lines parsed");
+
+  asserts.throwsOk(function() { require.prefetch("a1") });
+}
+
 if (require.main === module)
   test.prove(module.id);
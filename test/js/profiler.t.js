@@ -0,0 +1,37 @@
+const asserts = require('test').asserts,
+      profiler = require('flusspferd').profiler;
+
+function busy(ms) {
+  var end = Date.now() + ms, n = 0;
+  while (Date.now() < end)
+    ++n;
+  return n;
+}
+
+exports.test_profiler = function() {
+  profiler.reset();
+  asserts.same(profiler.running, false, "not running");
+
+  profiler.start(1);
+  asserts.same(profiler.running, true, "running");
+  busy(100);
+  profiler.stop();
+  asserts.same(profiler.running, false, "stopped");
+
+  asserts.ok(profiler.samples > 0, "samples recorded");
+  asserts.matches(profiler.folded(), /busy \(.*profiler\.t\.js:\d+\)/,
+                  "busy() is in the folded stacks");
+
+  var top = profiler.top(1);
+  asserts.same(top.length, 1, "top function");
+  asserts.ok(top[0].self <= top[0].total, "self <= total");
+
+  profiler.reset();
+  asserts.same(profiler.samples, 0, "reset");
+  asserts.same(profiler.folded(), "", "no stacks after reset");
+
+  asserts.throwsOk(function() { profiler.start(0) });
+}
+
+if (require.main === module)
+  require('test').runner(exports);
@@ -73,6 +73,124 @@ exports.test_communicate = function() {
     asserts.same(r.stderr, null, "stderr correct");
 };
 
+exports.test_communicate_input = function() {
+    const binary = require('binary');
+    var args = [ require('flusspferd').executableName, '-e',
+                 'var sys = require("system"); sys.stdout.write(sys.stdin.readWhole()); sys.stdout.flush();',
+                 '-c', dev_null
+               ];
+
+    // Bigger than the pipe buffers and a chunk, with multibyte characters
+    // that end up split between reads
+    var data = new Array(20001).join("h\u00e9llo w\u00f6rld ");
+    var r = subprocess.popen(args).communicate(data, { chunkSize: 1000 });
+    asserts.same(r.returncode, 0, "returncode is 0");
+    asserts.same(r.stdout.length, data.length, "stdout length correct");
+    asserts.ok(r.stdout == data, "stdout decoded correctly");
+
+    var bytes = binary.ByteString([0, 1, 2, 254, 255]);
+    r = subprocess.popen(args).communicate(bytes, { binary: true });
+    asserts.instanceOf(r.stdout, binary.ByteString, "stdout is binary");
+    asserts.same(r.stdout.toArray(), [0, 1, 2, 254, 255], "binary stdout correct");
+    asserts.same(r.stderr.length, 0, "binary stderr empty");
+};
+
+exports.test_communicate_async = function() {
+    function child(n) {
+        return [ require('flusspferd').executableName, '-e',
+                 'var out = require("system").stdout; for (var i = 0; i < 1000; ++i) out.write("' + n + '"); out.flush();',
+                 '-c', dev_null ];
+    }
+
+    var results = {};
+    for (var n = 0; n < 4; ++n) {
+        (function(n) {
+            subprocess.popen(child(n), "r").communicateAsync({
+                onExit: function(r) { results[n] = r }
+            });
+        })(n);
+    }
+    asserts.same(Object.keys(results).length, 0, "nothing done before the loop runs");
+    subprocess.loop.run();
+
+    for (var n = 0; n < 4; ++n) {
+        asserts.same(results[n].returncode, 0, "child " + n + " exited");
+        asserts.same(results[n].stdout, new Array(1001).join(n), "child " + n + " output");
+    }
+
+    // Streaming with backpressure
+    var p = subprocess.popen(child(7), "r"), chunks = [], exited = false;
+    p.communicateAsync({
+        chunkSize: 100,
+        onStdout: function(chunk) { chunks.push(chunk); return false; },
+        onExit: function(r) { exited = true; asserts.same(r.stdout, undefined); }
+    });
+    while (!exited) {
+        subprocess.loop.runOne();
+        p.resume();
+    }
+    asserts.ok(chunks.length >= 10, "got the output in chunks");
+    asserts.same(chunks.join(''), new Array(1001).join(7), "streamed output");
+};
+
+exports.test_pipeline = function() {
+    function filter(code) {
+        return [ require('flusspferd').executableName, '-e',
+                 'var sys = require("system"); var s = sys.stdin.readWhole(); ' + code + ' sys.stdout.flush();',
+                 '-c', dev_null ];
+    }
+
+    var data = new Array(10001).join("abc\n");
+    var r = subprocess.pipeline([
+        filter('sys.stdout.write(s.toUpperCase());'),
+        filter('sys.stdout.write(s.replace(/B/g, "x"));'),
+        filter('sys.stdout.write(String(s.length)); sys.stdout.flush(); quit(3);')
+    ], { input: data });
+
+    asserts.same(r.stdout, String(data.length), "data went through every child");
+    asserts.same(r.returncodes, [0, 0, 3], "returncodes of all children");
+    asserts.same(r.returncode, 3, "returncode of the last child");
+
+    r = subprocess.pipeline([
+        filter('sys.stdout.write(s);'),
+        { args: filter('sys.stdout.write(String(s.length));') }
+    ], { input: require('binary').ByteString([1, 2, 3]), binary: true });
+    asserts.instanceOf(r.stdout, require('binary').ByteString, "stdout is binary");
+    asserts.same(r.stdout.decodeToString("UTF-8"), "3", "binary input passed through");
+};
+
+exports.test_communicate_errors = function() {
+    const exe = require('flusspferd').executableName;
+    var data = new Array(100001).join("unread input ");
+
+    // A child that does not read its stdin is not an error
+    var r = subprocess.popen([ exe, '-e', 'quit(2)', '-c', dev_null ]).communicate(data);
+    asserts.same(r.returncode, 2, "communicate returns despite the unread input");
+
+    var p = subprocess.popen([ exe, '-e', 'quit(3)', '-c', dev_null ]), result;
+    p.communicateAsync(data, { onExit: function(r) { result = r } });
+    subprocess.loop.run();
+    asserts.same(result.returncode, 3, "onExit called despite the unread input");
+    asserts.same(result.error, undefined, "no error reported");
+    asserts.same(p.returncode, 3, "child reaped");
+
+    // An exception from another child's callback doesn't unwind communicate
+    var q = subprocess.popen([ exe, '-e', 'var o = require("system").stdout; o.write("x"); o.flush()',
+                                 '-c', dev_null ], "r"),
+        exited = false;
+    q.communicateAsync({
+        onStdout: function() { throw new Error("from callback") },
+        onExit: function() { exited = true }
+    });
+    r = subprocess.popen([ exe, '-e', 'var s = require("system"); s.stdin.readWhole(); s.stdout.write("ok"); s.stdout.flush()',
+                           '-c', dev_null ]).communicate(data);
+    asserts.same(r.stdout, "ok", "unrelated communicate finished");
+    asserts.throwsOk(function() { subprocess.loop.run() }, "deferred to the loop");
+    q.resume();
+    subprocess.loop.run();
+    asserts.ok(exited, "callback's child finished");
+};
+
 exports.test_retcode = function() {
     const retval = 12;
     const args = [ require('flusspferd').executableName, '-e',
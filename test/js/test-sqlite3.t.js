@@ -151,6 +151,325 @@ exports.test_sqlite3_placeholder_query_row_object = function() {
     asserts.same(index, data.length);
 }
 
+exports.test_sqlite3_statement_cache = function() {
+    var db = sqlite3.SQLite3(':memory:', { statementCacheSize: 2 });
+    asserts.same(db.statementCacheSize, 2);
+    db.exec('CREATE TABLE cache_test(a)');
+
+    var many = [];
+    for (var i = 0; i < 10; ++i)
+        many.push({ sql: 'INSERT INTO cache_test VALUES(?)', bind: [i] });
+    asserts.same(db.execMany(many), 10);
+
+    var stats = db.statementCacheStats();
+    asserts.same(stats.misses, 2);
+    asserts.same(stats.hits, 9);
+    asserts.same(stats.size, 2);
+
+    var cur = db.query('SELECT count(*) FROM cache_test');
+    asserts.same(cur.next(), [10]);
+    cur.close();
+    asserts.same(db.statementCacheStats().evictions, 1);
+    cur = db.query('SELECT count(*) FROM cache_test');
+    asserts.same(cur.next(), [10]);
+    asserts.same(db.statementCacheStats().hits, 10);
+    cur.close();
+
+    db.exec('SELECT 1');
+    asserts.same(db.statementCacheStats().evictions, 2);
+
+    db.statementCacheSize = 0;
+    asserts.same(db.statementCacheStats().size, 0);
+    asserts.throwsOk(function() { db.statementCacheSize = -1; });
+    db.close();
+
+    asserts.throwsOk(function() {
+        sqlite3.SQLite3(':memory:', { statementCacheSize: -1 });
+    });
+}
+
+exports.test_sqlite3_execute_batch = function() {
+    var db = sqlite_test_helper.get_db();
+    var rows = [];
+    for (var i = 0; i < 25; ++i)
+        rows.push([i, 'row ' + i, sqlite3_testblob]);
+
+    var sql = 'INSERT INTO test_table VALUES(?, ?, ?)';
+    asserts.same(db.executeBatch(sql, rows, { chunkSize: 10 }), 25);
+    asserts.same(db.query('SELECT count(*), sum(int_val) FROM test_table').next(),
+                 [25, 300]);
+
+    // A failing row rolls back its chunk only
+    db.exec('CREATE TABLE batch_unique(a UNIQUE)');
+    asserts.throwsOk(function() {
+        db.executeBatch('INSERT INTO batch_unique VALUES(?)',
+                        [[1], [2], [3], [3]], { chunkSize: 2 });
+    });
+    asserts.same(db.query('SELECT count(*) FROM batch_unique').next(), [2]);
+
+    asserts.throwsOk(function() {
+        db.executeBatch(sql, [[1, 'too short']]);
+    });
+
+    // A later value in the row that changes an earlier blob while being
+    // stringified must not leave the statement pointing at freed data
+    const binary = require('binary');
+    var bytes = binary.ByteArray("0123456789");
+    var evil = { toString: function() { bytes.length = 100000; return 'evil'; } };
+    db.executeBatch('INSERT INTO test_table(bin_val, str_val, int_val) VALUES(?, ?, 100)',
+                    [[bytes, evil]]);
+    var blob = db.query('SELECT bin_val, str_val FROM test_table WHERE int_val = 100').next();
+    asserts.same(blob[0].length, 100000);
+    asserts.same(blob[1], 'evil');
+    db.close();
+}
+
+exports.test_sqlite3_fetch_many = function() {
+    var db = sqlite_test_helper.get_db();
+    var rows = [];
+    for (var i = 0; i < 250; ++i)
+        rows.push([i, 'row ' + i, sqlite3_testblob]);
+    db.executeBatch('INSERT INTO test_table VALUES(?, ?, ?)', rows);
+
+    var cur = db.query('SELECT int_val, str_val FROM test_table ORDER BY int_val');
+    var first = cur.fetchMany(10);
+    asserts.same(first.length, 10);
+    asserts.same(first[3], [3, 'row 3']);
+
+    var objs = cur.fetchMany(5, true);
+    asserts.same(objs.length, 5);
+    asserts.same(objs[0], { int_val: 10, str_val: 'row 10' });
+    asserts.same(objs[4], { int_val: 14, str_val: 'row 14' });
+
+    var rest = cur.fetchAll();
+    asserts.same(rest.length, 235);
+    asserts.same(rest[234], [249, 'row 249']);
+    asserts.same(cur.fetchMany(10), []);
+    asserts.throwsOk(function() { cur.fetchMany(0) });
+    cur.close();
+
+    var count = 0;
+    for (var row in db.query('SELECT int_val FROM test_table'))
+        ++count;
+    asserts.same(count, 250);
+
+    // Leaving the loop doesn't skip rows for next()
+    cur = db.query('SELECT int_val FROM test_table ORDER BY int_val');
+    for (var row in cur)
+        if (row[0] == 4)
+            break;
+    asserts.same(cur.next(), [5]);
+    cur.close();
+    db.close();
+}
+
+exports.test_sqlite3_fetch_columns = function() {
+    const binary = require('binary');
+    var db = sqlite_test_helper.get_db();
+    db.executeBatch('INSERT INTO test_table VALUES(?, ?, ?)',
+                    [[1.5, 'a', sqlite3_testblob],
+                     [null, 'bc', null],
+                     [3, null, sqlite3_testblob]]);
+
+    var cur = db.query('SELECT int_val, str_val, bin_val FROM test_table');
+    var cols = cur.fetchColumns({ limit: 10 });
+    cur.close();
+    asserts.same(cols.length, 3);
+
+    asserts.same(cols[0].name, 'int_val');
+    asserts.same(cols[0].type, 'number');
+    asserts.same(cols[0].length, 3);
+    asserts.instanceOf(cols[0].data, binary.Float64Buffer);
+    asserts.same(cols[0].data[0], 1.5);
+    asserts.ok(isNaN(cols[0].data[1]));
+    asserts.same(cols[0].data[2], 3);
+
+    asserts.same(cols[1].type, 'text');
+    asserts.same(cols[1].data.decodeToString('utf-8'), 'abc');
+    asserts.same(cols[1].offsets.toArray(), [0, 1, 3, 3]);
+
+    asserts.same(cols[2].type, 'blob');
+    asserts.same(cols[2].data.length, 20);
+    asserts.same(cols[2].offsets.toArray(), [0, 10, 10, 20]);
+
+    cur = db.query('SELECT int_val FROM test_table');
+    asserts.same(cur.fetchColumns({ limit: 2 })[0].length, 2);
+    asserts.same(cur.fetchColumns()[0].length, 1);
+    cur.close();
+    db.close();
+}
+
+exports.test_sqlite3_blob = function() {
+    const binary = require('binary');
+    var db = sqlite_test_helper.get_db();
+    db.exec('INSERT INTO test_table VALUES(1, ?, ?)', ['blob', sqlite3_testblob]);
+    var rowid = db.lastInsertID();
+
+    var blob = db.openBlob('test_table', 'bin_val', rowid);
+    asserts.same(blob.length, 10);
+    asserts.same(blob.readBinary(4).toArray(), [48, 49, 50, 51]);
+    asserts.same(blob.tell(), 4);
+    blob.seek(8);
+    asserts.same(blob.readWholeBinary().toArray(), [56, 57]);
+    asserts.throwsOk(function() { blob.seek(11) });
+    blob.close();
+    asserts.throwsOk(function() { blob.tell() });
+
+    blob = db.openBlob('test_table', 'bin_val', rowid, { write: true });
+    blob.seek(2);
+    blob.write(binary.ByteString("ab"));
+    blob.close();
+    asserts.same(db.query('SELECT bin_val FROM test_table').next()[0].toArray(),
+                 binary.ByteString("01ab456789").toArray());
+
+    asserts.throwsOk(function() {
+        db.openBlob('test_table', 'bin_val', rowid + 1);
+    });
+    db.close();
+}
+
+exports.test_sqlite3_stats = function() {
+    var db = sqlite_test_helper.get_db();
+    asserts.same(db.profiling, false);
+    db.profiling = true;
+
+    var rows = [];
+    for (var i = 0; i < 50; ++i)
+        rows.push([i, 'row ' + i, null]);
+    db.executeBatch('INSERT INTO test_table VALUES(?, ?, ?)', rows);
+
+    var sql = 'SELECT str_val FROM test_table WHERE int_val > 10 ORDER BY str_val';
+    var cur = db.query(sql);
+    asserts.same(cur.fetchAll().length, 39);
+    cur.close();
+
+    var stats = db.stats();
+    var insert, select;
+    stats.forEach(function(s) {
+        if (s.sql == sql) select = s;
+        else if (/^INSERT/.test(s.sql)) insert = s;
+    });
+    asserts.same(insert.count, 50);
+    asserts.same(select.count, 1);
+    asserts.same(select.rows, 39);
+    asserts.ok(select.fullScanSteps > 0);
+    asserts.ok(select.sorts > 0);
+    asserts.ok(select.maxTime >= 0 && select.totalTime >= select.maxTime);
+
+    // A cross join of three copies of a table of 100 rows is slow enough
+    var digits = [];
+    for (var i = 0; i < 100; ++i)
+        digits.push([i]);
+    function create_digits(handle) {
+        handle.exec('CREATE TABLE digits(d INTEGER)');
+        handle.executeBatch('INSERT INTO digits VALUES(?)', digits);
+    }
+    create_digits(db);
+
+    var slow = [];
+    asserts.throwsOk(function() { db.slowQueryThreshold = -1 });
+    db.slowQueryThreshold = 1;
+    db.onSlowQuery = function(sql, ms) { slow.push(sql) };
+    var slow_sql = 'SELECT count(*) FROM digits a, digits b, digits c';
+    asserts.same(db.query(slow_sql).next(), [1000000]);
+    asserts.same(slow, [slow_sql]);
+
+    // The handle can't be closed while a batch runs; slow queries of the
+    // batch are reported once it is done, so the callback may close it
+    asserts.throwsOk(function() {
+        db.executeBatch('SELECT ?', [[{ toString: function() { db.close(); return 'x' } }]]);
+    });
+    var batch_sql = 'SELECT count(*) FROM digits a, digits b, digits c' +
+                    ' WHERE a.d < ?';
+    var batch_db = sqlite_test_helper.get_db(), reported = 0;
+    create_digits(batch_db);
+    batch_db.profiling = true;
+    batch_db.slowQueryThreshold = 1;
+    batch_db.onSlowQuery = function() { ++reported; batch_db.close() };
+    batch_db.executeBatch(batch_sql, [[100], [100]]);
+    asserts.same(reported, 2);
+    asserts.throwsOk(function() { batch_db.exec('SELECT 1') });
+
+    db.resetStats();
+    asserts.same(db.stats(), []);
+    db.profiling = false;
+    db.exec('SELECT 2');
+    asserts.same(db.stats(), []);
+    db.close();
+}
+
+exports.test_sqlite3_query_async = function() {
+    const fs = require('filesystem-base');
+    var file = 'test-sqlite3-async.db';
+    if (fs.exists(file))
+        fs.remove(file);
+
+    var db = sqlite3.SQLite3(file);
+    db.exec('CREATE TABLE numbers(n INTEGER, s TEXT)');
+    var rows = [];
+    for (var i = 0; i < 250; ++i)
+        rows.push([i, 'n' + i]);
+    db.executeBatch('INSERT INTO numbers VALUES(?, ?)', rows);
+
+    var got = [], batches = 0, finished = false;
+    db.queryAsync('SELECT n, s FROM numbers WHERE n >= ? ORDER BY n', [50],
+                  function(err, rows, done) {
+        asserts.same(err, null);
+        ++batches;
+        got = got.concat(rows);
+        finished = done;
+    }, { batchSize: 100 });
+
+    var failed;
+    db.queryAsync('SELECT * FROM no_such_table', function(err, rows, done) {
+        failed = err;
+        asserts.same(rows, null);
+        asserts.same(done, true);
+    });
+
+    asserts.same(db.pendingQueries, 2);
+    while (db.pendingQueries)
+        db.poll(1000);
+
+    asserts.ok(finished);
+    asserts.same(batches, 2);
+    asserts.same(got.length, 200);
+    asserts.same(got[0], [50, 'n50']);
+    asserts.same(got[199], [249, 'n249']);
+    asserts.matches(failed, /no such table/);
+    asserts.same(db.poll(0), 0);
+
+    // Results are not buffered without limit: the thread waits for poll(),
+    // and closing the handle still cancels it
+    var count = 0;
+    db.queryAsync('SELECT n FROM numbers', function(err, rows) {
+        count += rows.length;
+    }, { batchSize: 1 });
+    db.poll();
+    asserts.ok(count >= 1);
+    db.close();
+    asserts.same(db.pendingQueries, 0);
+
+    // Collecting a handle does not wait for a query blocked on a lock
+    db = sqlite3.SQLite3(file);
+    db.exec('BEGIN EXCLUSIVE');
+    var other = sqlite3.SQLite3(file);
+    other.queryAsync('SELECT n FROM numbers', function() {});
+    other = null;
+    var start = Date.now();
+    gc();
+    asserts.ok(Date.now() - start < 2500, "gc() did not wait for the lock");
+    db.exec('COMMIT');
+    db.close();
+    fs.remove(file);
+
+    var mem = sqlite3.SQLite3(':memory:');
+    asserts.throwsOk(function() {
+        mem.queryAsync('SELECT 1', function() {});
+    });
+    mem.close();
+}
+
 }
 catch(e) {
   // this sucks we really should change the exception system (#44)
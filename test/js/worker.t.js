@@ -0,0 +1,86 @@
+try {
+
+const worker = require('worker'),
+      asserts = require('test').asserts,
+      binary = require('binary');
+
+const lib = module.id.replace(/[^\/]*$/, 'lib/worker-test/');
+
+exports.test_roundtrip = function() {
+  var w = new worker.Worker(lib + 'echo.js');
+  var msg = { a: 1, b: [1, "x", null, true], c: { d: "é" } };
+
+  w.postMessage(msg);
+  asserts.same(w.receive(), msg, "message survives the round trip");
+
+  w.postMessage("foo");
+  asserts.same(w.receive(), "foo", "strings are sent");
+
+  asserts.same(w.receive(10), undefined, "receive times out");
+
+  w.join();
+  asserts.same(w.receive(), null, "receive returns null once closed");
+  asserts.same(w.error, undefined, "no error");
+};
+
+exports.test_binary_transfer = function() {
+  var w = new worker.Worker(lib + 'echo.js');
+  var ba = new binary.ByteArray([1, 2, 3]);
+
+  w.postMessage({ data: ba });
+  asserts.same(ba.length, 0, "buffer was moved out of the sender");
+
+  var got = w.receive().data;
+  asserts.instanceOf(got, binary.ByteArray, "got a ByteArray back");
+  asserts.same(got.toArray(), [1, 2, 3], "contents arrived");
+
+  var bs = binary.ByteString([4, 5]);
+  w.postMessage(bs);
+  asserts.same(bs.toArray(), [4, 5], "ByteString is copied, not moved");
+  got = w.receive();
+  asserts.instanceOf(got, binary.ByteString, "got a ByteString back");
+  asserts.same(got.toArray(), [4, 5], "ByteString contents arrived");
+  w.join();
+};
+
+exports.test_collect_running = function() {
+  (function() { new worker.Worker(lib + 'busy.js') })();
+  gc();
+  gc();
+  asserts.ok(true, "collecting a running worker does not wait for its thread");
+};
+
+exports.test_spawn = function() {
+  var workers = worker.spawn(lib + 'echo.js', 4);
+  asserts.same(workers.length, 4, "spawned four workers");
+
+  for (var i = 0; i < workers.length; ++i)
+    workers[i].postMessage({ square: i + 1 });
+  for (var i = 0; i < workers.length; ++i)
+    asserts.same(workers[i].receive(), (i + 1) * (i + 1), "worker " + i);
+
+  workers.forEach(function(w) { w.join(); });
+};
+
+exports.test_errors = function() {
+  var w = new worker.Worker(lib + 'throws.js');
+  w.join();
+  asserts.same(w.receive(), null, "nothing received from failed worker");
+  asserts.ok(/worker failed/.test(w.error), "error is reported");
+
+  asserts.throwsOk(function() {
+    w.postMessage(function() {});
+  }, "functions cannot be sent");
+
+  asserts.same(worker.parent, null, "main thread has no parent");
+};
+
+}
+catch(e if e.message && e.message.match(/'worker'/)) {
+  exports.test_skip = function() {
+    require('test').asserts.diag("Not running worker test (Module not built)");
+  };
+}
+
+if (require.main === module)
+  require('test').runner(exports);
@@ -25,11 +25,17 @@ THE SOFTWARE.
 */
 
 #include "flusspferd/array.hpp"
+#include "flusspferd/binary.hpp"
+#include "flusspferd/convert.hpp"
 #include "flusspferd/create/array.hpp"
+#include "flusspferd/create/native_object.hpp"
+#include "flusspferd/evaluate.hpp"
+#include "flusspferd/string.hpp"
 #include "flusspferd/value.hpp"
 #include "flusspferd/value_io.hpp"
 #include "test_environment.hpp"
 #include <boost/assign/list_of.hpp>
+#include <boost/fusion/include/make_vector.hpp>
 
 #include <iostream>//FIXME
 
@@ -110,4 +116,93 @@ BOOST_AUTO_TEST_CASE( array_iterator ) {
   }
 }
 
+BOOST_AUTO_TEST_CASE( bulk_conversion ) {
+  std::vector<double> numbers;
+  for (int i = 0; i < 1000; ++i)
+    numbers.push_back(i * 0.5);
+
+  flusspferd::root_value v((flusspferd::value(numbers)));
+  flusspferd::array a(v.get_object());
+  BOOST_REQUIRE_EQUAL(a.length(), 1000u);
+  BOOST_CHECK_EQUAL(a.get_element(3).to_number(), 1.5);
+
+  flusspferd::convert<std::vector<double> >::from_value to_doubles;
+  BOOST_CHECK(to_doubles.perform(v) == numbers);
+
+  flusspferd::convert<std::vector<int> >::from_value to_ints;
+  std::vector<int> ints = to_ints.perform(flusspferd::evaluate("[1, '2', 3]"));
+  BOOST_REQUIRE_EQUAL(ints.size(), 3u);
+  BOOST_CHECK_EQUAL(ints[1], 2);
+  BOOST_CHECK_THROW(
+    to_ints.perform(flusspferd::evaluate("[1e20]")),
+    flusspferd::exception);
+  BOOST_CHECK_THROW(
+    to_ints.perform(flusspferd::value(3)),
+    flusspferd::exception);
+
+  std::vector<std::string> strings =
+    boost::assign::list_of("a")("b c")("");
+  flusspferd::root_value s((flusspferd::value(strings)));
+  BOOST_CHECK_EQUAL(s.to_std_string(), "a,b c,");
+
+  flusspferd::convert<std::vector<std::string> >::from_value to_strings;
+  BOOST_CHECK(to_strings.perform(flusspferd::evaluate("['x', 1, null]")) ==
+    boost::assign::list_of("x")("1")("null").convert_to_container<
+      std::vector<std::string> >());
+}
+
+BOOST_AUTO_TEST_CASE( float64_buffer ) {
+  flusspferd::load_class<flusspferd::float64_buffer>(flusspferd::global());
+
+  std::vector<double> numbers = boost::assign::list_of(0.5)(-1)(2);
+  flusspferd::float64_buffer &buf =
+    flusspferd::create<flusspferd::float64_buffer>(
+      boost::fusion::make_vector(numbers));
+  BOOST_CHECK(buf.get_data() == numbers);
+
+  flusspferd::convert<std::vector<double> >::from_value to_doubles;
+  BOOST_CHECK(to_doubles.perform(flusspferd::value(buf)) == numbers);
+}
+
+BOOST_AUTO_TEST_CASE( binary_external_bytes ) {
+  flusspferd::load_class<flusspferd::binary>(flusspferd::global());
+  flusspferd::load_class<flusspferd::byte_array>(flusspferd::global());
+  flusspferd::load_class<flusspferd::float64_buffer>(flusspferd::global());
+
+  flusspferd::gc();
+  std::size_t const before =
+    flusspferd::current_context().gc_stats().external_bytes;
+
+  {
+    std::vector<double> numbers(1000);
+    flusspferd::root_object buf(
+      flusspferd::create<flusspferd::float64_buffer>(
+        boost::fusion::make_vector(numbers)));
+
+    flusspferd::binary::element_type *none = 0;
+    flusspferd::byte_array &bytes =
+      flusspferd::create<flusspferd::byte_array>(
+        boost::fusion::make_vector(none, std::size_t(0)));
+    flusspferd::root_object root(bytes);
+    bytes.set_length(100000);
+
+    BOOST_CHECK_GE(
+      flusspferd::current_context().gc_stats().external_bytes,
+      before + 100000 + 1000 * sizeof(double));
+
+    bytes.set_length(0);
+    flusspferd::binary::vector_type().swap(bytes.get_data());
+    bytes.update_external_bytes();
+    BOOST_CHECK_LT(
+      flusspferd::current_context().gc_stats().external_bytes,
+      before + 100000);
+  }
+
+  // The engine may keep the newest object alive for one more collection
+  flusspferd::gc();
+  BOOST_CHECK_LE(
+    flusspferd::current_context().gc_stats().external_bytes,
+    before + 1000 * sizeof(double));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -120,4 +120,45 @@ BOOST_AUTO_TEST_CASE(prop_var2)
   BOOST_CHECK_EQUAL(obj.get_property("prop_var2"), flusspferd::value(8));
 }
 
+BOOST_AUTO_TEST_CASE(lazy_create)
+{
+  flusspferd::load_class_lazy<my_class>(flusspferd::global());
+  BOOST_CHECK(flusspferd::global().has_own_property("MyClass"));
+
+  flusspferd::root_object obj(flusspferd::create<my_class>());
+  BOOST_CHECK(!obj.is_null());
+  BOOST_CHECK(obj.has_property("methods_function"));
+  BOOST_CHECK(!flusspferd::current_context().constructor<my_class>().is_null());
+}
+
+BOOST_AUTO_TEST_CASE(lazy_constructor)
+{
+  flusspferd::load_class_lazy<my_class>(flusspferd::global());
+
+  flusspferd::root_value ctor(flusspferd::global().get_property("MyClass"));
+  BOOST_REQUIRE(ctor.is_object());
+  BOOST_CHECK_EQUAL(
+    ctor, flusspferd::value(flusspferd::current_context().constructor<my_class>()));
+  BOOST_CHECK_EQUAL(
+    flusspferd::global().get_property("MyClass"), ctor);
+}
+
+BOOST_AUTO_TEST_CASE(registry_index)
+{
+  flusspferd::load_class<my_class>(flusspferd::global());
+  flusspferd::context &ctx = flusspferd::current_context();
+
+  BOOST_CHECK_EQUAL(
+    flusspferd::detail::class_index<my_class>(),
+    flusspferd::detail::class_index("MyClass"));
+  BOOST_CHECK(ctx.prototype("MyClass") == ctx.prototype<my_class>());
+  BOOST_CHECK(ctx.constructor("MyClass") == ctx.constructor<my_class>());
+
+  // The registry keeps the prototype alive without any other reference.
+  flusspferd::global().delete_property("MyClass");
+  flusspferd::gc();
+  flusspferd::root_object obj(flusspferd::create<my_class>());
+  BOOST_CHECK(obj.has_property("methods_function"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
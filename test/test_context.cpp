@@ -25,11 +25,17 @@ THE SOFTWARE.
 */
 
 #include "flusspferd/context.hpp"
+#include "flusspferd/context_pool.hpp"
 #include "flusspferd/object.hpp"
+#include "flusspferd/init.hpp"
 #include "flusspferd/evaluate.hpp"
 #include "flusspferd/current_context_scope.hpp"
+#include "flusspferd/time_limit_scope.hpp"
+#include "flusspferd/create/function.hpp"
 #include "flusspferd/spidermonkey/context.hpp"
 #include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
 
 BOOST_TEST_DONT_PRINT_LOG_VALUE(flusspferd::context)
 
@@ -106,6 +112,24 @@ BOOST_AUTO_TEST_CASE( equality ) {
   BOOST_CHECK_NE(context2, copy_context3);
 }
 
+BOOST_AUTO_TEST_CASE( stack_settings ) {
+  flusspferd::context context(flusspferd::context::create());
+  BOOST_REQUIRE(context.is_valid());
+  BOOST_CHECK_EQUAL(
+    context.get_stack_limit(), flusspferd::context::default_stack_limit);
+  BOOST_CHECK_EQUAL(
+    context.get_stack_chunk_size(),
+    flusspferd::context::default_stack_chunk_size);
+
+  flusspferd::context custom(flusspferd::context::create(100000, 16384));
+  BOOST_REQUIRE(custom.is_valid());
+  BOOST_CHECK_EQUAL(custom.get_stack_limit(), std::size_t(100000));
+  BOOST_CHECK_EQUAL(custom.get_stack_chunk_size(), std::size_t(16384));
+
+  custom.set_stack_limit(200000);
+  BOOST_CHECK_EQUAL(custom.get_stack_limit(), std::size_t(200000));
+}
+
 BOOST_AUTO_TEST_CASE( gc ) {
   flusspferd::context context(flusspferd::context::create());
   BOOST_REQUIRE(context.is_valid());
@@ -113,6 +137,25 @@ BOOST_AUTO_TEST_CASE( gc ) {
   BOOST_REQUIRE(context.is_valid());
 }
 
+BOOST_AUTO_TEST_CASE( gc_stats ) {
+  flusspferd::context context(flusspferd::context::create());
+  BOOST_REQUIRE(context.is_valid());
+
+  flusspferd::gc_statistics before = context.gc_stats();
+  context.gc();
+  flusspferd::gc_statistics after = context.gc_stats();
+
+  BOOST_CHECK_EQUAL(after.collections, before.collections + 1);
+  BOOST_CHECK_GE(after.total_pause, before.total_pause);
+  BOOST_CHECK_GE(after.max_pause, after.last_pause);
+
+  flusspferd::init::initialize().add_external_bytes(1024);
+  BOOST_CHECK_EQUAL(
+    context.gc_stats().external_bytes, after.external_bytes + 1024);
+  flusspferd::init::initialize().add_external_bytes(-1024);
+  BOOST_CHECK_EQUAL(context.gc_stats().external_bytes, after.external_bytes);
+}
+
 BOOST_AUTO_TEST_CASE( global ) {
   flusspferd::context context(flusspferd::context::create());
   BOOST_REQUIRE(context.is_valid());
@@ -139,6 +182,98 @@ BOOST_AUTO_TEST_CASE( evaluate ) {
     , flusspferd::exception);
 }
 
+namespace {
+  void call_back(flusspferd::object fn) {
+    fn.call(flusspferd::global());
+  }
+
+  void interrupt_later(flusspferd::context context) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    context.interrupt();
+  }
+}
+
+BOOST_AUTO_TEST_CASE( time_limit ) {
+  flusspferd::context context(flusspferd::context::create());
+  flusspferd::current_context_scope scope(context);
+
+  {
+    flusspferd::time_limit_scope limit(50);
+    BOOST_CHECK_THROW(
+      flusspferd::evaluate("while (true) {}", __FILE__, __LINE__),
+      flusspferd::exception);
+  }
+  BOOST_CHECK_EQUAL(
+    flusspferd::evaluate("1 + 1", __FILE__, __LINE__).to_number(), 2.0);
+
+  {
+    flusspferd::time_limit_scope limit(0, 50);
+    BOOST_CHECK_THROW(
+      flusspferd::evaluate(
+        "try { while (true) {} } catch (e) {} 1", __FILE__, __LINE__),
+      flusspferd::exception);
+  }
+
+  boost::thread interrupter(
+    boost::bind(&flusspferd::context::interrupt, context));
+  interrupter.join();
+  BOOST_CHECK_THROW(
+    flusspferd::evaluate("while (true) {}", __FILE__, __LINE__),
+    flusspferd::exception);
+  context.clear_time_limit();
+  BOOST_CHECK_EQUAL(
+    flusspferd::evaluate("1 + 1", __FILE__, __LINE__).to_number(), 2.0);
+
+  // Stopping a script called from a native function makes that function
+  // throw a catchable exception; the interrupt has to stop the caller too.
+  flusspferd::create<flusspferd::function>(
+    "callBack", &call_back, flusspferd::param::_container = context.global());
+  boost::thread late_interrupter(boost::bind(&interrupt_later, context));
+  BOOST_CHECK_THROW(
+    flusspferd::evaluate(
+      "while (true) { try { callBack(function() { while (true) {} }) }"
+      " catch (e) {} }", __FILE__, __LINE__),
+    flusspferd::exception);
+  late_interrupter.join();
+  context.clear_time_limit();
+  BOOST_CHECK_EQUAL(
+    flusspferd::evaluate("1 + 1", __FILE__, __LINE__).to_number(), 2.0);
+}
+
+BOOST_AUTO_TEST_CASE( context_pool ) {
+  flusspferd::context_pool pool(1, "exeName");
+  BOOST_CHECK_EQUAL(pool.size(), 1u);
+  BOOST_CHECK_EQUAL(pool.available(), 1u);
+
+  flusspferd::context first;
+  {
+    flusspferd::context_pool::lease lease(pool);
+    first = lease.get_context();
+    BOOST_CHECK_EQUAL(flusspferd::current_context(), first);
+    BOOST_CHECK_EQUAL(pool.available(), 0u);
+
+    BOOST_CHECK_EQUAL(
+      lease.evaluate("var x = 1; y = 2; x + y").to_number(), 3.0);
+    lease.evaluate("require('binary').ByteString.poolTest = 42");
+
+    {
+      flusspferd::context_pool::lease second(pool);
+      BOOST_CHECK_NE(second.get_context(), first);
+      BOOST_CHECK_EQUAL(pool.size(), 2u);
+    }
+  }
+  BOOST_CHECK_EQUAL(pool.available(), 2u);
+
+  flusspferd::context_pool::lease lease(pool);
+  BOOST_CHECK_EQUAL(lease.get_context(), first);
+  BOOST_CHECK_EQUAL(
+    lease.evaluate("typeof x + typeof y").to_std_string(),
+    "undefinedundefined");
+  BOOST_CHECK_EQUAL(
+    lease.evaluate("require('binary').ByteString.poolTest").to_number(),
+    42.0);
+}
+
 BOOST_AUTO_TEST_SUITE( spidermonkey )
 
 BOOST_AUTO_TEST_CASE( direct_null_context ) {
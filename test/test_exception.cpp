@@ -26,9 +26,15 @@ THE SOFTWARE.
 
 #include "flusspferd/create_on.hpp"
 #include "flusspferd/value_io.hpp"
+#include "flusspferd/evaluate.hpp"
+#include "flusspferd/exception.hpp"
+#include "flusspferd/array.hpp"
+#include "flusspferd/binary.hpp"
+#include "flusspferd/create/native_object.hpp"
 
 #include <boost/spirit/include/phoenix.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/fusion/include/make_vector.hpp>
 
 #include "test_environment.hpp"
 
@@ -84,4 +90,58 @@ BOOST_AUTO_TEST_CASE( throw_values ) {
   BOOST_CHECK_EQUAL(v, value(g));
 }
 
+static int pending_error_reporter(int x) {
+  if (x < 0) {
+    set_pending_error("negative argument", "TypeError");
+    return 0;
+  }
+  return x * 2;
+}
+
+BOOST_AUTO_TEST_CASE( pending_error ) {
+  object g = flusspferd::global();
+  flusspferd::create_on(g)
+    .create<function>(
+      _name = "cpp_reporter",
+      _function = &pending_error_reporter
+    );
+
+  BOOST_CHECK_EQUAL(g.call("cpp_reporter", 21).get_int(), 42);
+  BOOST_CHECK(!is_error_pending());
+
+  value v = evaluate(
+    "try { cpp_reporter(-1); 'no error' }"
+    "catch (e) { (e instanceof TypeError) + ':' + e.message }");
+
+  BOOST_CHECK_EQUAL(v.to_std_string(), "true:negative argument");
+  BOOST_CHECK(!is_error_pending());
+
+  BOOST_CHECK_THROW(g.call("cpp_reporter", -1), flusspferd::exception);
+  BOOST_CHECK(!is_error_pending());
+}
+
+// The C++ API keeps throwing, only the Javascript bindings use pending errors.
+BOOST_AUTO_TEST_CASE( binary_index_of_errors ) {
+  load_class<binary>(flusspferd::global());
+  load_class<byte_string>(flusspferd::global());
+
+  binary::element_type const bytes[] = { 'a', 'b' };
+  byte_string &b = flusspferd::create<byte_string>(
+    boost::fusion::make_vector(bytes, std::size_t(2)));
+  root_object root(b);
+
+  boost::optional<int> none;
+  BOOST_CHECK_EQUAL(b.index_of(value(int('b')), none, none), 1);
+  BOOST_CHECK_THROW(b.index_of(value(300), none, none), flusspferd::exception);
+  BOOST_CHECK(!is_error_pending());
+  BOOST_CHECK_THROW(b.last_index_of(value("x"), none, none),
+                    flusspferd::exception);
+  BOOST_CHECK(!is_error_pending());
+
+  BOOST_CHECK_EQUAL(b.js_index_of(value(300), none, none), -1);
+  BOOST_CHECK(is_error_pending());
+  flusspferd::exception taken("takes the pending error");
+  BOOST_CHECK(!is_error_pending());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
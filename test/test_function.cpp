@@ -26,9 +26,12 @@ THE SOFTWARE.
 
 #include "flusspferd/native_function.hpp"
 #include "flusspferd/native_function_base.hpp"
+#include "flusspferd/native_call_stats.hpp"
 #include "flusspferd/create.hpp"
 #include "flusspferd/string.hpp"
 #include "flusspferd/string_io.hpp"
+#include "flusspferd/string_view.hpp"
+#include <boost/optional.hpp>
 
 #include "test_environment.hpp"
 
@@ -50,6 +53,15 @@ namespace {
 
     int v;
   };
+
+  double view_function_(
+      flusspferd::string_view s, boost::optional<int> n,
+      boost::optional<double> f)
+  {
+    if (!s.equals("abc") && !s.equals("123"))
+      return -1;
+    return s.length() + n.get_value_or(100) + f.get_value_or(0);
+  }
 }
 
 BOOST_FIXTURE_TEST_SUITE( with_context, context_fixture )
@@ -82,4 +94,43 @@ BOOST_AUTO_TEST_CASE( fn_struct ) {
   BOOST_CHECK_EQUAL(flusspferd::get_native<function_struct>(f).v, 1234);
 }
 
+BOOST_AUTO_TEST_CASE( native_call_stats ) {
+  flusspferd::native_call_stats &stats = flusspferd::native_call_stats::get();
+  stats.reset();
+
+  flusspferd::root_object f(
+      flusspferd::create<function_struct>(
+          flusspferd::param::_name = "counted_function"));
+  for (int i = 0; i < 3; ++i)
+    f.call(flusspferd::global());
+
+  std::vector<flusspferd::native_call_stats::entry> entries = stats.entries();
+  if (!flusspferd::native_call_stats::enabled()) {
+    BOOST_CHECK(entries.empty());
+    return;
+  }
+
+  BOOST_REQUIRE_EQUAL(entries.size(), 1u);
+  BOOST_CHECK_EQUAL(entries[0].name, "counted_function()");
+  BOOST_CHECK_EQUAL(entries[0].calls, 3ul);
+
+  stats.reset();
+  BOOST_CHECK(stats.entries().empty());
+}
+
+BOOST_AUTO_TEST_CASE( adapter_arguments ) {
+  flusspferd::root_object f(
+      flusspferd::create<flusspferd::function>("vf", &view_function_));
+  BOOST_CHECK_EQUAL(f.function_arity(), 3ul);
+
+  flusspferd::object g = flusspferd::global();
+  BOOST_CHECK_EQUAL(f.call(g, "abc", 1, 0.5).to_number(), 4.5);
+  BOOST_CHECK_EQUAL(f.call(g, "123", 2, 1, "extra").to_number(), 6.0);
+  BOOST_CHECK_THROW(f.call(g, 123, 2, 1), flusspferd::exception);
+  BOOST_CHECK_EQUAL(f.call(g, "abc").to_number(), 103.0);
+  BOOST_CHECK_EQUAL(f.call(g, "abc", 2, flusspferd::value()).to_number(), 5.0);
+  BOOST_CHECK_EQUAL(f.call(g, "abcd", 1, 0).to_number(), -1.0);
+  BOOST_CHECK_THROW(f.call(g, "abc", 1e20, 0), flusspferd::exception);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -58,3 +58,27 @@ BOOST_AUTO_TEST_CASE( enter_leave ) {
   BOOST_CHECK_EQUAL(old_context, init.current_context());
 }
 
+BOOST_AUTO_TEST_CASE( heap_settings ) {
+  flusspferd::init &init = flusspferd::init::initialize();
+
+  BOOST_CHECK_EQUAL(init.get_max_bytes(), flusspferd::init::default_max_bytes);
+
+  init.set_max_bytes(32 * 1024 * 1024);
+  BOOST_CHECK_EQUAL(init.get_max_bytes(), std::size_t(32 * 1024 * 1024));
+
+  BOOST_CHECK_EQUAL(&flusspferd::init::initialize(16 * 1024 * 1024), &init);
+  BOOST_CHECK_EQUAL(init.get_max_bytes(), std::size_t(16 * 1024 * 1024));
+
+  std::size_t const max_malloc_bytes = init.get_max_malloc_bytes();
+  init.set_max_malloc_bytes(4 * 1024 * 1024);
+  BOOST_CHECK_EQUAL(init.get_max_malloc_bytes(), std::size_t(4 * 1024 * 1024));
+
+  unsigned const trigger_factor = init.get_gc_trigger_factor();
+  if (init.set_gc_trigger_factor(50)) {
+    BOOST_CHECK_EQUAL(init.get_gc_trigger_factor(), 100u);
+    init.set_gc_trigger_factor(trigger_factor);
+  }
+
+  init.set_max_malloc_bytes(max_malloc_bytes);
+  init.set_max_bytes(flusspferd::init::default_max_bytes);
+}
@@ -0,0 +1,94 @@
+// vim:ts=2:sw=2:expandtab:autoindent:filetype=cpp:
+/*
+The MIT License
+
+Copyright (c) 2008, 2009 Flusspferd contributors (see "CONTRIBUTORS" or
+                                       http://flusspferd.org/contributors.txt)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "flusspferd/root.hpp"
+#include "flusspferd/root_arena.hpp"
+#include "flusspferd/arguments.hpp"
+#include "flusspferd/object.hpp"
+#include "flusspferd/string.hpp"
+#include "flusspferd/create/object.hpp"
+#include "flusspferd/value_io.hpp"
+#include "test_environment.hpp"
+
+BOOST_FIXTURE_TEST_SUITE( with_context, context_fixture )
+
+BOOST_AUTO_TEST_CASE( root_object ) {
+  flusspferd::root_object obj(flusspferd::create<flusspferd::object>());
+  obj.set_property("x", 42);
+
+  flusspferd::gc();
+  BOOST_CHECK_EQUAL(obj.get_property("x"), flusspferd::value(42));
+
+  obj = flusspferd::create<flusspferd::object>();
+  obj.set_property("y", "foo");
+  flusspferd::gc();
+  BOOST_CHECK_EQUAL(obj.get_property("y").to_std_string(), "foo");
+}
+
+BOOST_AUTO_TEST_CASE( nested_roots ) {
+  flusspferd::root_string outer(flusspferd::string("outer"));
+  {
+    flusspferd::root_value inner(flusspferd::string("inner"));
+    flusspferd::gc();
+    BOOST_CHECK_EQUAL(inner.to_std_string(), "inner");
+  }
+  flusspferd::gc();
+  BOOST_CHECK_EQUAL(outer.to_string(), "outer");
+}
+
+BOOST_AUTO_TEST_CASE( root_arena ) {
+  flusspferd::root_arena roots;
+  std::vector<flusspferd::object> objects;
+
+  for (int i = 0; i < 100; ++i) {
+    flusspferd::object o = roots.root(flusspferd::create<flusspferd::object>());
+    o.set_property("i", i);
+    objects.push_back(o);
+  }
+  BOOST_CHECK_EQUAL(roots.size(), 100u);
+
+  flusspferd::gc();
+  for (int i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(objects[i].get_property("i"), flusspferd::value(i));
+
+  roots.clear();
+  BOOST_CHECK_EQUAL(roots.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE( arguments_push_root ) {
+  flusspferd::arguments args;
+  for (int i = 0; i < 10; ++i)
+    args.push_root(flusspferd::string("arg"));
+
+  flusspferd::arguments copy(args);
+
+  flusspferd::gc();
+  BOOST_CHECK_EQUAL(copy.size(), 10u);
+  BOOST_CHECK_EQUAL(copy[9].to_std_string(), "arg");
+  BOOST_CHECK_EQUAL(args[0].to_std_string(), "arg");
+}
+
+BOOST_AUTO_TEST_SUITE_END()